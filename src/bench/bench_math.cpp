@@ -0,0 +1,132 @@
+// vec.h / mat.h against glm for the operations the renderers lean on. Kept in its own
+// translation unit because vec.h pulls in GLEW, which can't share one with glad.
+#include "mat.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <vector>
+
+static float randomFloat(std::mt19937 &rng)
+{
+    return std::uniform_real_distribution<float>(-1.0f, 1.0f)(rng);
+}
+
+static void BM_AngelMat4Multiply(benchmark::State &state)
+{
+    std::mt19937 rng(1);
+    std::vector<mat4> a(state.range(0)), b(state.range(0)), out(state.range(0));
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        a[i] = RotateY(randomFloat(rng)) * Translate(randomFloat(rng), randomFloat(rng), randomFloat(rng));
+        b[i] = RotateX(randomFloat(rng));
+    }
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < a.size(); i++)
+            out[i] = a[i] * b[i];
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AngelMat4Multiply)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+static void BM_GlmMat4Multiply(benchmark::State &state)
+{
+    std::mt19937 rng(1);
+    std::vector<glm::mat4> a(state.range(0)), b(state.range(0)), out(state.range(0));
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        a[i] = glm::translate(glm::rotate(glm::mat4(1.0f), randomFloat(rng), glm::vec3(0.0f, 1.0f, 0.0f)),
+                              glm::vec3(randomFloat(rng), randomFloat(rng), randomFloat(rng)));
+        b[i] = glm::rotate(glm::mat4(1.0f), randomFloat(rng), glm::vec3(1.0f, 0.0f, 0.0f));
+    }
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < a.size(); i++)
+            out[i] = a[i] * b[i];
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GlmMat4Multiply)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+static void BM_AngelMat4Vec4(benchmark::State &state)
+{
+    std::mt19937 rng(2);
+    mat4 m = RotateY(0.3f) * Translate(1.0f, 2.0f, 3.0f);
+    std::vector<vec4> v(state.range(0)), out(state.range(0));
+    for (size_t i = 0; i < v.size(); i++)
+        v[i] = vec4(randomFloat(rng), randomFloat(rng), randomFloat(rng), 1.0f);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < v.size(); i++)
+            out[i] = m * v[i];
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AngelMat4Vec4)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+static void BM_GlmMat4Vec4(benchmark::State &state)
+{
+    std::mt19937 rng(2);
+    glm::mat4 m = glm::translate(glm::rotate(glm::mat4(1.0f), 0.3f, glm::vec3(0.0f, 1.0f, 0.0f)), glm::vec3(1.0f, 2.0f, 3.0f));
+    std::vector<glm::vec4> v(state.range(0)), out(state.range(0));
+    for (size_t i = 0; i < v.size(); i++)
+        v[i] = glm::vec4(randomFloat(rng), randomFloat(rng), randomFloat(rng), 1.0f);
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < v.size(); i++)
+            out[i] = m * v[i];
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GlmMat4Vec4)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+static void BM_AngelVec3CrossNormalize(benchmark::State &state)
+{
+    std::mt19937 rng(3);
+    std::vector<vec3> a(state.range(0)), b(state.range(0)), out(state.range(0));
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        a[i] = vec3(randomFloat(rng), randomFloat(rng), randomFloat(rng));
+        b[i] = vec3(randomFloat(rng), randomFloat(rng), randomFloat(rng));
+    }
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < a.size(); i++)
+            out[i] = normalize(cross(a[i], b[i]));
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_AngelVec3CrossNormalize)->RangeMultiplier(8)->Range(64, 1 << 15);
+
+static void BM_GlmVec3CrossNormalize(benchmark::State &state)
+{
+    std::mt19937 rng(3);
+    std::vector<glm::vec3> a(state.range(0)), b(state.range(0)), out(state.range(0));
+    for (size_t i = 0; i < a.size(); i++)
+    {
+        a[i] = glm::vec3(randomFloat(rng), randomFloat(rng), randomFloat(rng));
+        b[i] = glm::vec3(randomFloat(rng), randomFloat(rng), randomFloat(rng));
+    }
+    for (auto _ : state)
+    {
+        for (size_t i = 0; i < a.size(); i++)
+            out[i] = glm::normalize(glm::cross(a[i], b[i]));
+        benchmark::DoNotOptimize(out.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GlmVec3CrossNormalize)->RangeMultiplier(8)->Range(64, 1 << 15);
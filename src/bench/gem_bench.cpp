@@ -0,0 +1,470 @@
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <stb_image.h>
+
+#include <benchmark/benchmark.h>
+
+#include "camera.h"
+#include "gem_scene.h"
+#include "geometry_pool.h"
+#include "mesh_optimizer.h"
+#include "model.h"
+#include "render_queue.h"
+#include "texture_compress.h"
+
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+// Microbenchmarks for the per-frame CPU work of gem.cpp and its loaders. Sizes are swept with
+// Range(), so results show how each piece scales past the seven gems of the default scene.
+// The Model benchmarks need a GL context and are only registered when a hidden window opens.
+//
+// usage: gem_bench [--benchmark_filter=regex] [any other Google Benchmark flag]
+
+// ring of n gems around the origin, laid out like makeGemLocations() but for any count
+static vector<glm::vec3> gemRing(int n)
+{
+    vector<glm::vec3> positions(n);
+    for (int i = 0; i < n; i++)
+    {
+        float a = PI * 2.0f * (float)i / (float)n;
+        positions[i] = glm::vec3(gemDist * sin(a), 0.0f, gemDist * cos(a));
+    }
+    return positions;
+}
+
+// ----------------------------------------------------------------------------------------------
+// transparency sort
+
+// the pre-command-buffer path: a map keyed by camera distance, walked in reverse
+static void BM_TransparencySortMap(benchmark::State &state)
+{
+    vector<glm::vec3> positions = gemRing((int)state.range(0));
+    glm::vec3 cameraPos(0.0f, 1.0f, 6.0f);
+    for (auto _ : state)
+    {
+        std::map<float, std::pair<int, glm::vec3> > sorted;
+        for (unsigned int i = 0; i < positions.size(); i++)
+            sorted[glm::length(cameraPos - positions[i])] = std::make_pair((int)i, positions[i]);
+        for (std::map<float, std::pair<int, glm::vec3> >::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it)
+            benchmark::DoNotOptimize(it->second);
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransparencySortMap)->RangeMultiplier(4)->Range(8, 1 << 14);
+
+// recording a gem and its edges per position, then the radix sort
+static void BM_TransparencySortRadix(benchmark::State &state)
+{
+    vector<glm::vec3> positions = gemRing((int)state.range(0));
+    glm::vec3 cameraPos(0.0f, 1.0f, 6.0f);
+    CommandBuffer commands;
+    for (auto _ : state)
+    {
+        commands.Clear();
+        for (unsigned int i = 0; i < positions.size(); i++)
+        {
+            float depth = glm::length(cameraPos - positions[i]) / 100.0f;
+            uint32_t u = commands.PushUniforms(glm::translate(glm::mat4(1.0f), positions[i]), colors[i % 7]);
+            commands.Draw(MakeSortKey(PASS_TRANSPARENT, depth, LAYER_GEM, 1, 1, 0), 1, 1, GL_TRIANGLES, 0, gemVertexCount, u);
+            commands.Draw(MakeSortKey(PASS_TRANSPARENT, depth, LAYER_EDGE, 2, 2, 0), 2, 2, GL_LINES, 0, gemEdgeVertexCount, u);
+        }
+        commands.Sort();
+        benchmark::DoNotOptimize(commands.items.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_TransparencySortRadix)->RangeMultiplier(4)->Range(8, 1 << 14);
+
+// ----------------------------------------------------------------------------------------------
+// model matrices
+
+static void BM_GemModelMatrices(benchmark::State &state)
+{
+    vector<glm::vec3> positions = gemRing((int)state.range(0));
+    vector<glm::mat4> models(positions.size());
+    float angle = 0.0f;
+    for (auto _ : state)
+    {
+        angle += 0.001f;
+        for (unsigned int i = 0; i < positions.size(); i++)
+            models[i] = gemModelMatrix(positions[i], angle * 0.5f, angle);
+        benchmark::DoNotOptimize(models.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_GemModelMatrices)->RangeMultiplier(4)->Range(8, 1 << 14);
+
+// ----------------------------------------------------------------------------------------------
+// camera
+
+// a frame's worth of mouse events (range(0) of them) followed by the view matrix; the vectors
+// are brought up to date once, by GetViewMatrix
+static void BM_CameraUpdateVectors(benchmark::State &state)
+{
+    Camera camera(glm::vec3(0.0f, 1.0f, 6.0f));
+    float offset = 1.0f;
+    for (auto _ : state)
+    {
+        for (int i = 0; i < state.range(0); i++)
+        {
+            camera.ProcessMouseMovement(offset, -offset);
+            offset = -offset;
+        }
+        glm::mat4 view = camera.GetViewMatrix();
+        benchmark::DoNotOptimize(view);
+    }
+}
+BENCHMARK(BM_CameraUpdateVectors)->Arg(1)->Arg(16);
+
+// the cached view matrix of a camera that hasn't moved
+static void BM_CameraViewMatrix(benchmark::State &state)
+{
+    Camera camera(glm::vec3(0.0f, 1.0f, 6.0f));
+    for (auto _ : state)
+    {
+        glm::mat4 view = camera.GetViewMatrix();
+        benchmark::DoNotOptimize(view);
+    }
+}
+BENCHMARK(BM_CameraViewMatrix);
+
+// the per-frame snapshot of a camera that moves every frame: view, projection, their product,
+// its inverse and the frustum planes
+static void BM_CameraFrame(benchmark::State &state)
+{
+    Camera camera(glm::vec3(0.0f, 1.0f, 6.0f));
+    for (auto _ : state)
+    {
+        camera.ProcessKeyboard(FORWARD, 0.001f);
+        CameraFrame frame = camera.GetFrame(16.0f / 9.0f, 0.1f, 100.0f);
+        benchmark::DoNotOptimize(frame);
+    }
+}
+BENCHMARK(BM_CameraFrame);
+
+// ----------------------------------------------------------------------------------------------
+// cubemap decode: the stbi_load half of loadCubemap(), without the upload
+
+static void BM_CubemapDecode(benchmark::State &state)
+{
+    vector<std::string> faces = skyboxFaces();
+    int64_t bytes = 0;
+    for (auto _ : state)
+    {
+        for (unsigned int i = 0; i < faces.size(); i++)
+        {
+            int width, height, nrChannels;
+            unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
+            if (!data)
+            {
+                state.SkipWithError("Cubemap texture failed to load");
+                return;
+            }
+            bytes += (int64_t)width * height * nrChannels;
+            stbi_image_free(data);
+        }
+    }
+    state.SetBytesProcessed(bytes);
+}
+BENCHMARK(BM_CubemapDecode)->Unit(benchmark::kMillisecond);
+
+// block compression of one skybox face with its mip chain, as a cold texture cache pays it
+static void BM_CompressFace(benchmark::State &state)
+{
+    Texture_Compression format = (Texture_Compression)state.range(0);
+    int width, height, nrChannels;
+    unsigned char *data = stbi_load(skyboxFaces()[0].c_str(), &width, &height, &nrChannels, 0);
+    if (!data)
+    {
+        state.SkipWithError("Cubemap texture failed to load");
+        return;
+    }
+    CompressedTexture compressed;
+    for (auto _ : state)
+    {
+        CompressTexture(data, width, height, nrChannels, format, compressed);
+        benchmark::DoNotOptimize(compressed.levels[0].data());
+    }
+    stbi_image_free(data);
+    state.SetItemsProcessed(state.iterations() * (int64_t)width * height);
+}
+BENCHMARK(BM_CompressFace)->Arg(COMPRESS_BC1)->Arg(COMPRESS_BC7)->Unit(benchmark::kMillisecond);
+
+// ----------------------------------------------------------------------------------------------
+// Model::loadModel on a synthetic n x n quad grid with positions, normals and uvs, once through
+// assimp and once from the binary mesh cache
+
+static std::string writeGridObj(int n)
+{
+    std::stringstream name;
+    name << "gem_bench_grid_" << n << ".obj";
+    std::ofstream out(name.str().c_str());
+    for (int y = 0; y <= n; y++)
+        for (int x = 0; x <= n; x++)
+            out << "v " << (float)x / n << " 0 " << (float)y / n << "\n"
+                << "vt " << (float)x / n << " " << (float)y / n << "\n"
+                << "vn 0 1 0\n";
+    for (int y = 0; y < n; y++)
+        for (int x = 0; x < n; x++)
+        {
+            int a = y * (n + 1) + x + 1; // obj indices are 1-based
+            int b = a + 1;
+            int c = a + n + 1;
+            int d = c + 1;
+            out << "f " << a << "/" << a << "/" << a << " " << c << "/" << c << "/" << c << " " << d << "/" << d << "/" << d << "\n"
+                << "f " << a << "/" << a << "/" << a << " " << d << "/" << d << "/" << d << " " << b << "/" << b << "/" << b << "\n";
+        }
+    return name.str();
+}
+
+static void BM_ModelLoad(benchmark::State &state)
+{
+    int n = (int)state.range(0);
+    std::string path = writeGridObj(n);
+    for (auto _ : state)
+    {
+        Model *model = new Model(path);
+        benchmark::DoNotOptimize(model->meshes.data());
+        state.PauseTiming();
+        delete model; // the last reference, so its buffers are freed outside the timing
+        glFinish();
+        std::remove(MeshCache::PathFor(path).c_str()); // force the assimp path every time
+        state.ResumeTiming();
+    }
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * (int64_t)(n + 1) * (n + 1));
+}
+
+static void BM_ModelLoadCached(benchmark::State &state)
+{
+    int n = (int)state.range(0);
+    std::string path = writeGridObj(n);
+    {
+        Model warmup(path); // writes the cache
+    }
+    for (auto _ : state)
+    {
+        Model *model = new Model(path);
+        benchmark::DoNotOptimize(model->meshes.data());
+        state.PauseTiming();
+        delete model;
+        glFinish();
+        state.ResumeTiming();
+    }
+    std::remove(MeshCache::PathFor(path).c_str());
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * (int64_t)(n + 1) * (n + 1));
+}
+
+// loading a model another Model already holds: a registry hit, no file access or upload
+static void BM_ModelLoadShared(benchmark::State &state)
+{
+    int n = (int)state.range(0);
+    std::string path = writeGridObj(n);
+    {
+        Model holder(path);
+        for (auto _ : state)
+        {
+            Model model(path);
+            benchmark::DoNotOptimize(model.meshes.data());
+        }
+    }
+    std::remove(MeshCache::PathFor(path).c_str());
+    std::remove(path.c_str());
+    state.SetItemsProcessed(state.iterations() * (int64_t)(n + 1) * (n + 1));
+}
+
+// ----------------------------------------------------------------------------------------------
+// drawing a model of n meshes, one draw call per mesh against one glMultiDrawElementsIndirect
+// per material batch (Model::UsePool). Both run the pool's program under a camera that sees
+// every mesh, and each iteration ends in glFinish so the driver can't queue frames up.
+
+// n small quads, each its own object and so its own mesh
+static std::string writePartsObj(int n)
+{
+    std::stringstream name;
+    name << "gem_bench_parts_" << n << ".obj";
+    std::ofstream out(name.str().c_str());
+    for (int i = 0; i < n; i++)
+    {
+        float x = (float)(i % 32), z = (float)(i / 32);
+        out << "o part" << i << "\n"
+            << "v " << x << " 0 " << z << "\n" << "v " << x + 0.9f << " 0 " << z << "\n"
+            << "v " << x + 0.9f << " 0 " << z + 0.9f << "\n" << "v " << x << " 0 " << z + 0.9f << "\n"
+            << "vn 0 1 0\n";
+        int v = i * 4 + 1, vn = i + 1;
+        out << "f " << v << "//" << vn << " " << v + 2 << "//" << vn << " " << v + 1 << "//" << vn << "\n"
+            << "f " << v << "//" << vn << " " << v + 3 << "//" << vn << " " << v + 2 << "//" << vn << "\n";
+    }
+    return name.str();
+}
+
+// looks straight down on writePartsObj's quads, 32 to a row
+static void setPartsCamera(const Shader &shader, int n)
+{
+    float halfDepth = (float)((n + 31) / 32) * 0.5f;
+    glm::vec3 centre(16.0f, 0.0f, halfDepth);
+    shader.setMat4("view", glm::lookAt(centre + glm::vec3(0.0f, 10.0f, 0.0f), centre, glm::vec3(0.0f, 0.0f, -1.0f)));
+    shader.setMat4("projection", glm::ortho(-17.0f, 17.0f, -halfDepth - 1.0f, halfDepth + 1.0f, 0.1f, 20.0f));
+}
+
+static void BM_ModelDrawPerMesh(benchmark::State &state)
+{
+    int n = (int)state.range(0);
+    std::string path = writePartsObj(n);
+    {
+        Model model(path);
+        Shader shader("../../src/shader/mesh_mdi.vert", "../../src/shader/mesh_mdi.frag");
+        shader.use();
+        setPartsCamera(shader, n);
+        shader.setInt("drawOffset", 0);
+        // a one-entry draw buffer: gl_DrawID is 0 outside a multi-draw, so every mesh reads it
+        PoolDrawData draw;
+        draw.model = glm::mat4(1.0f);
+        draw.material = 0;
+        draw.pad[0] = draw.pad[1] = draw.pad[2] = 0;
+        GLuint drawBuffer;
+        glGenBuffers(1, &drawBuffer);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(draw), &draw, GL_STATIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawBuffer);
+        for (auto _ : state)
+        {
+            model.Draw(shader);
+            glFinish();
+        }
+        state.counters["draws"] = (double)model.meshes.size();
+        glDeleteBuffers(1, &drawBuffer);
+    }
+    std::remove(MeshCache::PathFor(path).c_str());
+    std::remove(path.c_str());
+}
+
+static void BM_ModelDrawPooled(benchmark::State &state)
+{
+    int n = (int)state.range(0);
+    std::string path = writePartsObj(n);
+    {
+        GeometryPool pool;
+        Model model(path);
+        model.UsePool(pool);
+        Shader shader("../../src/shader/mesh_mdi.vert", "../../src/shader/mesh_mdi.frag");
+        shader.use();
+        setPartsCamera(shader, n);
+        for (auto _ : state)
+        {
+            model.Draw(shader);
+            glFinish();
+        }
+        state.counters["draws"] = (double)pool.DrawCount();
+        state.counters["multiDraws"] = (double)pool.BatchCount();
+    }
+    std::remove(MeshCache::PathFor(path).c_str());
+    std::remove(path.c_str());
+}
+
+// ----------------------------------------------------------------------------------------------
+// mesh optimisation (vertex cache, overdraw, fetch) of an n x n grid in shuffled triangle order
+
+static void BM_MeshOptimize(benchmark::State &state)
+{
+    int n = (int)state.range(0);
+    vector<Vertex> vertices((n + 1) * (n + 1));
+    for (int y = 0; y <= n; y++)
+        for (int x = 0; x <= n; x++)
+            vertices[y * (n + 1) + x].Position = glm::vec3((float)x, (float)y, 0.0f);
+    vector<unsigned int> triangles;
+    for (int y = 0; y < n; y++)
+        for (int x = 0; x < n; x++)
+        {
+            unsigned int a = y * (n + 1) + x, b = a + 1, c = a + n + 1, d = c + 1;
+            unsigned int quad[6] = { a, c, d, a, d, b };
+            triangles.insert(triangles.end(), quad, quad + 6);
+        }
+    vector<unsigned int> order(triangles.size() / 3);
+    for (unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::shuffle(order.begin(), order.end(), std::mt19937(1));
+    vector<unsigned int> shuffled;
+    for (unsigned int i = 0; i < order.size(); i++)
+        shuffled.insert(shuffled.end(), triangles.begin() + order[i] * 3, triangles.begin() + order[i] * 3 + 3);
+
+    MeshOptimizeStats stats;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        vector<Vertex> v = vertices;
+        vector<unsigned int> i = shuffled;
+        state.ResumeTiming();
+        stats = OptimizeMesh(v, i);
+    }
+    state.counters["acmrBefore"] = stats.acmrBefore;
+    state.counters["acmrAfter"] = stats.acmrAfter;
+    state.SetItemsProcessed(state.iterations() * (int64_t)order.size());
+}
+BENCHMARK(BM_MeshOptimize)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+
+// ----------------------------------------------------------------------------------------------
+
+// opens a hidden window so the benchmarks that create GL objects have a current context; 4.6
+// where the driver has it, for GeometryPool, otherwise 3.3
+static GLFWwindow* createHiddenContext()
+{
+    if (!glfwInit())
+        return NULL;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "gem_bench", NULL, NULL);
+    if (window == NULL)
+    {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(64, 64, "gem_bench", NULL, NULL);
+    }
+    if (window == NULL)
+        return NULL;
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        glfwDestroyWindow(window);
+        return NULL;
+    }
+    return window;
+}
+
+int main(int argc, char** argv)
+{
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv))
+        return 1;
+
+    GLFWwindow* window = createHiddenContext();
+    if (window != NULL)
+    {
+        benchmark::RegisterBenchmark("BM_ModelLoad", BM_ModelLoad)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark("BM_ModelLoadCached", BM_ModelLoadCached)->RangeMultiplier(4)->Range(16, 1024)->Unit(benchmark::kMillisecond);
+        benchmark::RegisterBenchmark("BM_ModelLoadShared", BM_ModelLoadShared)->RangeMultiplier(4)->Range(16, 1024);
+        // the pool's program needs 4.6 (gl_DrawID, SSBOs)
+        if (GeometryPool::Supported())
+        {
+            benchmark::RegisterBenchmark("BM_ModelDrawPerMesh", BM_ModelDrawPerMesh)->RangeMultiplier(4)->Range(16, 1024);
+            benchmark::RegisterBenchmark("BM_ModelDrawPooled", BM_ModelDrawPooled)->RangeMultiplier(4)->Range(16, 1024);
+        }
+    }
+    else
+        std::cout << "No OpenGL context, skipping the Model benchmarks" << std::endl;
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    glfwTerminate();
+    return 0;
+}
@@ -0,0 +1,204 @@
+#ifndef ASSET_REGISTRY_H
+#define ASSET_REGISTRY_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <stdint.h>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mesh.h"
+
+using namespace std;
+
+// Process-wide, reference-counted store of loaded assets, so anything shared between models (or
+// loaded twice by the same one) is decoded and uploaded exactly once.
+//
+// Assets are keyed by their normalised path. Acquire() takes a reference, loading the asset if
+// nobody holds it yet; Release() drops one and frees the asset the moment the count reaches zero.
+// Tables are safe to use from any thread, and a thread acquiring an asset that another thread is
+// still loading waits for it. Loaders and releasers run on the calling thread, so GL assets must
+// be acquired and released on the GL thread; loader threads can use Find().
+
+// "a\\b/./c/../d" -> "a/b/d". Keeps leading ".." of relative paths and the root of absolute ones.
+inline string NormalizeAssetPath(const string &path)
+{
+    vector<string> parts;
+    string part;
+    bool absolute = !path.empty() && (path[0] == '/' || path[0] == '\\');
+    for (size_t i = 0; i <= path.size(); i++)
+    {
+        char c = i < path.size() ? path[i] : '/';
+        if (c != '/' && c != '\\')
+        {
+            part += c;
+            continue;
+        }
+        if (part == "..")
+        {
+            if (!parts.empty() && parts.back() != "..")
+                parts.pop_back();
+            else if (!absolute)
+                parts.push_back(part);
+        }
+        else if (!part.empty() && part != ".")
+            parts.push_back(part);
+        part.clear();
+    }
+    string normalized = absolute ? "/" : "";
+    for (size_t i = 0; i < parts.size(); i++)
+    {
+        if (i > 0)
+            normalized += '/';
+        normalized += parts[i];
+    }
+    return normalized;
+}
+
+// 64-bit FNV-1a of a normalised path
+struct AssetPathHash {
+    size_t operator()(const string &path) const
+    {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < path.size(); i++)
+        {
+            hash ^= (unsigned char)path[i];
+            hash *= 1099511628211ull;
+        }
+        return (size_t)hash;
+    }
+};
+
+template <typename T>
+class AssetTable {
+public:
+    typedef std::function<T()> Loader;
+    typedef std::function<void(T&)> Releaser;
+
+    // returns the asset for path, calling load() if nobody holds it yet; every call takes a
+    // reference that must be given back with Release(). The reference stays valid until then.
+    const T &Acquire(const string &path, const Loader &load, const Releaser &release)
+    {
+        string key = NormalizeAssetPath(path);
+        std::unique_lock<std::mutex> lock(mutex);
+        typename unordered_map<string, Entry, AssetPathHash>::iterator it = entries.find(key);
+        if (it != entries.end())
+        {
+            it->second.refs++;
+            while (it->second.loading)
+                loaded.wait(lock);
+            return it->second.asset;
+        }
+
+        // claim the entry, then load without holding the lock so other paths aren't held up
+        Entry &entry = entries[key];
+        entry.refs = 1;
+        entry.loading = true;
+        entry.release = release;
+        lock.unlock();
+        T asset = load();
+        lock.lock();
+        entry.asset = std::move(asset);
+        entry.loading = false;
+        loaded.notify_all();
+        return entry.asset;
+    }
+
+    // the asset if it is loaded, without taking a reference; NULL otherwise
+    const T* Find(const string &path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        typename unordered_map<string, Entry, AssetPathHash>::iterator it = entries.find(NormalizeAssetPath(path));
+        return it == entries.end() || it->second.loading ? NULL : &it->second.asset;
+    }
+
+    // drops a reference; the last one frees the asset immediately
+    void Release(const string &path)
+    {
+        T asset;
+        Releaser release;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            typename unordered_map<string, Entry, AssetPathHash>::iterator it = entries.find(NormalizeAssetPath(path));
+            if (it == entries.end() || --it->second.refs > 0)
+                return;
+            asset = std::move(it->second.asset);
+            release = it->second.release;
+            entries.erase(it);
+        }
+        if (release)
+            release(asset);
+    }
+
+    unsigned int RefCount(const string &path)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        typename unordered_map<string, Entry, AssetPathHash>::iterator it = entries.find(NormalizeAssetPath(path));
+        return it == entries.end() ? 0 : it->second.refs;
+    }
+
+    size_t Size()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return entries.size();
+    }
+
+private:
+    struct Entry {
+        T asset;
+        unsigned int refs;
+        bool loading;
+        Releaser release;
+    };
+    std::mutex mutex;
+    std::condition_variable loaded;
+    // node based, so references to assets survive rehashing
+    unordered_map<string, Entry, AssetPathHash> entries;
+};
+
+// the GPU side of a loaded model, shared by every Model with the same path and vertex format
+struct ModelAsset {
+    vector<Mesh> meshes;
+    vector<Texture> textures;       // each texture the meshes use, once
+    vector<string> textureKeys;     // texture table references held by the meshes
+};
+
+class AssetRegistry {
+public:
+    AssetTable<unsigned int> textures;
+    AssetTable<unsigned int> programs;
+    AssetTable<ModelAsset>   models;
+
+    static AssetRegistry &Get()
+    {
+        static AssetRegistry registry;
+        return registry;
+    }
+
+    // shader programs are keyed by both stages and the defines they are compiled with
+    static string ProgramKey(const string &vertexPath, const string &fragmentPath, const string &defines = "")
+    {
+        return NormalizeAssetPath(vertexPath) + "|" + NormalizeAssetPath(fragmentPath) + "|" + defines;
+    }
+
+    // the program for key, linked by compile() if nobody holds it yet. The caller compiles because
+    // shader.h and shader_m.h both declare Shader and only shader_m.h's takes defines.
+    unsigned int AcquireProgram(const string &key, const AssetTable<unsigned int>::Loader &compile)
+    {
+        return programs.Acquire(key, compile, [](unsigned int &program) { glDeleteProgram(program); });
+    }
+
+    void ReleaseProgram(const string &key)
+    {
+        programs.Release(key);
+    }
+
+private:
+    AssetRegistry() {}
+    AssetRegistry(const AssetRegistry&);
+    AssetRegistry &operator=(const AssetRegistry&);
+};
+#endif
@@ -0,0 +1,44 @@
+#ifndef CACHE_FILE_H
+#define CACHE_FILE_H
+
+#include <sys/stat.h>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <string>
+
+using namespace std;
+
+// File handling shared by the binary caches (mesh_cache.h, texture_compress.h) and the scene
+// files of scene_stream.h.
+
+// true if the cache exists and was written after the source was last modified
+inline bool CacheIsFresh(const string &cachePath, const string &sourcePath)
+{
+    struct stat cacheInfo, sourceInfo;
+    if (stat(cachePath.c_str(), &cacheInfo) != 0)
+        return false;
+    if (stat(sourcePath.c_str(), &sourceInfo) != 0)
+        return true; // source missing, the cache is all there is
+    return cacheInfo.st_mtime >= sourceInfo.st_mtime;
+}
+
+// writes path through write(out), which returns false to give up. The data goes to a temporary
+// name first and replaces path only once it is complete, so a crash never leaves a truncated file.
+inline bool WriteFileSafely(const string &path, const std::function<bool(std::ofstream&)> &write)
+{
+    string tempPath = path + ".tmp";
+    std::ofstream out(tempPath.c_str(), std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+    bool written = write(out);
+    out.close();
+    if (!written || !out)
+    {
+        remove(tempPath.c_str());
+        return false;
+    }
+    remove(path.c_str());
+    return rename(tempPath.c_str(), path.c_str()) == 0;
+}
+#endif
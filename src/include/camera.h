@@ -6,6 +6,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <vector>
+#include "frustum.h"
 
 //Defines several possible options for camera movement. Used as abstraction to 
 //stay away from window-system specific input methods
@@ -25,17 +26,38 @@ const float SPEED = 2.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
 
+//Everything the renderer needs from the camera for one frame. It is handed out by value, so
+//it stays fixed while the frame is drawn even if input moves the camera in the meantime
+struct CameraFrame
+{
+	glm::vec3 Position;
+	glm::vec3 Front;
+	glm::vec3 Up;
+	glm::vec3 Right;
+	float FovY;			//radians
+	float Aspect;
+	float NearPlane;
+	float FarPlane;
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 ViewProjection;
+	glm::mat4 InverseViewProjection;
+	Frustum ViewFrustum;
+};
 
 //An abstract camera class that processes input and calculates the corresponding Euler Angles, 
 //Vectors and Matrices for use in OpenGL
+//
+//The matrices are cached and only rebuilt when their inputs change. Mouse movement only updates
+//the Euler angles; the front, right and up vectors follow them lazily, on the next movement,
+//matrix or vector request, so a burst of mouse events in one frame costs one round of trig.
+//Those vectors are derived from Yaw, Pitch and WorldUp, so they are read-only: steer the camera
+//through the Euler angles
 class Camera
 {
 public:
 	//Camera Attributes
 	glm::vec3 Position;
-	glm::vec3 Front;
-	glm::vec3 Up;
-	glm::vec3 Right;
 	glm::vec3 WorldUp;
 	//Euler Angles
 	float Yaw;
@@ -47,8 +69,8 @@ public:
 
 	//Constructor with vectors
 	Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f),
-		float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED),
-		MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+		float yaw = YAW, float pitch = PITCH) : MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM),
+		viewDirty(true), projectionDirty(true), combinedDirty(true)
 	{
 		Position = position;
 		WorldUp = up;
@@ -58,7 +80,8 @@ public:
 	}
 	//Constructor with scalar values
 	Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) :
-		Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+		MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM),
+		viewDirty(true), projectionDirty(true), combinedDirty(true)
 	{
 		Position = glm::vec3(posX, posY, posZ);
 		WorldUp = glm::vec3(upX, upY, upZ);
@@ -67,29 +90,73 @@ public:
 		updateCameraVectors();
 	}
 
+	//Returns the camera's front, right and up vectors for the current Euler angles
+	glm::vec3 GetFront()
+	{
+		refreshVectors();
+		return front;
+	}
+
+	glm::vec3 GetRight()
+	{
+		refreshVectors();
+		return right;
+	}
+
+	glm::vec3 GetUp()
+	{
+		refreshVectors();
+		return up;
+	}
+
 	//Returns the view matrix calculated using Euler Angles and the LookAt Matrix
 	glm::mat4 GetViewMatrix()
 	{
-		return glm::lookAt(Position, Position + Front, Up);
+		updateView();
+		return frame.View;
+	}
+
+	//Returns the perspective projection for Zoom with the given aspect and clip planes
+	glm::mat4 GetProjectionMatrix(float aspect, float nearPlane, float farPlane)
+	{
+		updateProjection(aspect, nearPlane, farPlane);
+		return frame.Projection;
+	}
+
+	//Returns this frame's view, projection, their product and inverse and the frustum planes.
+	//aspect should come from the framebuffer the frame is drawn to
+	CameraFrame GetFrame(float aspect, float nearPlane, float farPlane)
+	{
+		updateView();
+		updateProjection(aspect, nearPlane, farPlane);
+		if (combinedDirty)
+		{
+			frame.ViewProjection = frame.Projection * frame.View;
+			frame.InverseViewProjection = glm::inverse(frame.ViewProjection);
+			frame.ViewFrustum = Frustum::FromMatrix(frame.ViewProjection);
+			combinedDirty = false;
+		}
+		return frame;
 	}
 
 	//Processes input received from any keyboard-like input system. Accepts input parameter in the form 
 	//of camera defined ENUM (to abstract it from windowing systems)
 	void ProcessKeyboard(Camera_Movement direction, float deltaTime)
 	{
+		refreshVectors();
 		float velocity = MovementSpeed * deltaTime;
 		if (direction == FORWARD)
-			Position += Front * velocity;
+			Position += front * velocity;
 		if (direction == BACKWARD)
-			Position -= Front * velocity;
+			Position -= front * velocity;
 		if (direction == LEFT)
-			Position -= Right * velocity;
+			Position -= right * velocity;
 		if (direction == RIGHT)
-			Position += Right * velocity;
+			Position += right * velocity;
 		if (direction == UP)
-			Position += Up * velocity;
+			Position += up * velocity;
 		if (direction == DOWN)
-			Position -= Up * velocity;
+			Position -= up * velocity;
 	}
 
 	//Processes input received from a mouse input system. Expects the offset value in both the x and y direction.
@@ -110,8 +177,7 @@ public:
 				Pitch = -89.0f;
 		}
 
-		//Update Front, Right and Up Vectors using the updated Euler angles
-		updateCameraVectors();
+		//the front, right and up vectors catch up with the new Euler angles when next needed
 	}
 
 	//Processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
@@ -123,24 +189,80 @@ public:
 			Zoom = 1.0f;
 		if (Zoom >= 45.0f)
 			Zoom = 45.0f;
+		projectionDirty = true;
 	}
 
 private:
+	//derived from the Euler angles and WorldUp, and the values they were derived from
+	glm::vec3 front;
+	glm::vec3 up;
+	glm::vec3 right;
+	float vectorsYaw;
+	float vectorsPitch;
+	glm::vec3 vectorsWorldUp;
+	CameraFrame frame;
+	bool viewDirty;
+	bool projectionDirty;
+	bool combinedDirty;
+
+	//Rebuilds the view matrix if the camera has turned or moved. Position is public, so a move
+	//is detected by comparing it with the cached one
+	void updateView()
+	{
+		refreshVectors();
+		if (!viewDirty && Position == frame.Position)
+			return;
+		frame.Position = Position;
+		frame.Front = front;
+		frame.Up = up;
+		frame.Right = right;
+		frame.View = glm::lookAt(Position, Position + front, up);
+		viewDirty = false;
+		combinedDirty = true;
+	}
+
+	//Rebuilds the projection if the zoom, aspect or clip planes have changed; Zoom is public too
+	void updateProjection(float aspect, float nearPlane, float farPlane)
+	{
+		float fovY = glm::radians(Zoom);
+		if (!projectionDirty && fovY == frame.FovY && aspect == frame.Aspect && nearPlane == frame.NearPlane && farPlane == frame.FarPlane)
+			return;
+		frame.FovY = fovY;
+		frame.Aspect = aspect;
+		frame.NearPlane = nearPlane;
+		frame.FarPlane = farPlane;
+		frame.Projection = glm::perspective(frame.FovY, aspect, nearPlane, farPlane);
+		projectionDirty = false;
+		combinedDirty = true;
+	}
+
+	//Rebuilds the vectors if Yaw, Pitch or WorldUp have changed since they were last built. All
+	//three are public, so changes are found by comparison rather than flagged
+	void refreshVectors()
+	{
+		if (Yaw != vectorsYaw || Pitch != vectorsPitch || WorldUp != vectorsWorldUp)
+			updateCameraVectors();
+	}
+
 	//Calculates the front vector from the Camera's (updated) Euler Angles
 	void updateCameraVectors()
 	{
-		//Calculate the new Front vector
-		glm::vec3 front;
-		front.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
-		front.y = sin(glm::radians(Pitch));
-		front.z = sin(glm::radians(Yaw)) * cos(glm::radians(Pitch));
-		Front = glm::normalize(front);
-
-		//Also re-calculate the Right and Up vector
+		//Calculate the new front vector
+		glm::vec3 direction;
+		direction.x = cos(glm::radians(Yaw)) * cos(glm::radians(Pitch));
+		direction.y = sin(glm::radians(Pitch));
+		direction.z = sin(glm::radians(Yaw)) * cos(glm::radians(Pitch));
+		front = glm::normalize(direction);
+
+		//Also re-calculate the right and up vector
 		//Normalize the vectors, because their length gets closer to 0 
 		//the more you look up or down which results in slower movement.
-		Right = glm::normalize(glm::cross(Front, WorldUp));
-		Up = glm::normalize(glm::cross(Right, Front));
+		right = glm::normalize(glm::cross(front, WorldUp));
+		up = glm::normalize(glm::cross(right, front));
+		vectorsYaw = Yaw;
+		vectorsPitch = Pitch;
+		vectorsWorldUp = WorldUp;
+		viewDirty = true;
 	}
 };
 #endif
\ No newline at end of file
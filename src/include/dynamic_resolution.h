@@ -0,0 +1,154 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <algorithm>
+#include <cmath>
+#include "gpu_timer.h"
+
+// Renders the scene into an offscreen target at a fraction of the window resolution and
+// upscales it to the window, adjusting the fraction every frame so the GPU time of the scene
+// pass tracks a target.
+//
+// The target is allocated at the full window size and the scene only uses the lower left part
+// of it, so changing the scale is just a viewport change. Scale applies to both axes, so the
+// pixel count (what a fill-bound frame pays for) goes with its square; the controller works in
+// pixel count and takes the square root at the end.
+//
+// With Adaptive off the target is used at full scale; that gives passes such as PostAA an
+// offscreen image to read without any scaling.
+//
+// The controller is a PID on the relative error (target - measured) / target:
+//   P reacts to the current frame, I removes the steady offset a pure P controller leaves,
+//   D damps the overshoot from the couple of frames the GPU timings lag behind.
+class DynamicResolution {
+public:
+    float TargetMs;     // GPU time the scene pass should take
+    float MinScale;     // per axis
+    float MaxScale;
+    float Kp, Ki, Kd;
+    bool Adaptive;      // false: render at full scale, controller paused
+
+    DynamicResolution(float targetMs = 14.0f, float minScale = 0.5f, float maxScale = 1.0f)
+        : TargetMs(targetMs), MinScale(minScale), MaxScale(maxScale), Kp(0.35f), Ki(0.08f), Kd(0.12f), Adaptive(true),
+          fbo(0), colorTexture(0), depthBuffer(0), targetWidth(0), targetHeight(0),
+          windowWidth(0), windowHeight(0), area(maxScale * maxScale), integral(0.0f), lastError(0.0f)
+    {
+    }
+
+    ~DynamicResolution()
+    {
+        if (fbo != 0)
+        {
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteTextures(1, &colorTexture);
+            glDeleteRenderbuffers(1, &depthBuffer);
+        }
+    }
+
+    // binds the offscreen target with the viewport at the current scale and starts timing.
+    // The caller clears and draws as usual.
+    void Begin(int width, int height)
+    {
+        windowWidth = std::max(width, 1);
+        windowHeight = std::max(height, 1);
+        if (windowWidth != targetWidth || windowHeight != targetHeight)
+            resize(windowWidth, windowHeight);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, Width(), Height());
+        timer.Begin();
+    }
+
+    // stops timing and rebinds the default framebuffer. The scale for the next frame is only
+    // picked in Blit(), since the rendered region has to stay valid until it has been presented
+    void End()
+    {
+        timer.End();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, windowWidth, windowHeight);
+    }
+
+    // upscales the rendered region into the default framebuffer
+    void Blit()
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, Width(), Height(), 0, 0, windowWidth, windowHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        Adjust();
+    }
+
+    // picks next frame's scale from the latest timing; Blit() does this, other presenters call it
+    void Adjust()
+    {
+        double ms = timer.LastMs();
+        if (Adaptive && ms >= 0.0)
+            update((float)ms);
+    }
+
+    float Scale() const { return Adaptive ? std::sqrt(area) : 1.0f; }
+    // size of the region the scene was (or will be) rendered into
+    int Width() const { return std::max(1, (int)(windowWidth * Scale() + 0.5f)); }
+    int Height() const { return std::max(1, (int)(windowHeight * Scale() + 0.5f)); }
+    float LastGpuMs() { return (float)timer.LastMs(); }
+
+    // the offscreen target, e.g. for a post pass that reads it instead of the blit
+    GLuint Framebuffer() const { return fbo; }
+    GLuint ColorTexture() const { return colorTexture; }
+    int TargetWidth() const { return targetWidth; }
+    int TargetHeight() const { return targetHeight; }
+
+private:
+    GLuint fbo, colorTexture, depthBuffer;
+    int targetWidth, targetHeight;
+    int windowWidth, windowHeight;
+    GpuTimer timer;
+    float area;         // scale squared
+    float integral;
+    float lastError;
+
+    void resize(int width, int height)
+    {
+        if (fbo == 0)
+        {
+            glGenFramebuffers(1, &fbo);
+            glGenTextures(1, &colorTexture);
+            glGenRenderbuffers(1, &depthBuffer);
+        }
+        glBindTexture(GL_TEXTURE_2D, colorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        targetWidth = width;
+        targetHeight = height;
+    }
+
+    void update(float gpuMs)
+    {
+        float error = (TargetMs - gpuMs) / TargetMs; // positive: headroom, render more pixels
+        float derivative = error - lastError;
+        lastError = error;
+
+        float minArea = MinScale * MinScale, maxArea = MaxScale * MaxScale;
+        float output = Kp * error + Ki * (integral + error) + Kd * derivative;
+        float next = area * (1.0f + output);
+        // only integrate while the scale can still move, so a long stretch at a limit doesn't
+        // wind the integral up and hold the scale there after the load changes
+        if (next > minArea && next < maxArea)
+            integral = std::min(std::max(integral + error, -4.0f), 4.0f);
+        area = std::min(std::max(next, minArea), maxArea);
+    }
+};
+#endif
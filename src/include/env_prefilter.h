@@ -0,0 +1,108 @@
+#ifndef ENV_PREFILTER_H
+#define ENV_PREFILTER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <algorithm>
+
+// GGX prefiltered copy of an environment cubemap, for glossy lookups that stay stable at a
+// distance. Mip level i holds the environment convolved with a GGX lobe of roughness
+// i / (levels - 1), so a sampler picks blur and resolution with the same LOD. Level 0 is a plain
+// copy of the source.
+//
+// The convolution runs once, as a fragment pass per face and level with shader/prefilter.vert
+// and shader/prefilter.frag. It reads the source's own mip chain to keep the sample count low,
+// so the source must be mipmapped (loadCubemap does this).
+const unsigned int PREFILTER_LEVELS = 6;
+
+// number of mip levels a cubemap samples from: the full chain for its level 0, cut short by
+// GL_TEXTURE_MAX_LEVEL (PrefilterCubemap only makes PREFILTER_LEVELS)
+inline unsigned int CubemapLevelCount(unsigned int cubemap)
+{
+    int size = 0, maxLevel = 0;
+    glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &size);
+    glGetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    unsigned int levels = 1;
+    while ((size >> levels) > 0)
+        levels++;
+    return std::min(levels, (unsigned int)maxLevel + 1);
+}
+
+// renders the prefiltered chain of envCubemap with the given prefilter program and returns the
+// new cubemap. size is capped to the source's face size. Leaves the default framebuffer bound.
+inline unsigned int PrefilterCubemap(unsigned int program, unsigned int envCubemap, int size = 512, unsigned int levels = PREFILTER_LEVELS)
+{
+    int sourceSize = 0;
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &sourceSize);
+    if (sourceSize > 0)
+        size = std::min(size, sourceSize);
+    // don't go below 1x1
+    while (levels > 1 && (size >> (levels - 1)) == 0)
+        levels--;
+
+    unsigned int prefiltered;
+    glGenTextures(1, &prefiltered);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, prefiltered);
+    for (unsigned int level = 0; level < levels; level++)
+        for (unsigned int face = 0; face < 6; face++)
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB8, size >> level, size >> level, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+    // the vertex shader makes a fullscreen triangle from gl_VertexID, but core profile still
+    // wants a vertex array bound
+    unsigned int fbo, vao;
+    glGenFramebuffers(1, &fbo);
+    glGenVertexArrays(1, &vao);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glBindVertexArray(vao);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+
+    glUseProgram(program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
+    glUniform1i(glGetUniformLocation(program, "environment"), 0);
+    glUniform1f(glGetUniformLocation(program, "sourceSize"), (float)(sourceSize > 0 ? sourceSize : size));
+    GLint faceLocation = glGetUniformLocation(program, "face");
+    GLint roughnessLocation = glGetUniformLocation(program, "roughness");
+    GLint faceSizeLocation = glGetUniformLocation(program, "faceSize");
+
+    for (unsigned int level = 0; level < levels; level++)
+    {
+        int levelSize = size >> level;
+        glViewport(0, 0, levelSize, levelSize);
+        glUniform1f(roughnessLocation, levels > 1 ? (float)level / (float)(levels - 1) : 0.0f);
+        glUniform1f(faceSizeLocation, (float)levelSize);
+        for (unsigned int face = 0; face < 6; face++)
+        {
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, prefiltered, level);
+            glUniform1i(faceLocation, face);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindVertexArray(0);
+    glDeleteVertexArrays(1, &vao);
+    glDeleteFramebuffers(1, &fbo);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+    if (blend)
+        glEnable(GL_BLEND);
+    return prefiltered;
+}
+#endif
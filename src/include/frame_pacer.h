@@ -0,0 +1,158 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <thread>
+
+// Frame pacing and latency tools for the low-latency mode.
+//
+// Latency from input to the screen is mostly queueing: frames the CPU has submitted ahead of
+// the GPU, and a swap chain full of finished frames waiting for vblank. The low-latency mode
+// keeps both queues empty with a frame limiter that waits at the start of the frame (so input
+// is read after the wait, not before it) and by finishing each frame before starting the next.
+
+enum Swap_Mode {
+    SWAP_VSYNC,         // wait for vblank
+    SWAP_ADAPTIVE,      // wait for vblank unless the frame is late, then tear instead of stalling
+    SWAP_IMMEDIATE,     // never wait
+    SWAP_MODE_COUNT
+};
+
+inline const char* SwapModeName(Swap_Mode mode)
+{
+    static const char* names[SWAP_MODE_COUNT] = { "vsync", "adaptive vsync", "no vsync" };
+    return names[mode];
+}
+
+// sets the swap interval for mode on the current context and returns the mode in effect;
+// adaptive vsync falls back to plain vsync without EXT_swap_control_tear
+inline Swap_Mode ApplySwapMode(Swap_Mode mode)
+{
+    if (mode == SWAP_ADAPTIVE && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+        mode = SWAP_VSYNC;
+    glfwSwapInterval(mode == SWAP_VSYNC ? 1 : mode == SWAP_ADAPTIVE ? -1 : 0);
+    return mode;
+}
+
+// Caps the frame rate by waiting out the rest of each frame interval. Sleeping is cheap but
+// wakes up late by up to a scheduler tick, so Wait() sleeps until SpinMs before the deadline
+// and busy-waits the remainder.
+class FramePacer {
+public:
+    float TargetFps;    // 0 for no limit
+    float SpinMs;       // tail of the wait that is spun rather than slept
+
+    FramePacer(float targetFps = 0.0f, float spinMs = 2.0f)
+        : TargetFps(targetFps), SpinMs(spinMs), next(clock::now())
+    {
+    }
+
+    // blocks until the next frame may start; call at the top of the frame
+    void Wait()
+    {
+        if (TargetFps <= 0.0f)
+        {
+            next = clock::now();
+            return;
+        }
+        clock::duration interval = std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(1.0 / TargetFps));
+        next += interval;
+        clock::time_point now = clock::now();
+        // more than a frame behind (a hitch, or the limit was just raised): start over from now
+        // rather than rushing through frames to catch up
+        if (next < now - interval)
+            next = now;
+
+        clock::time_point sleepUntil = next - std::chrono::duration_cast<clock::duration>(std::chrono::duration<double, std::milli>(SpinMs));
+        if (now < sleepUntil)
+            std::this_thread::sleep_until(sleepUntil);
+        while (clock::now() < next)
+            ;
+    }
+
+private:
+    typedef std::chrono::steady_clock clock;
+    clock::time_point next;
+};
+
+// Measures the time from reading input to the GPU finishing the frame built from it, which is
+// when the swap can present it (a lower bound with vsync, where it may still wait for vblank).
+// A GL_TIMESTAMP query after the swap marks the finish; GPU timestamps are mapped onto the CPU
+// clock with an offset taken each frame. Results are read a few frames late without stalling.
+class LatencyMeter {
+public:
+    LatencyMeter() : next(0), averageMs(-1.0f), created(false) {}
+
+    ~LatencyMeter()
+    {
+        if (created)
+            glDeleteQueries(RING, queries);
+    }
+
+    // call when input for the frame has been read
+    void InputSampled()
+    {
+        inputTime = glfwGetTime();
+        // pair a GPU and a CPU timestamp to convert later results
+        GLint64 gpuNow = 0;
+        glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+        offset = glfwGetTime() - (double)gpuNow * 1e-9;
+    }
+
+    // call right after the swap
+    void Presented()
+    {
+        if (!created)
+        {
+            glGenQueries(RING, queries);
+            for (unsigned int i = 0; i < RING; i++)
+                pending[i] = false;
+            created = true;
+        }
+        collect();
+        if (pending[next])
+            return; // every slot is in flight; skip this frame rather than wait
+        glQueryCounter(queries[next], GL_TIMESTAMP);
+        inputTimes[next] = inputTime;
+        offsets[next] = offset;
+        pending[next] = true;
+        next = (next + 1) % RING;
+    }
+
+    // smoothed input to finish latency in milliseconds, negative until the first result
+    float AverageMs() const { return averageMs; }
+
+private:
+    static const unsigned int RING = 4;
+    GLuint queries[RING];
+    bool pending[RING];
+    double inputTimes[RING];
+    double offsets[RING];
+    unsigned int next;
+    double inputTime;
+    double offset;
+    float averageMs;
+    bool created;
+
+    void collect()
+    {
+        for (unsigned int i = 0; i < RING; i++)
+        {
+            if (!pending[i])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                continue;
+            GLuint64 finished = 0;
+            glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &finished);
+            pending[i] = false;
+            float ms = (float)(((double)finished * 1e-9 + offsets[i] - inputTimes[i]) * 1000.0);
+            averageMs = averageMs < 0.0f ? ms : averageMs * 0.9f + ms * 0.1f;
+        }
+    }
+};
+#endif
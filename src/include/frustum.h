@@ -0,0 +1,57 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// The six planes of a view volume, pulled out of a projection * view matrix (Gribb and
+// Hartmann). Normals point inwards and are normalized, so a plane evaluates to the signed
+// distance of a point from it.
+struct Frustum {
+    enum Plane { LEFT, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, PLANE_COUNT };
+
+    glm::vec4 planes[PLANE_COUNT];
+
+    static Frustum FromMatrix(const glm::mat4 &m)
+    {
+        // rows of m; glm stores columns
+        glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+        glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+        glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+        glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+        Frustum f;
+        f.planes[LEFT] = row3 + row0;
+        f.planes[RIGHT] = row3 - row0;
+        f.planes[BOTTOM] = row3 + row1;
+        f.planes[TOP] = row3 - row1;
+        f.planes[NEAR_PLANE] = row3 + row2;
+        f.planes[FAR_PLANE] = row3 - row2;
+        for (int i = 0; i < PLANE_COUNT; i++)
+            f.planes[i] = f.planes[i] / glm::length(glm::vec3(f.planes[i]));
+        return f;
+    }
+
+    // conservative: a box near a corner of the frustum may pass without being inside
+    bool IntersectsBox(const glm::vec3 &lo, const glm::vec3 &hi) const
+    {
+        for (int i = 0; i < PLANE_COUNT; i++)
+        {
+            // the box corner furthest along the plane normal
+            glm::vec3 p(planes[i].x >= 0.0f ? hi.x : lo.x,
+                        planes[i].y >= 0.0f ? hi.y : lo.y,
+                        planes[i].z >= 0.0f ? hi.z : lo.z);
+            if (glm::dot(glm::vec3(planes[i]), p) + planes[i].w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+    bool IntersectsSphere(const glm::vec3 &center, float radius) const
+    {
+        for (int i = 0; i < PLANE_COUNT; i++)
+            if (glm::dot(glm::vec3(planes[i]), center) + planes[i].w < -radius)
+                return false;
+        return true;
+    }
+};
+#endif
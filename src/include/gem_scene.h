@@ -0,0 +1,625 @@
+#ifndef GEM_SCENE_H
+#define GEM_SCENE_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+#include "filesystem.h"
+
+using namespace std;
+
+// Scene description shared by the OpenGL renderer and the CPU renderers: gem geometry,
+// placement, colors and the material/light values gem.frag is driven with.
+
+//lighting
+//glm::vec3 lightPos(1.2f, 0.2f, 2.0f);
+const glm::vec3 lightPos(-7.5f, 2.0f, -10.0f);
+
+
+// diamond dimensions (each from origin)
+const float innerRadius = 0.5f;
+const float outerRadius = 0.7f;
+const float outerHeight = 0.35f;
+const float innerHeight = 0.5f;
+const float pointHeight = -0.5f;
+
+const float sqrt3 = sqrt(3);
+const glm::vec2 innerCorner = glm::vec2(innerRadius / 2, sqrt3 * innerRadius / 2);
+const glm::vec2 outerCorner = glm::vec2(outerRadius / 2, sqrt3 * outerRadius / 2);
+
+// assists with calculation of midpoints
+const glm::vec2 midCorner = glm::vec2((outerCorner.x + outerRadius) / 2, outerCorner.y / 2);
+
+// Normals
+const glm::vec3 midNormal = glm::normalize(glm::vec3(sqrt3 * 21.0f / 400.0f, sqrt3 * 7.0f / 100.0f, 21.0f / 400.0f));
+const glm::vec3 midCenterNormal = glm::normalize(glm::vec3(0.0f, sqrt3 / 20.0f, 0.075f));
+const glm::vec3 bottomNormal = glm::normalize(glm::vec3(sqrt3 * 119.0f / 400.0f, sqrt3 * -49.0f / 200.0f, 119.0f / 400.0f));
+const glm::vec3 bottomCenterNormal = glm::normalize(glm::vec3(0.0f, sqrt3 * -0.245f, 0.595f));
+
+// for calculating gem locations
+const float PI = 3.1415926f;
+const float gemDist = 2.5f;
+
+// gem colors,locations
+inline map<int, glm::vec3> makeGemLocations()
+{
+    return map<int, glm::vec3> {
+    {0, glm::vec3(0.0f, 0.0f, gemDist)},
+    {1, glm::vec3(gemDist *  sin(2 * PI / 7), 0.0f, gemDist * cos(2 * PI / 7))},
+    {2, glm::vec3(gemDist *  sin(4 * PI / 7), 0.0f, gemDist * cos(4 * PI / 7))},
+    {3, glm::vec3(gemDist *  sin(6 * PI / 7), 0.0f, gemDist * cos(6 * PI / 7))},
+    {4, glm::vec3(gemDist * -sin(6 * PI / 7), 0.0f, gemDist * cos(6 * PI / 7))},
+    {5, glm::vec3(gemDist * -sin(4 * PI / 7), 0.0f, gemDist * cos(4 * PI / 7))},
+    {6, glm::vec3(gemDist * -sin(2 * PI / 7), 0.0f, gemDist * cos(2 * PI / 7))},
+    };
+}
+
+const float colorMult = 2.1f;
+
+// layout of fields written with --write-field
+const float fieldSpacing = 2.0f;
+const float fieldChunkSize = 32.0f;
+
+const glm::vec3 colors[7] = {
+    glm::vec3(1.0f, 0.0f, 0.0f),
+    glm::vec3(1.0f, 1.0f, 0.0f),
+    glm::vec3(0.0f, 1.0f, 0.0f),
+    glm::vec3(0.0f, 1.0f, 1.0f),
+    glm::vec3(0.0f, 0.0f, 1.0f),
+    glm::vec3(1.0f, 0.0f, 1.0f),
+    glm::vec3(1.0f, 1.0f, 1.0f),
+};
+
+// gem material (emerald) and light, as passed to gem.frag
+const glm::vec3 materialAmbient = glm::vec3(0.0f, 0.1f, 0.06f);
+const glm::vec3 materialDiffuse = glm::vec3(0.07568f, 0.61424f, 0.07568f);
+const glm::vec3 materialSpecular = glm::vec3(0.633f, 0.727811f, 0.633f);
+const float materialShininess = 6.0f;
+const float materialRoughness = 0.0f; // environment blur in [0, 1], polished by default
+
+const glm::vec3 lightColor = glm::vec3(1.0, 1.0, 1.0);
+const glm::vec3 lightDiffuse = lightColor * glm::vec3(0.5f); //decrease the influence
+const glm::vec3 lightAmbient = lightDiffuse * glm::vec3(0.2f); //low influence
+const glm::vec3 lightSpecular = glm::vec3(1.0, 1.0, 1.0);
+
+// constants hard-coded in gem.frag
+const float reflectRefractRatio = 0.8f;
+const float lightingResistance = 0.6f;
+const float opacity = 0.7f;
+const float refractionRatio = 1.00f / 1.58f; // Emerald
+
+// Shading tiers of gem.frag (see the SHADE_* defines there), cheapest last
+enum Shade_Tier {
+    SHADE_FULL = 0,
+    SHADE_SINGLE,
+    SHADE_FACE,
+    SHADE_TIER_COUNT
+};
+
+// projected gem radius in pixels below which the cheaper tiers take over
+const float shadeSingleRadius = 48.0f;
+const float shadeFaceRadius = 12.0f;
+
+// tier for a gem at distance from the camera, from its projected radius; pixelSpread is the
+// world size of a pixel at distance 1 (2 tan(fovY / 2) / viewport height)
+inline Shade_Tier gemShadeTier(float distance, float pixelSpread)
+{
+    float radius = outerRadius / (std::max(distance, 1e-4f) * pixelSpread);
+    if (radius >= shadeSingleRadius)
+        return SHADE_FULL;
+    if (radius >= shadeFaceRadius)
+        return SHADE_SINGLE;
+    return SHADE_FACE;
+}
+
+// a gem as drawn this frame, from the ring or a streamed field
+struct GemInstance {
+    glm::mat4 model;        // ring gems; a field gem's is built when it is drawn
+    glm::vec3 position;     // in world space, for the spatial grid, distance sorting and LOD
+    glm::vec3 color;
+    float phase;            // field gems: spin offset and size
+    float scale;
+};
+
+// orbit around the origin, move to the gem's position, then spin the gem in place
+inline glm::mat4 gemModelMatrix(const glm::vec3 &gemPos, float revolveOffset, float angle)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    // Rotating first makes them all orbit around the origin
+    model = glm::rotate(model, revolveOffset, glm::vec3(0.0f, 1.0f, 0.0f));
+    model = glm::translate(model, gemPos); // move to initial position
+    model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+    return model;
+}
+
+// field gems stay where they are and spin from their own phase
+inline glm::mat4 fieldGemModelMatrix(const GemInstance &gem, float angle)
+{
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), gem.position);
+    model = glm::rotate(model, angle + gem.phase, glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::scale(model, glm::vec3(gem.scale));
+}
+
+// skybox faces in cubemap order (+X, -X, +Y, -Y, +Z, -Z)
+inline vector<std::string> skyboxFaces()
+{
+    return vector<std::string>
+    {
+        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_right.png"),
+        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_left.png"),
+        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_up.png"),
+        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_down.png"),
+        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_front.png"),
+        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_back.png")
+    };
+}
+
+/// 6-sided gem
+/// "right" = +x, "up" = +y, "front" = +z
+const float gemVertices[] = {
+    //positions
+        //normals
+
+    //-innerRadius / 2, innerHeight, -sqrt3 * innerRadius / 2,  // left top back
+    //-innerRadius / 2, innerHeight,  sqrt3* innerRadius / 2,  // left top front
+    // innerRadius / 2, innerHeight, -sqrt3 * innerRadius / 2,  // right top back
+    // innerRadius / 2, innerHeight,  sqrt3* innerRadius / 2,  // right top front
+
+    //-outerRadius / 2, outerHeight, -sqrt3 * outerRadius / 2,  // left top back
+    //-outerRadius / 2, outerHeight,  sqrt3* outerRadius / 2,  // left top front
+    // outerRadius / 2, outerHeight, -sqrt3 * outerRadius / 2,  // right top back
+    // outerRadius / 2, outerHeight,  sqrt3* outerRadius / 2,  // right top front
+
+    //////////////////////////// LIST OF VERTICES /////////////////////////////////
+    
+    ///// top (hexagon)
+    //-innerRadius, innerHeight, 0.0f,  // left top center (inner)
+    //-innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+    //-innerCorner.x, innerHeight,  innerCorner.y,  // left top front
+    // innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+    // innerCorner.x, innerHeight,  innerCorner.y,  // right top front
+    // innerRadius, innerHeight, 0.0f,  // right top center
+
+    ///// Sides
+    //-outerRadius, outerHeight, 0.0f,  // left side center
+    //-outerCorner.x, outerHeight, -outerCorner.y,  // left side back
+    //-outerCorner.x, outerHeight,  outerCorner.y,  // left side front
+    // outerCorner.x, outerHeight, -outerCorner.y,  // right side back
+    // outerCorner.x, outerHeight,  outerCorner.y,  // right side front
+    // outerRadius, outerHeight, 0.0f,  // right side center
+
+    ///// Bottom point
+    //0.0f, pointHeight, 0.0f,  // bottom center point
+
+    ///// Midpoints; used for setting up the inner triangles of a face
+    //-midCorner.x, outerHeight, -midCorner.y,  // leftish side backish
+    // 0.0f, outerHeight, -outerCorner.y,  // center side back
+    // midCorner.x, outerHeight, -midCorner.y,  // rightish side backish
+    // midCorner.x, outerHeight,  midCorner.y,  // rightish side frontish
+    // 0.0f, outerHeight, outerCorner.y,  // center side front
+    //-midCorner.x, outerHeight,  midCorner.y,  // leftish side frontish
+
+    ///////////////////////////////////////////////////////////////////////////////
+
+    /// Face: top (hexagon)
+    // Tri: left
+    -innerRadius, innerHeight, 0.0f,  // left top center
+        0.0f, 1.0f, 0.0f,  // normal pointing up
+    -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+        0.0f, 1.0f, 0.0f,
+    -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
+        0.0f, 1.0f, 0.0f,
+    // Tri: left center back
+    -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
+        0.0f, 1.0f, 0.0f,
+    -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+        0.0f, 1.0f, 0.0f,
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+        0.0f, 1.0f, 0.0f,
+    // Tri: right center front
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+        0.0f, 1.0f, 0.0f,
+    -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
+        0.0f, 1.0f, 0.0f,
+     innerCorner.x, innerHeight,  innerCorner.y,  // right top front
+        0.0f, 1.0f, 0.0f,
+    // Tri: right
+     innerCorner.x, innerHeight,  innerCorner.y,  // right top front
+        0.0f, 1.0f, 0.0f,
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+        0.0f, 1.0f, 0.0f,
+     innerRadius, innerHeight, 0.0f,  // right top center
+        0.0f, 1.0f, 0.0f,
+
+    /// Face: left upper side back
+    // Tri: leftest lower backish
+    -innerRadius, innerHeight, 0.0f,  // left top center
+        //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
+        -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
+    -outerRadius, outerHeight, 0.0f,  // left side center
+        //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
+        -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
+    -midCorner.x, outerHeight, -midCorner.y,  // leftish side backish
+        //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
+        -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
+    // Tri: lefter upper backisher
+    -midCorner.x, outerHeight, -midCorner.y,  // leftish side backish
+        //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
+        -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
+    -innerRadius, innerHeight, 0.0f,  // left top center
+        //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
+        -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
+    -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+        //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
+        -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
+    // Tri: leftish lower backerest
+    -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+        //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
+        -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
+    -midCorner.x, outerHeight, -midCorner.y,  // leftish side backish
+        //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
+        -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
+    -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
+        //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
+        -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
+    
+    /// Face: center upper side back
+    // Tri: left lower back
+    -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
+        //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
+        0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
+    -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+        //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
+        0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
+     0.0f, outerHeight, -outerCorner.y,  // center side back
+        //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
+        0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
+    // Tri: center upper back
+     0.0f, outerHeight, -outerCorner.y,  // center side back
+        //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
+        0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
+    -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+        //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
+        0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+        //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
+        0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
+    // Tri: right lower back
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+        //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
+        0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
+     0.0f, outerHeight, -outerCorner.y,  // center side back
+        //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
+        0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
+     outerCorner.x, outerHeight, -outerCorner.y,  // right side back
+        //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
+        0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
+    
+    /// Face: right upper side back
+    // Tri: rightish lower backerest
+     outerCorner.x, outerHeight, -outerCorner.y,  // right side back
+        //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
+        midNormal.x, midNormal.y, -midNormal.z,  // right upper back
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+        //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
+        midNormal.x, midNormal.y, -midNormal.z,  // right upper back
+     midCorner.x, outerHeight, -midCorner.y,  // rightish side backish
+        //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
+        midNormal.x, midNormal.y, -midNormal.z,  // right upper back
+    // Tri: right upper backer
+     midCorner.x, outerHeight, -midCorner.y,  // rightish side backish
+        //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
+        midNormal.x, midNormal.y, -midNormal.z,  // right upper back
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+        //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
+        midNormal.x, midNormal.y, -midNormal.z,  // right upper back
+     innerRadius, innerHeight, 0.0f,  // right top center
+        //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
+        midNormal.x, midNormal.y, -midNormal.z,  // right upper back
+    // Tri: rightest lower backish
+     innerRadius, innerHeight, 0.0f,  // right top center
+        //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
+        midNormal.x, midNormal.y, -midNormal.z,  // right upper back
+     midCorner.x, outerHeight, -midCorner.y,  // rightish side backish
+        //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
+         midNormal.x, midNormal.y, -midNormal.z,  // right upper back
+     outerRadius, outerHeight, 0.0f,  // right side center
+        //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
+         midNormal.x, midNormal.y, -midNormal.z,  // right upper back
+    
+    /// Face: right upper side front
+    // Tri: rightest lower frontish
+     outerRadius, outerHeight, 0.0f,  // right side center
+        //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
+        midNormal.x, midNormal.y, midNormal.z,  // right upper front
+     innerRadius, innerHeight, 0.0f,  // right top center
+        //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
+        midNormal.x, midNormal.y, midNormal.z,  // right upper front
+     midCorner.x, outerHeight, midCorner.y,  // rightish side frontish
+        //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
+        midNormal.x, midNormal.y, midNormal.z,  // right upper front
+    // Tri: righter upper fronter
+     midCorner.x, outerHeight, midCorner.y,  // rightish side frontish
+        //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
+        midNormal.x, midNormal.y, midNormal.z,  // right upper front
+     innerRadius, innerHeight, 0.0f,  // right top center
+        //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
+        midNormal.x, midNormal.y, midNormal.z,  // right upper front
+     innerCorner.x, innerHeight, innerCorner.y,  // right top front
+        //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
+        midNormal.x, midNormal.y, midNormal.z,  // right upper front
+    // Tri: rightish lower fronterest
+     innerCorner.x, innerHeight, innerCorner.y,  // right top front
+        //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
+        midNormal.x, midNormal.y, midNormal.z,  // right upper front
+     midCorner.x, outerHeight, midCorner.y,  // rightish side frontish
+        //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
+        midNormal.x, midNormal.y, midNormal.z,  // right upper front
+     outerCorner.x, outerHeight, outerCorner.y,  // right side front
+        //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
+        midNormal.x, midNormal.y, midNormal.z,  // right upper front
+    
+    /// Face: center upper side front
+    // Tri: rightish lower side front
+     outerCorner.x, outerHeight, outerCorner.y,  // right side front
+        //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
+        0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
+     innerCorner.x, innerHeight, innerCorner.y,  // right top front
+        //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
+        0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
+     0.0f, outerHeight, outerCorner.y,  // center side front
+         //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
+        0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
+    // Tri: center upper side front
+     0.0f, outerHeight, outerCorner.y,  // center side front
+        //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
+        0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
+     innerCorner.x, innerHeight, innerCorner.y,  // right top front
+        //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
+         0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
+     -innerCorner.x, innerHeight, innerCorner.y,  // left top front
+         //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
+        0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
+    // Tri: leftish lower side front
+     -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
+        //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
+        0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
+     0.0f, outerHeight, outerCorner.y,  // center side front
+        //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
+        0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
+     -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
+        //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
+        0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
+    
+    /// Face: left upper side front
+    // Tri: leftish lower side fronterest
+     -outerCorner.x, outerHeight, outerCorner.y,  // left side front
+        //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
+        -midNormal.x, midNormal.y, midNormal.z,  // left upper front
+     -innerCorner.x, innerHeight, innerCorner.y,  // left top front
+        //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
+        -midNormal.x, midNormal.y, midNormal.z,  // left upper front
+     -midCorner.x, outerHeight, midCorner.y,  // leftish side frontish
+        //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
+        -midNormal.x, midNormal.y, midNormal.z,  // left upper front
+    // Tri: lefter upper side fronter
+     -midCorner.x, outerHeight, midCorner.y,  // leftish side frontish
+        //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
+        -midNormal.x, midNormal.y, midNormal.z,  // left upper front
+     -innerCorner.x, innerHeight, innerCorner.y,  // left top front
+        //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
+        -midNormal.x, midNormal.y, midNormal.z,  // left upper front
+     -innerRadius, innerHeight, 0.0f,  // left top center (inner)
+        //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
+        -midNormal.x, midNormal.y, midNormal.z,  // left upper front
+    // Tri: leftest lower side frontish
+     -innerRadius, innerHeight, 0.0f,  // left top center (inner)
+        //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
+        -midNormal.x, midNormal.y, midNormal.z,  // left upper front
+     -midCorner.x, outerHeight, midCorner.y,  // leftish side frontish
+        //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
+        -midNormal.x, midNormal.y, midNormal.z,  // left upper front
+     -outerRadius, outerHeight, 0.0f,  // left side center
+        //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
+        -midNormal.x, midNormal.y, midNormal.z,  // left upper front
+
+    /// Faces: lower sides
+    // Face: left lower back
+    -outerRadius, outerHeight, 0.0f,  // left side center
+        //-0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL left lower back
+        -bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // left lower back
+    -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
+        //-0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL left lower back
+        -bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // left lower back
+    0.0f, pointHeight, 0.0f,  // bottom center point
+        //-0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL left lower back
+        -bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // left lower back
+    // Face: center lower back
+    -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
+        //0.0f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL center lower back
+        0.0f, bottomCenterNormal.y, -bottomCenterNormal.z,  // center lower back
+     outerCorner.x, outerHeight, -outerCorner.y,  // right side back
+        //0.0f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL center lower back
+        0.0f, bottomCenterNormal.y, -bottomCenterNormal.z,  // center lower back
+    0.0f, pointHeight, 0.0f,  // bottom center point
+        //0.0f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL center lower back
+        0.0f, bottomCenterNormal.y, -bottomCenterNormal.z,  // center lower back
+    // Face: right lower back
+     outerCorner.x, outerHeight, -outerCorner.y,  // right side back
+         //0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL right lower back
+        bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // right lower back
+     outerRadius, outerHeight, 0.0f,  // right side center
+         //0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL right lower back
+        bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // right lower back
+     0.0f, pointHeight, 0.0f,  // bottom center point
+         //0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL right lower back
+        bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // right lower back
+    // Face: right lower front
+     outerRadius, outerHeight, 0.0f,  // right side center
+         //0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL right lower front
+        bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
+     outerCorner.x, outerHeight,  outerCorner.y,  // right side front
+         //0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL right lower front
+        bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
+     0.0f, pointHeight, 0.0f,  // bottom center point
+         //0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL right lower front
+        bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
+    // Face: center lower front
+     outerCorner.x, outerHeight,  outerCorner.y,  // right side front
+        //0.0f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL center lower front
+        0.0f, bottomCenterNormal.y, bottomCenterNormal.z,  // right lower front
+    -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
+        //0.0f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL center lower front
+        0.0f, bottomCenterNormal.y, bottomCenterNormal.z,  // right lower front
+     0.0f, pointHeight, 0.0f,  // bottom center point
+        //0.0f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL center lower front
+        0.0f, bottomCenterNormal.y, bottomCenterNormal.z,  // right lower front
+    // Face: left lower front
+    -outerCorner.x, outerHeight, outerCorner.y,  // left side front
+         //-0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL left lower front
+        -bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
+    -outerRadius, outerHeight, 0.0f,  // left side center
+         //-0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL left lower front
+        -bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
+    0.0f, pointHeight, 0.0f,  // bottom center point
+         //-0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL left lower front
+        -bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
+
+};
+const float gemEdges[] = {
+    /// top (hexagon)
+    // Edge: left back
+    -innerRadius, innerHeight, 0.0f,  // left top center
+    -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+    // Edge: back
+    -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+    // Edge: right back
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+     innerRadius, innerHeight, 0.0f,  // right top center
+    // Edge: right front
+     innerRadius, innerHeight, 0.0f,  // right top center
+     innerCorner.x, innerHeight,  innerCorner.y,  // right top front
+    // Edge: front
+     innerCorner.x, innerHeight,  innerCorner.y,  // right top front
+    -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
+    // Edge: left front
+    -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
+    -innerRadius, innerHeight, 0.0f,  // left top center
+
+    /// upper sides (verticals)
+    // Edge: left center
+    -innerRadius, innerHeight, 0.0f,  // left top center
+    -outerRadius, outerHeight, 0.0f,  // left side center
+    // Edge: left back
+    -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
+    -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
+    // Edge: right back
+     innerCorner.x, innerHeight, -innerCorner.y,  // right top back
+     outerCorner.x, outerHeight, -outerCorner.y,  // right side back
+    // Edge: right center
+     innerRadius, innerHeight, 0.0f,  // right top center
+     outerRadius, outerHeight, 0.0f,  // right side center
+    // Edge: right front
+     innerCorner.x, innerHeight,  innerCorner.y,  // right top front
+     outerCorner.x, outerHeight,  outerCorner.y,  // right side front
+    // Edge: left front
+    -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
+    -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
+
+    /// sides (horizontals)
+    // Edge: left side back
+    -outerRadius, outerHeight, 0.0f,  // left side center
+    -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
+    // Edge: center side back
+    -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
+     outerCorner.x, outerHeight, -outerCorner.y,  // right side back
+    // Edge: right side back
+     outerCorner.x, outerHeight, -outerCorner.y,  // right side back
+     outerRadius, outerHeight, 0.0f,  // right side center
+    // Edge: right side front
+     outerRadius, outerHeight, 0.0f,  // right side center
+     outerCorner.x, outerHeight,  outerCorner.y,  // right side front
+    // Edge: center side front
+     outerCorner.x, outerHeight,  outerCorner.y,  // right side front
+    -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
+    // Edge: left side front
+    -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
+    -outerRadius, outerHeight, 0.0f,  // left side center
+
+    /// lower sides
+    // Edge: left lower center
+    -outerRadius, outerHeight, 0.0f,  // left side center
+     0.0f, pointHeight, 0.0f,  // bottom center point
+    // Edge: left lower back
+     0.0f, pointHeight, 0.0f,  // bottom center point
+    -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
+    // Edge: right lower back
+     outerCorner.x, outerHeight, -outerCorner.y,  // right side back
+     0.0f, pointHeight, 0.0f,  // bottom center point
+    // Edge: right lower center
+     0.0f, pointHeight, 0.0f,  // bottom center point
+     outerRadius, outerHeight, 0.0f,  // right side center
+    // Edge: right lower front
+     outerCorner.x, outerHeight,  outerCorner.y,  // right side front
+     0.0f, pointHeight, 0.0f,  // bottom center point
+    // Edge: left lower front
+     0.0f, pointHeight, 0.0f,  // bottom center point
+    -outerCorner.x, outerHeight, outerCorner.y,  // left side front
+};
+
+const float skyboxVertices[] = {
+    // positions          
+    -1.0f,  1.0f, -1.0f,
+    -1.0f, -1.0f, -1.0f,
+     1.0f, -1.0f, -1.0f,
+     1.0f, -1.0f, -1.0f,
+     1.0f,  1.0f, -1.0f,
+    -1.0f,  1.0f, -1.0f,
+
+    -1.0f, -1.0f,  1.0f,
+    -1.0f, -1.0f, -1.0f,
+    -1.0f,  1.0f, -1.0f,
+    -1.0f,  1.0f, -1.0f,
+    -1.0f,  1.0f,  1.0f,
+    -1.0f, -1.0f,  1.0f,
+
+     1.0f, -1.0f, -1.0f,
+     1.0f, -1.0f,  1.0f,
+     1.0f,  1.0f,  1.0f,
+     1.0f,  1.0f,  1.0f,
+     1.0f,  1.0f, -1.0f,
+     1.0f, -1.0f, -1.0f,
+
+    -1.0f, -1.0f,  1.0f,
+    -1.0f,  1.0f,  1.0f,
+     1.0f,  1.0f,  1.0f,
+     1.0f,  1.0f,  1.0f,
+     1.0f, -1.0f,  1.0f,
+    -1.0f, -1.0f,  1.0f,
+
+    -1.0f,  1.0f, -1.0f,
+     1.0f,  1.0f, -1.0f,
+     1.0f,  1.0f,  1.0f,
+     1.0f,  1.0f,  1.0f,
+    -1.0f,  1.0f,  1.0f,
+    -1.0f,  1.0f, -1.0f,
+
+    -1.0f, -1.0f, -1.0f,
+    -1.0f, -1.0f,  1.0f,
+     1.0f, -1.0f, -1.0f,
+     1.0f, -1.0f, -1.0f,
+    -1.0f, -1.0f,  1.0f,
+     1.0f, -1.0f,  1.0f
+};
+
+const int gemVertexCount = sizeof(gemVertices) / (6 * sizeof(float));
+const int gemEdgeVertexCount = sizeof(gemEdges) / (3 * sizeof(float));
+const int skyboxVertexCount = sizeof(skyboxVertices) / (3 * sizeof(float));
+
+#endif
@@ -0,0 +1,366 @@
+#ifndef GEOMETRY_POOL_H
+#define GEOMETRY_POOL_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "mesh.h"
+
+using namespace std;
+
+// layout glMultiDrawElementsIndirect reads from GL_DRAW_INDIRECT_BUFFER
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+// per-draw data in the shader storage buffer, std430 layout (see shader/mesh_mdi.vert)
+struct PoolDrawData {
+    glm::mat4 model;
+    GLuint material;        // index into the batch's texture_diffuse[] / texture_specular[]
+    GLuint pad[3];
+};
+
+// Packs the meshes of any number of Models into one vertex buffer and one index buffer, and
+// draws them with one glMultiDrawElementsIndirect per batch of up to POOL_BATCH_MATERIALS
+// materials. Shaders find their draw's model matrix and material through gl_DrawID; see
+// shader/mesh_mdi.vert and shader/mesh_mdi.frag.
+//
+// Models join a pool through Model::UsePool, after which Model::Draw draws from it.
+//
+// Needs OpenGL 4.6 (multi-draw indirect, vertex attribute binding, SSBOs and gl_DrawID); check
+// Supported() and fall back to drawing mesh by mesh otherwise. Only VERTEX_FULL meshes are pooled, and
+// only their first diffuse and specular map take part in the material.
+const unsigned int POOL_BATCH_MATERIALS = 8;
+
+class GeometryPool {
+public:
+    GeometryPool() : VAO(0), VBO(0), EBO(0), indirectBuffer(0), drawBuffer(0),
+                     vertexCapacity(0), vertexCount(0), indexCapacity(0), indexCount(0), dirty(false)
+    {
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        // attribute formats live in the VAO; the buffer behind binding 0 can be swapped when the pool grows
+        glEnableVertexAttribArray(0);
+        glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Position));
+        glVertexAttribBinding(0, 0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribFormat(1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal));
+        glVertexAttribBinding(1, 0);
+        glEnableVertexAttribArray(2);
+        glVertexAttribFormat(2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords));
+        glVertexAttribBinding(2, 0);
+        glEnableVertexAttribArray(3);
+        glVertexAttribFormat(3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Tangent));
+        glVertexAttribBinding(3, 0);
+        glEnableVertexAttribArray(4);
+        glVertexAttribFormat(4, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Bitangent));
+        glVertexAttribBinding(4, 0);
+        glBindVertexArray(0);
+
+        glGenBuffers(1, &indirectBuffer);
+        glGenBuffers(1, &drawBuffer);
+    }
+
+    ~GeometryPool()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        glDeleteBuffers(1, &indirectBuffer);
+        glDeleteBuffers(1, &drawBuffer);
+    }
+
+    static bool Supported()
+    {
+        return GLAD_GL_VERSION_4_6 != 0;
+    }
+
+    // copies a model's meshes into the pool's buffers on the GPU and returns a handle for
+    // SetTransform and DrawModel. The meshes keep their own buffers and can still be drawn alone.
+    unsigned int AddMeshes(const vector<Mesh> &meshes, const glm::mat4 &transform = glm::mat4(1.0f))
+    {
+        ModelRange range;
+        range.firstDraw = (unsigned int)draws.size();
+
+        size_t addVertices = 0, addIndices = 0;
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if (meshes[i].format != VERTEX_FULL)
+                continue;
+            addVertices += meshes[i].vertexCount;
+            addIndices += meshes[i].indexCount;
+        }
+        reserve(vertexCount + addVertices, indexCount + addIndices);
+
+        glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            const Mesh &mesh = meshes[i];
+            if (mesh.format != VERTEX_FULL)
+            {
+                cout << "WARNING::GEOMETRY_POOL:: skipping a mesh that isn't VERTEX_FULL" << endl;
+                continue;
+            }
+            glBindBuffer(GL_COPY_READ_BUFFER, mesh.VertexBuffer());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, vertexCount * sizeof(Vertex), mesh.vertexCount * sizeof(Vertex));
+
+            DrawElementsIndirectCommand command;
+            command.count = mesh.indexCount;
+            command.instanceCount = 1;
+            command.firstIndex = (GLuint)indexCount;
+            command.baseVertex = (GLint)vertexCount;
+            command.baseInstance = 0;
+            commands.push_back(command);
+
+            PoolDrawData draw;
+            draw.model = transform;
+            draw.material = materialSlot(mesh);
+            draw.pad[0] = draw.pad[1] = draw.pad[2] = 0;
+            draws.push_back(draw);
+            batches.back().drawCount++;
+
+            vertexCount += mesh.vertexCount;
+            indexCount += mesh.indexCount;
+        }
+        // indices stay relative to their mesh; baseVertex offsets them
+        glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+        size_t indexOffset = range.firstDraw < commands.size() ? commands[range.firstDraw].firstIndex : indexCount;
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            const Mesh &mesh = meshes[i];
+            if (mesh.format != VERTEX_FULL)
+                continue;
+            glBindBuffer(GL_COPY_READ_BUFFER, mesh.IndexBuffer());
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, indexOffset * sizeof(unsigned int), mesh.indexCount * sizeof(unsigned int));
+            indexOffset += mesh.indexCount;
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        range.drawCount = (unsigned int)draws.size() - range.firstDraw;
+        models.push_back(range);
+        dirty = true;
+        return (unsigned int)models.size() - 1;
+    }
+
+    // moves a pooled model; takes effect on the next Draw
+    void SetTransform(unsigned int model, const glm::mat4 &transform)
+    {
+        const ModelRange &range = models[model];
+        for (unsigned int i = range.firstDraw; i < range.firstDraw + range.drawCount; i++)
+            draws[i].model = transform;
+        dirty = true;
+    }
+
+    // draws everything in the pool. The program must be in use; its sampler arrays are pointed at
+    // the batch units the first time it is seen.
+    void Draw(GLuint program)
+    {
+        drawRange(program, 0, (unsigned int)commands.size());
+    }
+
+    // draws one model's meshes, as Draw does for the whole pool
+    void DrawModel(unsigned int model, GLuint program)
+    {
+        const ModelRange &range = models[model];
+        drawRange(program, range.firstDraw, range.firstDraw + range.drawCount);
+    }
+
+    unsigned int DrawCount() const { return (unsigned int)commands.size(); }
+    unsigned int BatchCount() const { return (unsigned int)batches.size(); }
+
+private:
+    struct ModelRange {
+        unsigned int firstDraw;
+        unsigned int drawCount;
+    };
+    // a run of consecutive draws sharing one set of bound textures
+    struct Batch {
+        unsigned int drawCount;
+        unsigned int materialCount;
+        GLuint diffuse[POOL_BATCH_MATERIALS];
+        GLuint specular[POOL_BATCH_MATERIALS];
+    };
+    struct ProgramSlots {
+        GLuint program;
+        GLint drawOffset;
+    };
+
+    GLuint VAO, VBO, EBO, indirectBuffer, drawBuffer;
+    size_t vertexCapacity, vertexCount;
+    size_t indexCapacity, indexCount;
+    vector<DrawElementsIndirectCommand> commands;
+    vector<PoolDrawData> draws;
+    vector<Batch> batches;
+    vector<ModelRange> models;
+    vector<ProgramSlots> programs;
+    bool dirty;
+
+    // one multi-draw for each batch that has draws in [begin, end)
+    void drawRange(GLuint program, unsigned int begin, unsigned int end)
+    {
+        if (begin >= end)
+            return;
+        if (dirty)
+            upload();
+        GLint drawOffset = programSlot(program);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, drawBuffer);
+        unsigned int batchFirst = 0;
+        for (unsigned int b = 0; b < batches.size() && batchFirst < end; b++)
+        {
+            const Batch &batch = batches[b];
+            unsigned int first = std::max(begin, batchFirst);
+            unsigned int last = std::min(end, batchFirst + batch.drawCount);
+            batchFirst += batch.drawCount;
+            if (first >= last)
+                continue;
+            bindBatch(batch);
+            // gl_DrawID restarts at 0 for every call, so the shader adds the call's first draw
+            if (drawOffset != -1)
+                glUniform1i(drawOffset, (GLint)first);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)(first * sizeof(DrawElementsIndirectCommand)),
+                                        (GLsizei)(last - first), 0);
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // grows the buffers to hold at least the given counts, keeping their contents
+    void reserve(size_t vertices, size_t indices)
+    {
+        if (vertices > vertexCapacity)
+        {
+            vertexCapacity = std::max(vertices, vertexCapacity * 2);
+            VBO = grow(VBO, vertexCount * sizeof(Vertex), vertexCapacity * sizeof(Vertex));
+            glBindVertexArray(VAO);
+            glBindVertexBuffer(0, VBO, 0, sizeof(Vertex));
+            glBindVertexArray(0);
+        }
+        if (indices > indexCapacity)
+        {
+            indexCapacity = std::max(indices, indexCapacity * 2);
+            EBO = grow(EBO, indexCount * sizeof(unsigned int), indexCapacity * sizeof(unsigned int));
+            glBindVertexArray(VAO);
+            glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+            glBindVertexArray(0);
+        }
+    }
+
+    static GLuint grow(GLuint buffer, size_t used, size_t capacity)
+    {
+        GLuint bigger;
+        glGenBuffers(1, &bigger);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STATIC_DRAW);
+        if (buffer != 0)
+        {
+            if (used > 0)
+            {
+                glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, used);
+                glBindBuffer(GL_COPY_READ_BUFFER, 0);
+            }
+            glDeleteBuffers(1, &buffer);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        return bigger;
+    }
+
+    // index of the mesh's material within the current batch, opening a new batch when it is full
+    GLuint materialSlot(const Mesh &mesh)
+    {
+        GLuint diffuse = 0, specular = 0;
+        for (unsigned int i = 0; i < mesh.textures.size(); i++)
+        {
+            if (diffuse == 0 && mesh.textures[i].type == "texture_diffuse")
+                diffuse = mesh.textures[i].id;
+            else if (specular == 0 && mesh.textures[i].type == "texture_specular")
+                specular = mesh.textures[i].id;
+        }
+        if (!batches.empty())
+        {
+            Batch &batch = batches.back();
+            for (unsigned int m = 0; m < batch.materialCount; m++)
+                if (batch.diffuse[m] == diffuse && batch.specular[m] == specular)
+                    return m;
+        }
+        if (batches.empty() || batches.back().materialCount == POOL_BATCH_MATERIALS)
+        {
+            Batch batch;
+            batch.drawCount = 0;
+            batch.materialCount = 0;
+            for (unsigned int m = 0; m < POOL_BATCH_MATERIALS; m++)
+                batch.diffuse[m] = batch.specular[m] = 0;
+            batches.push_back(batch);
+        }
+        Batch &batch = batches.back();
+        batch.diffuse[batch.materialCount] = diffuse;
+        batch.specular[batch.materialCount] = specular;
+        return batch.materialCount++;
+    }
+
+    // diffuse maps on units 0-7, specular maps on units 8-15
+    void bindBatch(const Batch &batch) const
+    {
+        if (GLAD_GL_VERSION_4_4)
+        {
+            glBindTextures(0, POOL_BATCH_MATERIALS, batch.diffuse);
+            glBindTextures(POOL_BATCH_MATERIALS, POOL_BATCH_MATERIALS, batch.specular);
+            return;
+        }
+        for (unsigned int m = 0; m < batch.materialCount; m++)
+        {
+            glActiveTexture(GL_TEXTURE0 + m);
+            glBindTexture(GL_TEXTURE_2D, batch.diffuse[m]);
+            glActiveTexture(GL_TEXTURE0 + POOL_BATCH_MATERIALS + m);
+            glBindTexture(GL_TEXTURE_2D, batch.specular[m]);
+        }
+    }
+
+    // looks up drawOffset and points the sampler arrays at their units, once per program
+    GLint programSlot(GLuint program)
+    {
+        for (unsigned int i = 0; i < programs.size(); i++)
+            if (programs[i].program == program)
+                return programs[i].drawOffset;
+
+        ProgramSlots slots;
+        slots.program = program;
+        slots.drawOffset = glGetUniformLocation(program, "drawOffset");
+        programs.push_back(slots);
+        for (unsigned int m = 0; m < POOL_BATCH_MATERIALS; m++)
+        {
+            GLint location = glGetUniformLocation(program, ("texture_diffuse[" + std::to_string(m) + "]").c_str());
+            if (location != -1)
+                glUniform1i(location, m);
+            location = glGetUniformLocation(program, ("texture_specular[" + std::to_string(m) + "]").c_str());
+            if (location != -1)
+                glUniform1i(location, POOL_BATCH_MATERIALS + m);
+        }
+        return slots.drawOffset;
+    }
+
+    void upload()
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, draws.size() * sizeof(PoolDrawData), &draws[0], GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        dirty = false;
+    }
+};
+#endif
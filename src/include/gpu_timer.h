@@ -0,0 +1,84 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+// Measures how long the GPU spends on the commands between Begin() and End() with
+// GL_TIME_ELAPSED queries. Results arrive a few frames late, so the queries rotate through a
+// small ring and LastMs() reports the newest one that has finished, never stalling on the rest.
+// Timers can't nest: only one GL_TIME_ELAPSED query may be active at a time.
+class GpuTimer {
+public:
+    GpuTimer() : next(0), latestMs(-1.0)
+    {
+        for (unsigned int i = 0; i < QUERY_COUNT; i++)
+        {
+            queries[i] = 0;
+            issued[i] = false;
+        }
+    }
+
+    ~GpuTimer()
+    {
+        if (queries[0] != 0)
+            glDeleteQueries(QUERY_COUNT, queries);
+    }
+
+    void Begin()
+    {
+        if (queries[0] == 0)
+            glGenQueries(QUERY_COUNT, queries);
+        collect();
+        // the GPU is a whole ring behind; wait for the slot rather than lose its result
+        if (issued[next])
+            read(next);
+        glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+    }
+
+    void End()
+    {
+        glEndQuery(GL_TIME_ELAPSED);
+        issued[next] = true;
+        next = (next + 1) % QUERY_COUNT;
+    }
+
+    // newest finished measurement in milliseconds, negative until the first one is available
+    double LastMs()
+    {
+        collect();
+        return latestMs;
+    }
+
+private:
+    static const unsigned int QUERY_COUNT = 4;
+
+    GLuint queries[QUERY_COUNT];
+    bool issued[QUERY_COUNT];
+    unsigned int next;
+    double latestMs;
+
+    // reads every finished query, oldest first, without waiting for the others
+    void collect()
+    {
+        for (unsigned int i = 0; i < QUERY_COUNT; i++)
+        {
+            unsigned int slot = (next + i) % QUERY_COUNT;
+            if (!issued[slot])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break; // later queries can't have finished before this one
+            read(slot);
+        }
+    }
+
+    void read(unsigned int slot)
+    {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+        latestMs = nanoseconds / 1.0e6;
+        issued[slot] = false;
+    }
+};
+#endif
@@ -0,0 +1,228 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <GLFW/glfw3.h>
+
+#include <stdint.h>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Records every input the app reads, with its frame number and timestamp, so a session can be
+// replayed exactly: the same camera path, the same toggles and, with the recorded or a fixed
+// timestep, the same animation on every frame.
+//
+// The app reads input at three kinds of points, and the log marks each of them:
+//   BeginFrame()  the timestep of the frame
+//   PollEvents()  wraps glfwPollEvents; cursor and scroll callbacks that fire inside it follow
+//                 the marker
+//   GetKey()      wraps glfwGetKey; a key is logged when its state differs from the last one
+//                 logged. GLFW only changes key state inside a poll, so on replay key changes
+//                 are applied at the marker before them.
+// Replaying reads the same points back in the same order: PollEvents() hands the recorded
+// cursor and scroll events to the callbacks given to SetCallbacks() instead of GLFW's, and
+// GetKey() answers from the recorded key state.
+//
+// log layout (native byte order): InputLogHeader, then InputEvent records to the end of the file
+const uint32_t INPUT_LOG_VERSION = 1;
+
+enum Input_Event_Type {
+    INPUT_FRAME,    // x: timestep in seconds
+    INPUT_POLL,
+    INPUT_KEY,      // key, pressed
+    INPUT_CURSOR,   // x, y
+    INPUT_SCROLL    // x, y: offsets
+};
+
+struct InputLogHeader {
+    char     magic[8];      // "GEMINPT"
+    uint32_t version;       // INPUT_LOG_VERSION
+    uint32_t eventSize;     // sizeof(InputEvent) when written
+};
+
+struct InputEvent {
+    uint8_t  type;          // Input_Event_Type
+    uint8_t  pressed;
+    uint16_t key;
+    uint32_t frame;
+    float    time;          // seconds since recording started
+    float    x, y;
+};
+
+class InputRecorder {
+public:
+    typedef void (*CursorCallback)(GLFWwindow*, double, double);
+    typedef void (*ScrollCallback)(GLFWwindow*, double, double);
+
+    float FixedDt;          // timestep override in seconds; 0 uses the wall clock or the log
+
+    InputRecorder() : FixedDt(0.0f), recording(false), replaying(false), finished(false), frame(0), frameCount(0), startTime(0.0),
+                      next(0), cursorCallback(NULL), scrollCallback(NULL)
+    {
+        memset(keys, 0, sizeof(keys));
+    }
+
+    ~InputRecorder()
+    {
+        if (recording)
+            out.close();
+    }
+
+    bool Record(const string &path)
+    {
+        out.open(path.c_str(), std::ios::binary | std::ios::trunc);
+        if (!out)
+            return false;
+        InputLogHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "GEMINPT", 8);
+        header.version = INPUT_LOG_VERSION;
+        header.eventSize = sizeof(InputEvent);
+        out.write((const char*)&header, sizeof(header));
+        recording = true;
+        startTime = glfwGetTime();
+        return true;
+    }
+
+    // loads a whole log; false if it is missing or from another version
+    bool Replay(const string &path)
+    {
+        std::ifstream in(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!in)
+            return false;
+        size_t size = (size_t)in.tellg();
+        in.seekg(0);
+        InputLogHeader header;
+        if (size < sizeof(header) || !in.read((char*)&header, sizeof(header)) ||
+            memcmp(header.magic, "GEMINPT", 8) != 0 || header.version != INPUT_LOG_VERSION || header.eventSize != sizeof(InputEvent))
+            return false;
+        events.resize((size - sizeof(header)) / sizeof(InputEvent));
+        if (!events.empty() && !in.read((char*)&events[0], events.size() * sizeof(InputEvent)))
+            return false;
+        replaying = true;
+        return true;
+    }
+
+    // where replayed cursor and scroll events go
+    void SetCallbacks(CursorCallback cursor, ScrollCallback scroll)
+    {
+        cursorCallback = cursor;
+        scrollCallback = scroll;
+    }
+
+    bool Recording() const { return recording; }
+    bool Replaying() const { return replaying; }
+    // true once a replay has run out of frames
+    bool Finished() const { return finished; }
+    unsigned int Frame() const { return frame; }
+
+    // starts a frame and returns its timestep: the recorded one on replay, otherwise
+    // wallDelta, either way replaced by FixedDt when that is set
+    float BeginFrame(float wallDelta)
+    {
+        float dt = FixedDt > 0.0f ? FixedDt : wallDelta;
+        if (replaying)
+        {
+            while (next < events.size() && events[next].type != INPUT_FRAME)
+                next++;
+            if (next == events.size())
+            {
+                finished = true;
+                return dt;
+            }
+            frame = events[next].frame;
+            if (FixedDt <= 0.0f)
+                dt = events[next].x;
+            next++;
+            dispatch();
+            return dt;
+        }
+        frame = frameCount++;
+        write(INPUT_FRAME, 0, 0, dt, 0.0f);
+        return dt;
+    }
+
+    // glfwPollEvents, recorded or replayed
+    void PollEvents()
+    {
+        glfwPollEvents(); // keeps the window responsive on replay as well
+        if (!replaying)
+        {
+            write(INPUT_POLL, 0, 0, 0.0f, 0.0f);
+            return;
+        }
+        if (next < events.size() && events[next].type == INPUT_POLL)
+        {
+            next++;
+            dispatch();
+        }
+    }
+
+    // glfwGetKey, recorded or replayed
+    int GetKey(GLFWwindow* window, int key)
+    {
+        if (replaying)
+            return key >= 0 && key < KEY_COUNT && keys[key] ? GLFW_PRESS : GLFW_RELEASE;
+        int state = glfwGetKey(window, key);
+        if (key >= 0 && key < KEY_COUNT && keys[key] != (state == GLFW_PRESS))
+        {
+            keys[key] = state == GLFW_PRESS;
+            write(INPUT_KEY, (uint16_t)key, keys[key] ? 1 : 0, 0.0f, 0.0f);
+        }
+        return state;
+    }
+
+    // call from the live GLFW callbacks
+    void Cursor(double x, double y) { write(INPUT_CURSOR, 0, 0, (float)x, (float)y); }
+    void Scroll(double x, double y) { write(INPUT_SCROLL, 0, 0, (float)x, (float)y); }
+
+private:
+    static const int KEY_COUNT = 512; // above GLFW_KEY_LAST
+
+    bool recording;
+    bool replaying;
+    bool finished;
+    unsigned int frame;
+    unsigned int frameCount;
+    double startTime;
+    std::ofstream out;
+    vector<InputEvent> events;
+    size_t next;
+    bool keys[KEY_COUNT];
+    CursorCallback cursorCallback;
+    ScrollCallback scrollCallback;
+
+    // replays everything up to the next marker
+    void dispatch()
+    {
+        for (; next < events.size() && events[next].type != INPUT_FRAME && events[next].type != INPUT_POLL; next++)
+        {
+            const InputEvent &e = events[next];
+            if (e.type == INPUT_KEY && e.key < KEY_COUNT)
+                keys[e.key] = e.pressed != 0;
+            else if (e.type == INPUT_CURSOR && cursorCallback != NULL)
+                cursorCallback(NULL, e.x, e.y);
+            else if (e.type == INPUT_SCROLL && scrollCallback != NULL)
+                scrollCallback(NULL, e.x, e.y);
+        }
+    }
+
+    void write(Input_Event_Type type, uint16_t key, uint8_t pressed, float x, float y)
+    {
+        if (!recording)
+            return;
+        InputEvent e;
+        e.type = (uint8_t)type;
+        e.pressed = pressed;
+        e.key = key;
+        e.frame = frame;
+        e.time = (float)(glfwGetTime() - startTime);
+        e.x = x;
+        e.y = y;
+        out.write((const char*)&e, sizeof(e));
+    }
+};
+#endif
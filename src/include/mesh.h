@@ -4,6 +4,7 @@
 #include <glad/glad.h> // holds all OpenGL type declarations
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <string>
 #include <vector>
@@ -24,12 +25,76 @@ struct Vertex {
     glm::vec3 Bitangent;
 };
 
+// Compact vertex layout, 20 bytes instead of 56. Decoded in shader/mesh_packed.vert.
+//   position:  unorm16 x3 within the mesh bounds (positionOffset + p * positionScale), one short of padding
+//   normal:    octahedral encoding, snorm16 x2
+//   texCoords: half float x2
+//   tangent:   GL_INT_2_10_10_10_REV, xyz tangent and w the sign of the bitangent (cross(N, T) * w)
+struct PackedVertex {
+    uint16_t Position[4];
+    uint32_t Normal;
+    uint32_t TexCoords;
+    uint32_t Tangent;
+};
+
+enum Vertex_Format {
+    VERTEX_FULL,    // Vertex as is
+    VERTEX_PACKED   // PackedVertex
+};
+
+// maps a unit vector onto the octahedron and unfolds it into [-1, 1]^2
+inline glm::vec2 octEncode(glm::vec3 n)
+{
+    n = n / (fabs(n.x) + fabs(n.y) + fabs(n.z));
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        e.x = (1.0f - fabs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        e.y = (1.0f - fabs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    return e;
+}
+
+// quantizes vertices against the bounds given as offset (minimum) and scale (extent)
+inline void PackVertices(const Vertex* vertices, size_t count, const glm::vec3 &offset, const glm::vec3 &scale, vector<PackedVertex> &packed)
+{
+    packed.resize(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const Vertex &v = vertices[i];
+        PackedVertex &p = packed[i];
+        glm::vec3 unit = (v.Position - offset) / scale;
+        p.Position[0] = glm::packUnorm1x16(unit.x);
+        p.Position[1] = glm::packUnorm1x16(unit.y);
+        p.Position[2] = glm::packUnorm1x16(unit.z);
+        p.Position[3] = 0;
+
+        float normalLength = glm::length(v.Normal);
+        p.Normal = glm::packSnorm2x16(normalLength > 0.0f ? octEncode(v.Normal / normalLength) : glm::vec2(0.0f));
+        p.TexCoords = glm::packHalf2x16(v.TexCoords);
+
+        // keep the bitangent's handedness; its direction is rebuilt from the normal and tangent
+        float tangentLength = glm::length(v.Tangent);
+        glm::vec3 tangent = tangentLength > 0.0f ? v.Tangent / tangentLength : glm::vec3(0.0f);
+        float handedness = glm::dot(glm::cross(v.Normal, v.Tangent), v.Bitangent) < 0.0f ? -1.0f : 1.0f;
+        p.Tangent = glm::packSnorm3x10_1x2(glm::vec4(tangent, handedness));
+    }
+}
+
 struct Texture {
     unsigned int id;
     string type;
     string path;
 };
 
+// Every sampler has a fixed texture unit: texture_diffuse1-4 use units 0-3, texture_specular1-4
+// units 4-7, texture_normal1-4 units 8-11 and texture_height1-4 units 12-15. The sampler uniforms
+// of a program therefore only need setting once, and a mesh's textures resolve to a table of
+// texture ids indexed by unit when the mesh is created.
+const unsigned int MAX_SAMPLER_NUMBER = 4;
+const char* const samplerTypes[] = { "texture_diffuse", "texture_specular", "texture_normal", "texture_height" };
+const unsigned int samplerTypeCount = sizeof(samplerTypes) / sizeof(samplerTypes[0]);
+
 class Mesh {
 public:
     // mesh Data
@@ -37,63 +102,154 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
     unsigned int VAO;
+    unsigned int indexCount;
+    unsigned int vertexCount;
+    // layout of the GL vertex buffer; packed meshes decode positions with the two bounds below
+    Vertex_Format format;
+    glm::vec3 positionOffset;
+    glm::vec3 positionScale;
 
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // constructor; pass the vectors with std::move to hand over their storage instead of copying it
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, Vertex_Format format = VERTEX_FULL)
+        : vertices(std::move(vertices)), indices(std::move(indices)), textures(std::move(textures)), format(format)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
-
+        resolveTextureUnits();
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        setupMesh(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    }
+
+    // uploads vertex and index data straight from memory owned elsewhere (e.g. a mapped mesh cache).
+    // vertices and indices stay empty; only the GL buffers hold the geometry.
+    Mesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t indexCount, vector<Texture> textures,
+         Vertex_Format format = VERTEX_FULL)
+        : textures(std::move(textures)), format(format)
+    {
+        resolveTextureUnits();
+        setupMesh(vertexData, vertexCount, indexData, indexCount);
     }
 
     // render the mesh
     void Draw(Shader &shader) 
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
-        {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++);// transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++);  // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++);  // transfer unsigned int to stream
-
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
-        }
+        BindTextures(shader.ID);
         
         // draw mesh
         glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0);
         glBindVertexArray(0);
 
         // always good practice to set everything back to defaults once configured.
         glActiveTexture(GL_TEXTURE0);
     }
 
+    // binds the mesh's textures to their units, and for packed meshes sets the position decode.
+    // The program must be in use; its sampler uniforms are pointed at the fixed units the first
+    // time it is seen.
+    void BindTextures(unsigned int program) const
+    {
+        ProgramSlots slots = SetSamplerUnits(program);
+        if (format == VERTEX_PACKED)
+        {
+            if (slots.positionOffset != -1)
+                glUniform3fv(slots.positionOffset, 1, &positionOffset[0]);
+            if (slots.positionScale != -1)
+                glUniform3fv(slots.positionScale, 1, &positionScale[0]);
+        }
+        if (unitTextures.empty())
+            return;
+        if (GLAD_GL_VERSION_4_4)
+        {
+            // one call for the whole table; units without a texture get unbound
+            glBindTextures(0, (GLsizei)unitTextures.size(), &unitTextures[0]);
+            return;
+        }
+        for (unsigned int unit = 0; unit < unitTextures.size(); unit++)
+        {
+            if (unitTextures[unit] == 0)
+                continue;
+            glActiveTexture(GL_TEXTURE0 + unit); // active proper texture unit before binding
+            glBindTexture(GL_TEXTURE_2D, unitTextures[unit]);
+        }
+    }
+
+    // frees the GL objects. Copies of a Mesh share them, so only their owner (for Model meshes,
+    // the AssetRegistry) calls this.
+    void DeleteBuffers()
+    {
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
+    // GL buffers holding the mesh, e.g. for copying it into a GeometryPool
+    unsigned int VertexBuffer() const { return VBO; }
+    unsigned int IndexBuffer() const { return EBO; }
+
+    // uniforms a Mesh sets itself, looked up once per program
+    struct ProgramSlots {
+        unsigned int program;
+        GLint positionOffset;
+        GLint positionScale;
+    };
+
+    // points a program's texture_<type>N samplers at their fixed units and looks up its slots,
+    // once per program. The program must be in use.
+    static ProgramSlots SetSamplerUnits(unsigned int program)
+    {
+        static vector<ProgramSlots> configured;
+        for (unsigned int i = 0; i < configured.size(); i++)
+            if (configured[i].program == program)
+                return configured[i];
+
+        ProgramSlots slots;
+        slots.program = program;
+        slots.positionOffset = glGetUniformLocation(program, "positionOffset");
+        slots.positionScale = glGetUniformLocation(program, "positionScale");
+        configured.push_back(slots);
+
+        for (unsigned int type = 0; type < samplerTypeCount; type++)
+            for (unsigned int number = 1; number <= MAX_SAMPLER_NUMBER; number++)
+            {
+                GLint location = glGetUniformLocation(program, (samplerTypes[type] + std::to_string(number)).c_str());
+                if (location != -1)
+                    glUniform1i(location, type * MAX_SAMPLER_NUMBER + number - 1);
+            }
+        return slots;
+    }
+
 private:
     // render data 
     unsigned int VBO, EBO;
+    // texture id bound to each unit, 0 where the material has nothing
+    vector<GLuint> unitTextures;
+
+    // works out which unit each texture goes to, following the texture_<type>N numbering
+    void resolveTextureUnits()
+    {
+        unsigned int count[samplerTypeCount] = { 0 };
+        for (unsigned int i = 0; i < textures.size(); i++)
+        {
+            unsigned int type = 0;
+            while (type < samplerTypeCount && textures[i].type != samplerTypes[type])
+                type++;
+            if (type == samplerTypeCount || count[type] == MAX_SAMPLER_NUMBER)
+                continue; // no sampler in the shaders to bind it to
+            unsigned int unit = type * MAX_SAMPLER_NUMBER + count[type]++;
+            if (unitTextures.size() <= unit)
+                unitTextures.resize(unit + 1, 0);
+            unitTextures[unit] = textures[i].id;
+        }
+    }
 
     // initializes all the buffer objects/arrays
-    void setupMesh()
+    void setupMesh(const Vertex* vertexData, size_t vertexCount, const unsigned int* indexData, size_t count)
     {
+        indexCount = (unsigned int)count;
+        this->vertexCount = (unsigned int)vertexCount;
+        positionOffset = glm::vec3(0.0f);
+        positionScale = glm::vec3(1.0f);
+
         // create buffers/arrays
         glGenVertexArrays(1, &VAO);
         glGenBuffers(1, &VBO);
@@ -102,13 +258,19 @@ private:
         glBindVertexArray(VAO);
         // load data into vertex buffers
         glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * sizeof(unsigned int), indexData, GL_STATIC_DRAW);
+        if (format == VERTEX_PACKED)
+        {
+            setupPacked(vertexData, vertexCount);
+            glBindVertexArray(0);
+            return;
+        }
+
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertexData, GL_STATIC_DRAW);  
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -129,5 +291,37 @@ private:
 
         glBindVertexArray(0);
     }
+
+    // quantizes into PackedVertex and sets up the normalized attributes mesh_packed.vert decodes
+    void setupPacked(const Vertex* vertexData, size_t vertexCount)
+    {
+        glm::vec3 lo(0.0f), hi(0.0f);
+        if (vertexCount > 0)
+            lo = hi = vertexData[0].Position;
+        for (size_t i = 1; i < vertexCount; i++)
+        {
+            lo = glm::min(lo, vertexData[i].Position);
+            hi = glm::max(hi, vertexData[i].Position);
+        }
+        positionOffset = lo;
+        positionScale = glm::max(hi - lo, glm::vec3(1e-6f)); // flat meshes still divide safely
+
+        vector<PackedVertex> packed;
+        PackVertices(vertexData, vertexCount, positionOffset, positionScale, packed);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
+
+        // vertex Positions
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Position));
+        // vertex normals, octahedral
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Normal));
+        // vertex texture coords
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, TexCoords));
+        // vertex tangent and bitangent sign; the bitangent itself is rebuilt in the shader
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, Tangent));
+    }
 };
 #endif
@@ -0,0 +1,266 @@
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "cache_file.h"
+#include "mesh.h"
+
+using namespace std;
+
+// Binary cache of a Model's processed meshes, stored next to the source asset as <source>.meshcache
+// so assimp only has to run when the source changes.
+//
+// layout (native byte order):
+//   CacheHeader
+//   CacheMesh[meshCount]
+//   CacheTexture[textureCount]
+//   string data (texture paths, not terminated)
+//   per mesh: vertices, then indices, each starting on a page boundary
+//
+// Array offsets are page aligned so the mapped vertex and index data start on their own pages
+// and can be handed to glBufferData without any copying or fix-up.
+const uint32_t MESH_CACHE_VERSION = 2; // 2: meshes are stored optimised (mesh_optimizer.h)
+const uint64_t MESH_CACHE_PAGE = 4096;
+
+struct CacheHeader {
+    char     magic[8];          // "GEMMESH"
+    uint32_t version;           // MESH_CACHE_VERSION
+    uint32_t vertexSize;        // sizeof(Vertex) when written
+    uint32_t meshCount;
+    uint32_t textureCount;
+    uint64_t stringOffset;
+    uint64_t fileSize;
+};
+
+struct CacheMesh {
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t firstTexture;
+    uint32_t textureCount;
+};
+
+struct CacheTexture {
+    uint32_t type;              // index into samplerTypes
+    uint32_t pathOffset;        // relative to CacheHeader::stringOffset
+    uint32_t pathLength;
+    uint32_t pad;
+};
+
+class MeshCache {
+public:
+    MeshCache() : data(NULL), size(0) {}
+    ~MeshCache() { Close(); }
+
+    static string PathFor(const string &source)
+    {
+        return source + ".meshcache";
+    }
+
+    // serialises the meshes' vertices, indices and texture references. Texture paths are stored as
+    // the material gave them, i.e. relative to the model's directory.
+    static bool Write(const string &cachePath, const vector<Mesh> &meshes)
+    {
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "GEMMESH", 8);
+        header.version = MESH_CACHE_VERSION;
+        header.vertexSize = sizeof(Vertex);
+        header.meshCount = (uint32_t)meshes.size();
+
+        vector<CacheMesh> records(meshes.size());
+        vector<CacheTexture> textures;
+        string strings;
+        for (unsigned int i = 0; i < meshes.size(); i++)
+        {
+            records[i].vertexCount = (uint32_t)meshes[i].vertices.size();
+            records[i].indexCount = (uint32_t)meshes[i].indices.size();
+            records[i].firstTexture = (uint32_t)textures.size();
+            records[i].textureCount = 0;
+            for (unsigned int t = 0; t < meshes[i].textures.size(); t++)
+            {
+                const Texture &texture = meshes[i].textures[t];
+                CacheTexture entry;
+                entry.type = 0;
+                while (entry.type < samplerTypeCount && texture.type != samplerTypes[entry.type])
+                    entry.type++;
+                if (entry.type == samplerTypeCount)
+                    continue;
+                entry.pathOffset = (uint32_t)strings.size();
+                entry.pathLength = (uint32_t)texture.path.size();
+                entry.pad = 0;
+                strings += texture.path;
+                textures.push_back(entry);
+                records[i].textureCount++;
+            }
+        }
+        header.textureCount = (uint32_t)textures.size();
+        header.stringOffset = sizeof(CacheHeader) + records.size() * sizeof(CacheMesh) + textures.size() * sizeof(CacheTexture);
+
+        uint64_t offset = header.stringOffset + strings.size();
+        for (unsigned int i = 0; i < records.size(); i++)
+        {
+            records[i].vertexOffset = align(offset);
+            offset = records[i].vertexOffset + (uint64_t)records[i].vertexCount * sizeof(Vertex);
+            records[i].indexOffset = align(offset);
+            offset = records[i].indexOffset + (uint64_t)records[i].indexCount * sizeof(unsigned int);
+        }
+        header.fileSize = offset;
+
+        return WriteFileSafely(cachePath, [&](std::ofstream &out) {
+            out.write((const char*)&header, sizeof(header));
+            if (!records.empty())
+                out.write((const char*)&records[0], records.size() * sizeof(CacheMesh));
+            if (!textures.empty())
+                out.write((const char*)&textures[0], textures.size() * sizeof(CacheTexture));
+            out.write(strings.data(), strings.size());
+            for (unsigned int i = 0; i < records.size(); i++)
+            {
+                pad(out, records[i].vertexOffset);
+                if (!meshes[i].vertices.empty())
+                    out.write((const char*)&meshes[i].vertices[0], meshes[i].vertices.size() * sizeof(Vertex));
+                pad(out, records[i].indexOffset);
+                if (!meshes[i].indices.empty())
+                    out.write((const char*)&meshes[i].indices[0], meshes[i].indices.size() * sizeof(unsigned int));
+            }
+            return true;
+        });
+    }
+
+    // maps a cache file and validates its header and offsets; false if it is missing, stale
+    // in version or layout, or truncated
+    bool Open(const string &cachePath)
+    {
+        Close();
+#ifndef _WIN32
+        int fd = open(cachePath.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(CacheHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)info.st_size;
+        void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            size = 0;
+            return false;
+        }
+        data = (const unsigned char*)mapped;
+#else
+        // no mmap; read the file into memory instead
+        std::ifstream in(cachePath.c_str(), std::ios::binary | std::ios::ate);
+        if (!in)
+            return false;
+        fallback.resize((size_t)in.tellg());
+        in.seekg(0);
+        if (fallback.size() < sizeof(CacheHeader) || !in.read((char*)&fallback[0], fallback.size()))
+        {
+            fallback.clear();
+            return false;
+        }
+        data = &fallback[0];
+        size = fallback.size();
+#endif
+        if (!validate())
+        {
+            Close();
+            return false;
+        }
+        return true;
+    }
+
+    void Close()
+    {
+#ifndef _WIN32
+        if (data)
+            munmap((void*)data, size);
+#else
+        fallback.clear();
+#endif
+        data = NULL;
+        size = 0;
+    }
+
+    unsigned int MeshCount() const { return header()->meshCount; }
+    const CacheMesh &GetMesh(unsigned int i) const { return meshes()[i]; }
+    const Vertex* Vertices(unsigned int i) const { return (const Vertex*)(data + meshes()[i].vertexOffset); }
+    const unsigned int* Indices(unsigned int i) const { return (const unsigned int*)(data + meshes()[i].indexOffset); }
+
+    // texture type name and path of a mesh's nth texture
+    string TextureType(unsigned int mesh, unsigned int n) const
+    {
+        return samplerTypes[textures()[meshes()[mesh].firstTexture + n].type];
+    }
+    string TexturePath(unsigned int mesh, unsigned int n) const
+    {
+        const CacheTexture &t = textures()[meshes()[mesh].firstTexture + n];
+        return string((const char*)data + header()->stringOffset + t.pathOffset, t.pathLength);
+    }
+
+private:
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    vector<unsigned char> fallback;
+#endif
+
+    const CacheHeader* header() const { return (const CacheHeader*)data; }
+    const CacheMesh* meshes() const { return (const CacheMesh*)(data + sizeof(CacheHeader)); }
+    const CacheTexture* textures() const { return (const CacheTexture*)(data + sizeof(CacheHeader) + header()->meshCount * sizeof(CacheMesh)); }
+
+    static uint64_t align(uint64_t offset)
+    {
+        return (offset + MESH_CACHE_PAGE - 1) & ~(MESH_CACHE_PAGE - 1);
+    }
+
+    static void pad(std::ofstream &out, uint64_t offset)
+    {
+        static const char zeros[MESH_CACHE_PAGE] = { 0 };
+        uint64_t at = (uint64_t)out.tellp();
+        if (offset > at)
+            out.write(zeros, (std::streamsize)(offset - at));
+    }
+
+    bool validate() const
+    {
+        const CacheHeader* h = header();
+        if (memcmp(h->magic, "GEMMESH", 8) != 0 || h->version != MESH_CACHE_VERSION || h->vertexSize != sizeof(Vertex) || h->fileSize != size)
+            return false;
+        uint64_t tables = sizeof(CacheHeader) + (uint64_t)h->meshCount * sizeof(CacheMesh) + (uint64_t)h->textureCount * sizeof(CacheTexture);
+        if (tables > size || h->stringOffset != tables)
+            return false;
+        for (unsigned int i = 0; i < h->meshCount; i++)
+        {
+            const CacheMesh &m = meshes()[i];
+            if (m.vertexOffset + (uint64_t)m.vertexCount * sizeof(Vertex) > size ||
+                m.indexOffset + (uint64_t)m.indexCount * sizeof(unsigned int) > size ||
+                (uint64_t)m.firstTexture + m.textureCount > h->textureCount)
+                return false;
+        }
+        for (unsigned int i = 0; i < h->textureCount; i++)
+        {
+            const CacheTexture &t = textures()[i];
+            if (t.type >= samplerTypeCount || h->stringOffset + t.pathOffset + t.pathLength > size)
+                return false;
+        }
+        return true;
+    }
+};
+#endif
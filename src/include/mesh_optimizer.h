@@ -0,0 +1,269 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <vector>
+#include "mesh.h"
+
+using namespace std;
+
+// Post-import reordering of indexed triangle lists, after Sander, Nehab and Barczak,
+// "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw" (2007):
+//   1. Tipsify orders triangles for the post-transform vertex cache
+//   2. the result is cut into clusters, which are sorted so outward-facing ones draw first
+//   3. vertices are renumbered in first-use order so fetches walk the vertex buffer forwards
+// Only the order changes; every triangle keeps its winding.
+
+// default post-transform cache size assumed when ordering; 16 to 32 entries is typical
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct MeshOptimizeStats {
+    float acmrBefore;   // average cache misses per triangle, FIFO cache of VERTEX_CACHE_SIZE
+    float acmrAfter;
+    unsigned int clusters;
+};
+
+// average cache miss ratio: vertex shader invocations per triangle with a FIFO cache
+inline float ComputeACMR(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE)
+{
+    if (indices.size() < 3)
+        return 0.0f;
+    // a vertex is in the FIFO if it entered fewer than cacheSize misses ago
+    vector<unsigned int> entered(vertexCount, 0);
+    unsigned int misses = 0;
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        unsigned int v = indices[i];
+        if (entered[v] == 0 || misses - entered[v] >= cacheSize)
+        {
+            misses++;
+            entered[v] = misses; // miss number, so 0 means never seen
+        }
+    }
+    return (float)misses / (float)(indices.size() / 3);
+}
+
+// Tipsify: fans around the most recently cached vertex that still has triangles, jumping to a
+// dead-end vertex when none does. Writes the triangle order into ordered and the first triangle
+// of every jump (a cluster that starts with a cold cache) into clusterStarts.
+inline void TipsifyOrder(const vector<unsigned int> &indices, size_t vertexCount, unsigned int cacheSize,
+                         vector<unsigned int> &ordered, vector<unsigned int> &clusterStarts)
+{
+    size_t triangleCount = indices.size() / 3;
+    ordered.clear();
+    ordered.reserve(indices.size());
+    clusterStarts.clear();
+
+    // vertex -> triangles adjacency, and how many unemitted triangles each vertex still has
+    vector<unsigned int> live(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++)
+        live[indices[i]]++;
+    vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++)
+        offsets[v + 1] = offsets[v] + live[v];
+    vector<unsigned int> adjacency(offsets[vertexCount]);
+    vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (unsigned int c = 0; c < 3; c++)
+            adjacency[fill[indices[t * 3 + c]]++] = (unsigned int)t;
+
+    vector<unsigned int> cacheTime(vertexCount, 0);
+    vector<char> emitted(triangleCount, 0);
+    vector<unsigned int> deadEnd;
+    vector<unsigned int> candidates;
+    unsigned int time = cacheSize + 1;
+    size_t cursor = 0;
+
+    // next vertex with live triangles from the dead-end stack, else the next one in input order
+    auto skipDeadEnd = [&]() -> long {
+        while (!deadEnd.empty())
+        {
+            unsigned int d = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[d] > 0)
+                return d;
+        }
+        while (cursor < vertexCount)
+        {
+            if (live[cursor] > 0)
+                return (long)cursor;
+            cursor++;
+        }
+        return -1;
+    };
+
+    long fan = skipDeadEnd();
+    if (fan >= 0)
+        clusterStarts.push_back(0);
+    while (fan >= 0)
+    {
+        candidates.clear();
+        for (unsigned int a = offsets[fan]; a < offsets[fan + 1]; a++)
+        {
+            unsigned int t = adjacency[a];
+            if (emitted[t])
+                continue;
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                unsigned int v = indices[t * 3 + c];
+                ordered.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - cacheTime[v] > cacheSize)
+                    cacheTime[v] = time++;
+            }
+            emitted[t] = 1;
+        }
+
+        // prefer the candidate that entered the cache earliest but will still be cached after its fan
+        long best = -1;
+        int bestPriority = -1;
+        for (unsigned int i = 0; i < candidates.size(); i++)
+        {
+            unsigned int v = candidates[i];
+            if (live[v] == 0)
+                continue;
+            int priority = 0;
+            if (time - cacheTime[v] + 2 * live[v] <= cacheSize)
+                priority = (int)(time - cacheTime[v]);
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                best = v;
+            }
+        }
+        if (best == -1)
+        {
+            best = skipDeadEnd();
+            if (best >= 0)
+                clusterStarts.push_back((unsigned int)(ordered.size() / 3));
+        }
+        fan = best;
+    }
+}
+
+// Reorders triangles for the vertex cache and then for overdraw. lambda bounds how much cache
+// efficiency the overdraw pass may give up: clusters are cut wherever the running miss ratio of
+// the current cluster has come down to lambda times the Tipsify ratio, so each extra cold start
+// has already been paid for.
+inline unsigned int OptimizeTriangleOrder(const vector<Vertex> &vertices, vector<unsigned int> &indices,
+                                          unsigned int cacheSize = VERTEX_CACHE_SIZE, float lambda = 1.05f)
+{
+    vector<unsigned int> ordered, hardStarts;
+    TipsifyOrder(indices, vertices.size(), cacheSize, ordered, hardStarts);
+    size_t triangleCount = ordered.size() / 3;
+    if (triangleCount == 0)
+        return 0;
+
+    float threshold = ComputeACMR(ordered, vertices.size(), cacheSize) * lambda;
+
+    // soft boundaries inside each hard cluster, found by replaying it through a FIFO cache
+    vector<unsigned int> starts;
+    vector<unsigned int> entered(vertices.size(), 0);
+    unsigned int misses = 0;
+    hardStarts.push_back((unsigned int)triangleCount);
+    for (size_t h = 0; h + 1 < hardStarts.size(); h++)
+    {
+        unsigned int clusterStart = hardStarts[h];
+        unsigned int clusterMisses = 0;
+        starts.push_back(clusterStart);
+        for (unsigned int t = clusterStart; t < hardStarts[h + 1]; t++)
+        {
+            if (t > clusterStart && (float)clusterMisses / (float)(t - clusterStart) <= threshold)
+            {
+                // cut here; the new cluster starts with a cold cache
+                starts.push_back(t);
+                clusterStart = t;
+                clusterMisses = 0;
+                misses += cacheSize; // forget everything cached so far
+            }
+            for (unsigned int c = 0; c < 3; c++)
+            {
+                unsigned int v = ordered[t * 3 + c];
+                if (entered[v] == 0 || misses - entered[v] >= cacheSize)
+                {
+                    misses++;
+                    clusterMisses++;
+                    entered[v] = misses;
+                }
+            }
+        }
+    }
+    starts.push_back((unsigned int)triangleCount);
+
+    // sort clusters by how far they face out from the mesh centre, most outward first, so they
+    // tend to occlude what is drawn after them
+    glm::vec3 meshCentre(0.0f);
+    float meshArea = 0.0f;
+    size_t clusterCount = starts.size() - 1;
+    vector<glm::vec3> centroid(clusterCount, glm::vec3(0.0f)), normal(clusterCount, glm::vec3(0.0f));
+    vector<float> area(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; c++)
+    {
+        for (unsigned int t = starts[c]; t < starts[c + 1]; t++)
+        {
+            const glm::vec3 &a = vertices[ordered[t * 3 + 0]].Position;
+            const glm::vec3 &b = vertices[ordered[t * 3 + 1]].Position;
+            const glm::vec3 &d = vertices[ordered[t * 3 + 2]].Position;
+            glm::vec3 n = glm::cross(b - a, d - a); // length is twice the area
+            float w = glm::length(n);
+            centroid[c] = centroid[c] + (a + b + d) * (w / 3.0f);
+            normal[c] = normal[c] + n;
+            area[c] += w;
+        }
+        meshCentre = meshCentre + centroid[c];
+        meshArea += area[c];
+        if (area[c] > 0.0f)
+            centroid[c] = centroid[c] / area[c];
+    }
+    if (meshArea > 0.0f)
+        meshCentre = meshCentre / meshArea;
+
+    vector<std::pair<float, unsigned int> > order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++)
+        order[c] = std::make_pair(-glm::dot(centroid[c] - meshCentre, normal[c]), (unsigned int)c);
+    std::stable_sort(order.begin(), order.end());
+
+    indices.clear();
+    for (size_t i = 0; i < clusterCount; i++)
+    {
+        unsigned int c = order[i].second;
+        indices.insert(indices.end(), ordered.begin() + starts[c] * 3, ordered.begin() + starts[c + 1] * 3);
+    }
+    return (unsigned int)clusterCount;
+}
+
+// renumbers vertices in the order the indices first use them; unreferenced vertices are dropped
+inline void OptimizeVertexFetch(vector<Vertex> &vertices, vector<unsigned int> &indices)
+{
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(vertices.size(), unused);
+    vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        unsigned int &r = remap[indices[i]];
+        if (r == unused)
+        {
+            r = (unsigned int)reordered.size();
+            reordered.push_back(vertices[indices[i]]);
+        }
+        indices[i] = r;
+    }
+    vertices.swap(reordered);
+}
+
+// runs all three passes on a triangle list
+inline MeshOptimizeStats OptimizeMesh(vector<Vertex> &vertices, vector<unsigned int> &indices, unsigned int cacheSize = VERTEX_CACHE_SIZE)
+{
+    MeshOptimizeStats stats;
+    stats.acmrBefore = ComputeACMR(indices, vertices.size(), cacheSize);
+    stats.clusters = OptimizeTriangleOrder(vertices, indices, cacheSize);
+    OptimizeVertexFetch(vertices, indices);
+    stats.acmrAfter = ComputeACMR(indices, vertices.size(), cacheSize);
+    return stats;
+}
+#endif
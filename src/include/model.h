@@ -11,11 +11,20 @@
 
 #include "shader.h"
 #include "mesh.h"
+#include "geometry_pool.h"
+#include "render_queue.h"
+#include "texture_streamer.h"
+#include "mesh_cache.h"
+#include "mesh_optimizer.h"
+#include "asset_registry.h"
+#include "texture_compress.h"
+#include <cstring>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
@@ -25,43 +34,172 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
 class Model 
 {
 public:
+    // Models release their shared assets when destroyed, so they can't be copied
+    Model(const Model&) = delete;
+    Model &operator=(const Model&) = delete;
+
     // model data 
-    vector<Texture> textures_loaded;	// stores all the textures loaded so far, optimization to make sure textures aren't loaded more than once.
+    vector<Texture> textures_loaded;	// every texture the model uses, once each
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    // with a streamer, textures load in the background and show a placeholder until resident;
+    // one still on its way when the streamer is destroyed keeps the placeholder.
+    // VERTEX_PACKED quantizes the vertices on upload; draw those meshes with shader/mesh_packed.vert.
+    // Models of the same file and format share their meshes and textures through the AssetRegistry.
+    Model(string const &path, bool gamma = false, TextureStreamer *streamer = NULL, Vertex_Format format = VERTEX_FULL)
+        : gammaCorrection(gamma), streamer(streamer), vertexFormat(format), pool(NULL), poolModel(0)
     {
         loadModel(path);
     }
 
-    // draws the model, and thus all its meshes
+    // gives the shared meshes back; the last Model using them frees their buffers and textures
+    ~Model()
+    {
+        if (!assetKey.empty())
+            AssetRegistry::Get().models.Release(assetKey);
+    }
+
+    // draws the model, and thus all its meshes; from the pool, if it is in one
     void Draw(Shader &shader)
     {
+        if (pool)
+        {
+            pool->DrawModel(poolModel, shader.ID);
+            return;
+        }
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
+
+    // copies the meshes into pool, after which Draw takes one multi-draw per material batch instead
+    // of a draw per mesh. The shader given to Draw must then read the pool's draw data, as
+    // shader/mesh_mdi.vert does, and transform places the model. Needs GeometryPool::Supported();
+    // the pool must outlive the model.
+    void UsePool(GeometryPool &geometryPool, const glm::mat4 &transform = glm::mat4(1.0f))
+    {
+        pool = &geometryPool;
+        poolModel = pool->AddMeshes(meshes, transform);
+    }
+
+    // records the model's meshes into a command buffer instead of drawing them immediately.
+    // depth is the model's camera distance divided by the far plane.
+    void Record(CommandBuffer &commands, GLuint program, const glm::mat4 &model, float depth, Render_Pass pass = PASS_OPAQUE)
+    {
+        uint32_t uniforms = commands.PushUniforms(model, glm::vec3(1.0f));
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            const Mesh &mesh = meshes[i];
+            uint32_t material = mesh.textures.empty() ? 0 : mesh.textures[0].id;
+            commands.DrawMesh(MakeSortKey(pass, depth, LAYER_GEM, program, mesh.VAO, material), program, mesh, uniforms);
+        }
+    }
     
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    TextureStreamer *streamer;
+    Vertex_Format vertexFormat;
+    GeometryPool *pool;
+    unsigned int poolModel;     // the pool's handle for the meshes
+    string assetKey;
+    // registry key -> index in textures_loaded, while importing
+    unordered_map<string, size_t> textureIndex;
+
+    // shares the model's meshes from the registry, importing them if no other Model holds them
     void loadModel(string const &path)
     {
+        // retrieve the directory path of the filepath
+        directory = path.substr(0, path.find_last_of('/'));
+
+        assetKey = vertexFormat == VERTEX_PACKED ? path + "#packed" : path;
+        const ModelAsset &asset = AssetRegistry::Get().models.Acquire(assetKey, [&]() { return importModel(path); }, releaseModelAsset);
+        meshes = asset.meshes;
+        textures_loaded = asset.textures;
+    }
+
+    // frees what importModel created once the last Model using it is gone
+    static void releaseModelAsset(ModelAsset &asset)
+    {
+        for(unsigned int i = 0; i < asset.meshes.size(); i++)
+            asset.meshes[i].DeleteBuffers();
+        for(unsigned int i = 0; i < asset.textureKeys.size(); i++)
+            AssetRegistry::Get().textures.Release(asset.textureKeys[i]);
+    }
+
+    // loads the meshes and hands them over as a registry asset. Their CPU copies are dropped once
+    // uploaded and cached, so only the GL buffers hold the geometry, as with cache loads.
+    ModelAsset importModel(string const &path)
+    {
+        readModel(path);
+        ModelAsset asset;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            vector<Vertex>().swap(meshes[i].vertices);
+            vector<unsigned int>().swap(meshes[i].indices);
+        }
+        asset.meshes = std::move(meshes);
+        asset.textures = textures_loaded;
+        for(unordered_map<string, size_t>::iterator it = textureIndex.begin(); it != textureIndex.end(); ++it)
+            asset.textureKeys.push_back(it->first);
+        textureIndex.clear();
+        return asset;
+    }
+
+    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
+    // A processed copy is kept in <path>.meshcache; while it is newer than the source, assimp is skipped.
+    void readModel(string const &path)
+    {
+        string cachePath = MeshCache::PathFor(path);
+        if (CacheIsFresh(cachePath, path) && loadCache(cachePath))
+            return;
+
         // read file via ASSIMP
         Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs);
         // check for errors
         if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
         {
             cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
             return;
         }
-        // retrieve the directory path of the filepath
-        directory = path.substr(0, path.find_last_of('/'));
-
+        // tangents and bitangents are only read by normal mapping, so only generate them when a material has a normal map
+        if (hasNormalMaps(scene))
+            scene = importer.ApplyPostProcessing(aiProcess_CalcTangentSpace);
+        // meshes are constructed in place; reserving also keeps Mesh addresses stable for recorded draws
+        meshes.reserve(scene->mNumMeshes);
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
+
+        if (!MeshCache::Write(cachePath, meshes))
+            cout << "WARNING::MODEL:: could not write mesh cache " << cachePath << endl;
+    }
+
+    // builds the meshes from a mapped cache file, uploading the vertex and index data to GL without copying it
+    bool loadCache(string const &cachePath)
+    {
+        MeshCache cache;
+        if (!cache.Open(cachePath))
+            return false;
+        meshes.reserve(cache.MeshCount());
+        for(unsigned int i = 0; i < cache.MeshCount(); i++)
+        {
+            const CacheMesh &record = cache.GetMesh(i);
+            vector<Texture> textures;
+            for(unsigned int t = 0; t < record.textureCount; t++)
+                textures.push_back(loadTexture(cache.TexturePath(i, t).c_str(), cache.TextureType(i, t)));
+            meshes.emplace_back(cache.Vertices(i), record.vertexCount, cache.Indices(i), record.indexCount, std::move(textures), vertexFormat);
+        }
+        return true;
+    }
+
+    // normal maps come through as aiTextureType_HEIGHT for .obj files (see processMesh) and aiTextureType_NORMALS elsewhere
+    static bool hasNormalMaps(const aiScene *scene)
+    {
+        for(unsigned int i = 0; i < scene->mNumMaterials; i++)
+            if(scene->mMaterials[i]->GetTextureCount(aiTextureType_HEIGHT) > 0 || scene->mMaterials[i]->GetTextureCount(aiTextureType_NORMALS) > 0)
+                return true;
+        return false;
     }
 
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
@@ -73,7 +211,7 @@ private:
             // the node object only contains indices to index the actual objects in the scene. 
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
             aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            processMesh(mesh, scene);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
@@ -82,64 +220,59 @@ private:
         }
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // assimp uses its own vector class that doesn't directly convert to glm's vec3 class
+    static glm::vec3 toGlm(const aiVector3D &v)
     {
-        // data to fill
-        vector<Vertex> vertices;
+        return glm::vec3(v.x, v.y, v.z);
+    }
+
+    // builds a Mesh from an aiMesh and appends it to meshes. Vertex and index arrays are sized once and
+    // filled straight from assimp's arrays, then moved into the Mesh rather than copied.
+    void processMesh(aiMesh *mesh, const aiScene *scene)
+    {
+        // data to fill; value-initialised, so attributes the mesh doesn't have stay zero
+        vector<Vertex> vertices(mesh->mNumVertices);
         vector<unsigned int> indices;
         vector<Texture> textures;
 
         // walk through each of the mesh's vertices
+        const bool hasNormals = mesh->HasNormals();
+        const bool hasTangents = mesh->HasTangentsAndBitangents();
+        const aiVector3D* texCoords = mesh->mTextureCoords[0]; // we only use the first of up to 8 texture coordinate sets
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
+            Vertex &vertex = vertices[i];
+            vertex.Position = toGlm(mesh->mVertices[i]);
+            if (hasNormals)
+                vertex.Normal = toGlm(mesh->mNormals[i]);
+            if (texCoords)
             {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
+                vertex.TexCoords.x = texCoords[i].x;
+                vertex.TexCoords.y = texCoords[i].y;
             }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
+            if (hasTangents)
             {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't 
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x; 
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
+                vertex.Tangent = toGlm(mesh->mTangents[i]);
+                vertex.Bitangent = toGlm(mesh->mBitangents[i]);
             }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
         }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        // now walk through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
+        // Triangulation can still leave points and lines, so count first instead of assuming three per face.
+        size_t indexCount = 0;
+        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+            indexCount += mesh->mFaces[i].mNumIndices;
+        indices.resize(indexCount);
+        unsigned int* dst = indices.empty() ? NULL : &indices[0];
         for(unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);        
+            const aiFace &face = mesh->mFaces[i];
+            memcpy(dst, face.mIndices, face.mNumIndices * sizeof(unsigned int));
+            dst += face.mNumIndices;
         }
+        // reorder for the vertex cache, overdraw and vertex fetch. Only pure triangle lists; the
+        // optimised order is what gets written to the mesh cache.
+        if (mesh->mPrimitiveTypes == aiPrimitiveType_TRIANGLE)
+            OptimizeMesh(vertices, indices);
         // process materials
         aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
@@ -162,8 +295,8 @@ private:
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
         
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        // create the mesh object in place, handing it the extracted data
+        meshes.emplace_back(std::move(vertices), std::move(indices), std::move(textures), vertexFormat);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -175,29 +308,46 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            textures.push_back(loadTexture(str.C_Str(), typeName));
         }
         return textures;
     }
+
+    // loads a texture relative to the model's directory. Each file is loaded once per process: the
+    // registry hands out the texture any other model already loaded, and this model keeps one
+    // reference to it however many of its meshes use it.
+    Texture loadTexture(const char *path, const string &typeName)
+    {
+        Texture texture;
+        texture.type = typeName;
+        texture.path = path;
+        string key = NormalizeAssetPath(this->directory + '/' + path);
+        unordered_map<string, size_t>::iterator it = textureIndex.find(key);
+        if (it != textureIndex.end())
+        {
+            texture.id = textures_loaded[it->second].id;
+            return texture;
+        }
+
+        // the registry can free the texture after this Model and its streamer are gone
+        TextureStreamer::Handle textureStreamer = streamer ? streamer->GetHandle() : TextureStreamer::Handle();
+        texture.id = AssetRegistry::Get().textures.Acquire(key, [&]() -> unsigned int {
+            if (streamer)
+            {
+                // flat normal until a normal map arrives, white for everything else
+                static const unsigned char flatNormal[4] = { 128, 128, 255, 255 };
+                return streamer->Request(key, typeName == "texture_normal" ? flatNormal : NULL);
+            }
+            return TextureFromFile(path, this->directory);
+        }, [textureStreamer](unsigned int &id) {
+            // the image may still be on its way
+            TextureStreamer::Cancel(textureStreamer, id);
+            glDeleteTextures(1, &id);
+        });
+        textureIndex[key] = textures_loaded.size();
+        textures_loaded.push_back(texture);
+        return texture;
+    }
 };
 
 unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
@@ -208,6 +358,21 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
     unsigned int textureID;
     glGenTextures(1, &textureID);
 
+    // block compressed with its mip chain from the texture cache where the context supports it
+    static CompressionSupport support = CompressionSupport::Query();
+    CompressedTexture compressed;
+    if (LoadCompressedTexture(filename, support, compressed))
+    {
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        UploadCompressedTexture(GL_TEXTURE_2D, compressed);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)compressed.levels.size() - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        return textureID;
+    }
+
     int width, height, nrComponents;
     unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
     if (data)
@@ -0,0 +1,112 @@
+#ifndef POST_AA_H
+#define POST_AA_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include "gpu_timer.h"
+
+// FXAA-style anti-aliasing as a post pass, instead of multisampling the blended gem pass.
+// It finds luma edges in the finished image, walks along each edge to its ends and re-samples
+// across it with the offset that matches the edge's slope; a separate sub-pixel term softens
+// details thinner than a pixel, such as the far wireframe edges.
+//
+// The pass reads a region of an offscreen colour texture and writes the whole current viewport,
+// so when the scene was rendered at a lower resolution the same pass also does the upscale.
+// Draw with shader/fullscreen.vert and shader/fxaa.frag.
+enum AA_Preset {
+    AA_OFF = 0,
+    AA_LOW,         // 4 search steps, only strong edges
+    AA_MEDIUM,      // 8 steps
+    AA_HIGH,        // 12 steps, low contrast edges and full sub-pixel softening
+    AA_PRESET_COUNT
+};
+
+struct AASettings {
+    float edgeThreshold;     // contrast needed for an edge, relative to the local maximum luma
+    float edgeThresholdMin;  // absolute minimum, keeps dark areas from being processed
+    float subpixel;          // amount of sub-pixel softening, 0 to 1
+    int searchSteps;         // samples along the edge in each direction
+};
+
+inline AASettings AAPresetSettings(AA_Preset preset)
+{
+    static const AASettings presets[AA_PRESET_COUNT] = {
+        { 1.0f,   1.0f,    0.0f,  0 },
+        { 0.250f, 0.0833f, 0.50f, 4 },
+        { 0.166f, 0.0625f, 0.75f, 8 },
+        { 0.125f, 0.0312f, 1.00f, 12 },
+    };
+    return presets[preset];
+}
+
+inline const char* AAPresetName(AA_Preset preset)
+{
+    static const char* names[AA_PRESET_COUNT] = { "off", "low", "medium", "high" };
+    return names[preset];
+}
+
+class PostAA {
+public:
+    PostAA(unsigned int program) : program(program), vao(0)
+    {
+        sceneLocation = glGetUniformLocation(program, "scene");
+        texelLocation = glGetUniformLocation(program, "texelSize");
+        regionLocation = glGetUniformLocation(program, "regionScale");
+        thresholdLocation = glGetUniformLocation(program, "edgeThreshold");
+        thresholdMinLocation = glGetUniformLocation(program, "edgeThresholdMin");
+        subpixelLocation = glGetUniformLocation(program, "subpixel");
+        stepsLocation = glGetUniformLocation(program, "searchSteps");
+    }
+
+    ~PostAA()
+    {
+        if (vao != 0)
+            glDeleteVertexArrays(1, &vao);
+    }
+
+    // filters the lower left regionWidth x regionHeight of texture (textureWidth x textureHeight)
+    // into the current framebuffer and viewport, timing the pass
+    void Apply(GLuint texture, int textureWidth, int textureHeight, int regionWidth, int regionHeight, AA_Preset preset)
+    {
+        if (vao == 0)
+            glGenVertexArrays(1, &vao); // the fullscreen triangle comes from gl_VertexID
+        AASettings settings = AAPresetSettings(preset);
+
+        timer.Begin();
+        GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        GLboolean blend = glIsEnabled(GL_BLEND);
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+
+        glUseProgram(program);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glUniform1i(sceneLocation, 0);
+        glUniform2f(texelLocation, 1.0f / (float)textureWidth, 1.0f / (float)textureHeight);
+        glUniform2f(regionLocation, (float)regionWidth / (float)textureWidth, (float)regionHeight / (float)textureHeight);
+        glUniform1f(thresholdLocation, settings.edgeThreshold);
+        glUniform1f(thresholdMinLocation, settings.edgeThresholdMin);
+        glUniform1f(subpixelLocation, settings.subpixel);
+        glUniform1i(stepsLocation, settings.searchSteps);
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+
+        if (depthTest)
+            glEnable(GL_DEPTH_TEST);
+        if (blend)
+            glEnable(GL_BLEND);
+        timer.End();
+    }
+
+    // GPU time of the pass in milliseconds, a few frames old; negative before the first result
+    float LastGpuMs() { return (float)timer.LastMs(); }
+
+private:
+    unsigned int program;
+    GLuint vao;
+    GpuTimer timer;
+    GLint sceneLocation, texelLocation, regionLocation;
+    GLint thresholdLocation, thresholdMinLocation, subpixelLocation, stepsLocation;
+};
+#endif
@@ -0,0 +1,739 @@
+#ifndef RAY_TRACER_H
+#define RAY_TRACER_H
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define RAY_TRACER_SSE2 1
+#endif
+
+#include "gem_scene.h"
+#include "soft_raster.h" // SoftCubemap
+
+using namespace std;
+
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    AABB() : min(1e30f), max(-1e30f) {}
+
+    void grow(const glm::vec3 &p)
+    {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    void grow(const AABB &b)
+    {
+        min = glm::min(min, b.min);
+        max = glm::max(max, b.max);
+    }
+    float area() const
+    {
+        glm::vec3 e = max - min;
+        if (e.x < 0.0f)
+            return 0.0f;
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+};
+
+// 32-byte BVH node. Interior nodes have count == 0 and their children at leftFirst and
+// leftFirst + 1; leaves hold count primitives starting at leftFirst in the index list.
+struct BVHNode {
+    glm::vec3 boundsMin;
+    uint32_t leftFirst;
+    glm::vec3 boundsMax;
+    uint32_t count;
+};
+
+// Binned SAH builder over primitive bounds; used for the per-mesh and the instance level.
+class BVH {
+public:
+    vector<BVHNode> nodes;
+    vector<uint32_t> indices;
+
+    void Build(const vector<AABB> &primBounds)
+    {
+        bounds = primBounds;
+        centroids.resize(bounds.size());
+        indices.resize(bounds.size());
+        for (unsigned int i = 0; i < bounds.size(); i++)
+        {
+            centroids[i] = (bounds[i].min + bounds[i].max) * 0.5f;
+            indices[i] = i;
+        }
+        nodes.clear();
+        nodes.reserve(bounds.size() * 2 + 1);
+        BVHNode root;
+        root.leftFirst = 0;
+        root.count = (uint32_t)bounds.size();
+        nodes.push_back(root);
+        subdivide(0);
+        bounds.clear();
+        centroids.clear();
+    }
+
+private:
+    static const int BINS = 12;
+    static const uint32_t MAX_LEAF = 8;
+    vector<AABB> bounds;
+    vector<glm::vec3> centroids;
+
+    void subdivide(uint32_t nodeIndex)
+    {
+        uint32_t first = nodes[nodeIndex].leftFirst, count = nodes[nodeIndex].count;
+        AABB nodeBounds, centroidBounds;
+        for (uint32_t i = first; i < first + count; i++)
+        {
+            nodeBounds.grow(bounds[indices[i]]);
+            centroidBounds.grow(centroids[indices[i]]);
+        }
+        nodes[nodeIndex].boundsMin = nodeBounds.min;
+        nodes[nodeIndex].boundsMax = nodeBounds.max;
+        if (count <= 2)
+            return;
+
+        // pick the cheapest split plane over all axes
+        int bestAxis = -1, bestSplit = 0;
+        float bestCost = 1e30f;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float lo = centroidBounds.min[axis], extent = centroidBounds.max[axis] - lo;
+            if (extent <= 0.0f)
+                continue;
+            AABB binBounds[BINS];
+            uint32_t binCount[BINS] = { 0 };
+            float scale = BINS / extent;
+            for (uint32_t i = first; i < first + count; i++)
+            {
+                int b = std::min(BINS - 1, (int)((centroids[indices[i]][axis] - lo) * scale));
+                binCount[b]++;
+                binBounds[b].grow(bounds[indices[i]]);
+            }
+            float leftArea[BINS - 1], rightArea[BINS - 1];
+            uint32_t leftCount[BINS - 1], rightCount[BINS - 1];
+            AABB leftBox, rightBox;
+            uint32_t leftSum = 0, rightSum = 0;
+            for (int i = 0; i < BINS - 1; i++)
+            {
+                leftSum += binCount[i];
+                leftCount[i] = leftSum;
+                leftBox.grow(binBounds[i]);
+                leftArea[i] = leftBox.area();
+                rightSum += binCount[BINS - 1 - i];
+                rightCount[BINS - 2 - i] = rightSum;
+                rightBox.grow(binBounds[BINS - 1 - i]);
+                rightArea[BINS - 2 - i] = rightBox.area();
+            }
+            for (int i = 0; i < BINS - 1; i++)
+            {
+                float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                if (leftCount[i] > 0 && rightCount[i] > 0 && cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        float leafCost = count * nodeBounds.area();
+        if (bestAxis < 0 || (bestCost >= leafCost && count <= MAX_LEAF))
+            return;
+
+        // partition the index range around the chosen bin boundary
+        float lo = centroidBounds.min[bestAxis];
+        float scale = BINS / (centroidBounds.max[bestAxis] - lo);
+        uint32_t i = first, j = first + count - 1;
+        while (i <= j)
+        {
+            int b = std::min(BINS - 1, (int)((centroids[indices[i]][bestAxis] - lo) * scale));
+            if (b <= bestSplit)
+                i++;
+            else
+            {
+                std::swap(indices[i], indices[j]);
+                if (j == 0)
+                    break;
+                j--;
+            }
+        }
+        uint32_t leftCount = i - first;
+        if (leftCount == 0 || leftCount == count)
+            return;
+
+        uint32_t left = (uint32_t)nodes.size();
+        BVHNode child;
+        child.leftFirst = first;
+        child.count = leftCount;
+        nodes.push_back(child);
+        child.leftFirst = i;
+        child.count = count - leftCount;
+        nodes.push_back(child);
+        nodes[nodeIndex].leftFirst = left;
+        nodes[nodeIndex].count = 0;
+        subdivide(left);
+        subdivide(left + 1);
+    }
+};
+
+// Up to four rays traced together; lanes outside the active mask are ignored.
+struct RayPacket {
+    float ox[4], oy[4], oz[4];
+    float dx[4], dy[4], dz[4];
+    float t[4];
+    int instance[4];
+    int prim[4];
+    int active;
+};
+
+// One gem instance for the top-level BVH.
+struct TraceInstance {
+    glm::mat4 model;
+    glm::vec3 color;    // gem color before colorMult
+};
+
+struct TraceSettings {
+    int maxBounces;         // reflection/refraction events per camera ray
+    float absorption;       // Beer-Lambert density for the channels a gem doesn't pass
+    float cutoff;           // stop following branches whose contribution falls below this
+    int threads;            // 0 = one per core
+    int tileSize;
+
+    TraceSettings() : maxBounces(8), absorption(1.5f), cutoff(0.01f), threads(0), tileSize(16) {}
+};
+
+// CPU ray tracer for the gems. Every instance shares one SAH BVH over the gem triangles in
+// object space; a second BVH over the instances' world bounds sits on top. Camera rays are
+// traced as 2x2 packets with SSE slab tests, secondary rays one at a time. Each ray splits into
+// a reflected and a refracted branch weighted by the exact dielectric Fresnel term, with the
+// emerald index from gem.frag and total internal reflection inside the gem.
+// Tiles are dealt out to threads in contiguous runs; a thread that finishes early steals tiles
+// from the back of another thread's run.
+class RayTracer {
+public:
+    RayTracer() : frameIndex(0), accumWidth(0), accumHeight(0)
+    {
+        // object-space triangles of the gem, with their geometric normals
+        vector<AABB> primBounds;
+        for (int v = 0; v < gemVertexCount; v += 3)
+        {
+            Triangle tri;
+            glm::vec3 p[3];
+            AABB box;
+            for (int k = 0; k < 3; k++)
+            {
+                const float* src = &gemVertices[(v + k) * 6];
+                p[k] = glm::vec3(src[0], src[1], src[2]);
+                box.grow(p[k]);
+            }
+            tri.v0 = p[0];
+            tri.e1 = p[1] - p[0];
+            tri.e2 = p[2] - p[0];
+            tri.normal = glm::normalize(glm::cross(tri.e1, tri.e2));
+            // keep the geometric normal on the same side as the authored one
+            const float* n = &gemVertices[v * 6 + 3];
+            if (glm::dot(tri.normal, glm::vec3(n[0], n[1], n[2])) < 0.0f)
+                tri.normal = -tri.normal;
+            triangles.push_back(tri);
+            primBounds.push_back(box);
+        }
+        meshBVH.Build(primBounds);
+    }
+
+    // rebuilds the instance level; call whenever gems move
+    void SetInstances(const vector<TraceInstance> &scene)
+    {
+        instances.clear();
+        vector<AABB> instanceBounds;
+        const BVHNode &root = meshBVH.nodes[0];
+        for (unsigned int i = 0; i < scene.size(); i++)
+        {
+            Instance inst;
+            inst.toWorld = scene[i].model;
+            inst.toObject = glm::inverse(scene[i].model);
+            inst.normalMatrix = glm::mat3(glm::transpose(inst.toObject));
+            glm::vec3 c = scene[i].color;
+            float peak = std::max(std::max(c.x, c.y), std::max(c.z, 1e-3f));
+            inst.tint = c / peak;
+            instances.push_back(inst);
+
+            AABB box;
+            for (int k = 0; k < 8; k++)
+            {
+                glm::vec3 corner((k & 1) ? root.boundsMax.x : root.boundsMin.x,
+                                 (k & 2) ? root.boundsMax.y : root.boundsMin.y,
+                                 (k & 4) ? root.boundsMax.z : root.boundsMin.z);
+                box.grow(glm::vec3(inst.toWorld * glm::vec4(corner, 1.0f)));
+            }
+            instanceBounds.push_back(box);
+        }
+        sceneBVH.Build(instanceBounds);
+    }
+
+    // drops the progressive accumulation, e.g. after the camera moved
+    void ResetAccumulation()
+    {
+        frameIndex = 0;
+    }
+
+    // Traces one sample per pixel and adds it to the accumulation buffer, then resolves the
+    // running average into pixels (RGB8, bottom row first like glTexImage2D expects).
+    void Render(int width, int height, const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPos,
+                const SoftCubemap &skybox, vector<unsigned char> &pixels, const TraceSettings &settings = TraceSettings())
+    {
+        if (width != accumWidth || height != accumHeight)
+        {
+            accumWidth = width;
+            accumHeight = height;
+            frameIndex = 0;
+        }
+        if (frameIndex == 0)
+            accum.assign(width * height, glm::vec3(0.0f));
+        frameIndex++;
+        pixels.resize(width * height * 3);
+
+        job.width = width;
+        job.height = height;
+        job.inverseViewProjection = glm::inverse(projection * view);
+        job.cameraPos = cameraPos;
+        job.skybox = &skybox;
+        job.settings = settings;
+        job.pixels = &pixels[0];
+        job.tilesX = (width + settings.tileSize - 1) / settings.tileSize;
+        int tileCount = job.tilesX * ((height + settings.tileSize - 1) / settings.tileSize);
+
+        int threadCount = settings.threads > 0 ? settings.threads : (int)std::thread::hardware_concurrency();
+        threadCount = std::max(1, std::min(threadCount, tileCount));
+
+        // split the tiles into one contiguous run per thread
+        queues = vector<TileQueue>(threadCount);
+        for (int i = 0; i < threadCount; i++)
+        {
+            uint32_t begin = (uint32_t)((int64_t)tileCount * i / threadCount);
+            uint32_t end = (uint32_t)((int64_t)tileCount * (i + 1) / threadCount);
+            queues[i].range.store(((uint64_t)end << 32) | begin);
+        }
+
+        vector<std::thread> workers;
+        for (int i = 1; i < threadCount; i++)
+            workers.push_back(std::thread(&RayTracer::worker, this, i));
+        worker(0);
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    bool WritePPM(const std::string &path, int width, int height, const vector<unsigned char> &pixels) const
+    {
+        FILE* fp = fopen(path.c_str(), "wb");
+        if (fp == NULL)
+        {
+            std::cout << "Failed to write image: " << path << std::endl;
+            return false;
+        }
+        fprintf(fp, "P6\n%d %d\n255\n", width, height);
+        for (int y = height - 1; y >= 0; y--)
+            fwrite(&pixels[y * width * 3], 1, width * 3, fp);
+        fclose(fp);
+        return true;
+    }
+
+private:
+    struct Triangle {
+        glm::vec3 v0, e1, e2;
+        glm::vec3 normal;
+    };
+
+    struct Instance {
+        glm::mat4 toWorld;
+        glm::mat4 toObject;
+        glm::mat3 normalMatrix;
+        glm::vec3 tint;
+    };
+
+    // A thread's run of tiles as [begin, end) packed into one word, so the owner popping the
+    // front and thieves taking the back can both use a single compare-and-swap.
+    struct TileQueue {
+        std::atomic<uint64_t> range;
+        TileQueue() : range(0) {}
+        TileQueue(const TileQueue &) : range(0) {}
+    };
+
+    struct Job {
+        int width, height, tilesX;
+        glm::mat4 inverseViewProjection;
+        glm::vec3 cameraPos;
+        const SoftCubemap* skybox;
+        TraceSettings settings;
+        unsigned char* pixels;
+    };
+
+    vector<Triangle> triangles;
+    vector<Instance> instances;
+    BVH meshBVH;
+    BVH sceneBVH;
+    vector<TileQueue> queues;
+    Job job;
+    uint32_t frameIndex;
+    int accumWidth, accumHeight;
+    vector<glm::vec3> accum;
+
+    static bool popFront(TileQueue &q, uint32_t &tile)
+    {
+        uint64_t r = q.range.load();
+        while ((uint32_t)r < (uint32_t)(r >> 32))
+        {
+            if (q.range.compare_exchange_weak(r, r + 1))
+            {
+                tile = (uint32_t)r;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static bool stealBack(TileQueue &q, uint32_t &tile)
+    {
+        uint64_t r = q.range.load();
+        while ((uint32_t)r < (uint32_t)(r >> 32))
+        {
+            uint32_t end = (uint32_t)(r >> 32) - 1;
+            if (q.range.compare_exchange_weak(r, ((uint64_t)end << 32) | (uint32_t)r))
+            {
+                tile = end;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void worker(int self)
+    {
+        uint32_t tile;
+        for (;;)
+        {
+            if (popFront(queues[self], tile))
+            {
+                renderTile(tile);
+                continue;
+            }
+            bool stole = false;
+            for (unsigned int k = 1; k < queues.size() && !stole; k++)
+                stole = stealBack(queues[(self + k) % queues.size()], tile);
+            if (!stole)
+                return;
+            renderTile(tile);
+        }
+    }
+
+    // cheap integer hash for per-pixel, per-frame jitter
+    static float jitter(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352d;
+        x ^= x >> 15;
+        x *= 0x846ca68b;
+        x ^= x >> 16;
+        return (x & 0xFFFFFF) / 16777216.0f;
+    }
+
+    glm::vec3 cameraRay(float px, float py) const
+    {
+        float ndcX = px / job.width * 2.0f - 1.0f;
+        float ndcY = py / job.height * 2.0f - 1.0f;
+        glm::vec4 farPoint = job.inverseViewProjection * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+        return glm::normalize(glm::vec3(farPoint) / farPoint.w - job.cameraPos);
+    }
+
+    void renderTile(uint32_t tile)
+    {
+        int size = job.settings.tileSize;
+        int x0 = (tile % job.tilesX) * size, y0 = (tile / job.tilesX) * size;
+        int x1 = std::min(x0 + size, job.width), y1 = std::min(y0 + size, job.height);
+
+        // camera rays as 2x2 packets
+        for (int y = y0; y < y1; y += 2)
+        {
+            for (int x = x0; x < x1; x += 2)
+            {
+                // zeroed, so lanes past the tile edge hold defined values for the SIMD box tests
+                RayPacket packet = RayPacket();
+                packet.active = 0;
+                for (int k = 0; k < 4; k++)
+                {
+                    int px = x + (k & 1), py = y + (k >> 1);
+                    packet.t[k] = 1e30f;
+                    packet.instance[k] = -1;
+                    if (px >= x1 || py >= y1)
+                        continue;
+                    uint32_t seed = (uint32_t)(py * job.width + px) * 2654435761u + frameIndex * 40503u;
+                    glm::vec3 d = cameraRay(px + jitter(seed), py + jitter(seed ^ 0x9e3779b9u));
+                    setLane(packet, k, job.cameraPos, d);
+                    packet.active |= 1 << k;
+                }
+                intersect(packet);
+
+                for (int k = 0; k < 4; k++)
+                {
+                    if (!(packet.active & (1 << k)))
+                        continue;
+                    glm::vec3 origin(packet.ox[k], packet.oy[k], packet.oz[k]);
+                    glm::vec3 dir(packet.dx[k], packet.dy[k], packet.dz[k]);
+                    glm::vec3 c = shadeHit(origin, dir, packet.t[k], packet.instance[k], packet.prim[k], false, 0, 1.0f);
+
+                    int p = (y + (k >> 1)) * job.width + x + (k & 1);
+                    accum[p] += c;
+                    glm::vec3 average = accum[p] / (float)frameIndex;
+                    for (int i = 0; i < 3; i++)
+                        job.pixels[p * 3 + i] = (unsigned char)(glm::clamp(average[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+                }
+            }
+        }
+    }
+
+    static void setLane(RayPacket &packet, int k, const glm::vec3 &o, const glm::vec3 &d)
+    {
+        packet.ox[k] = o.x; packet.oy[k] = o.y; packet.oz[k] = o.z;
+        packet.dx[k] = d.x; packet.dy[k] = d.y; packet.dz[k] = d.z;
+    }
+
+    // traces a single ray and shades whatever it hits
+    glm::vec3 trace(const glm::vec3 &origin, const glm::vec3 &dir, bool inside, int depth, float weight) const
+    {
+        // lanes 1-3 are inactive but still go through the SIMD box tests, so zero them
+        RayPacket packet = RayPacket();
+        setLane(packet, 0, origin, dir);
+        packet.t[0] = 1e30f;
+        packet.instance[0] = -1;
+        packet.active = 1;
+        intersect(packet);
+        return shadeHit(origin, dir, packet.t[0], packet.instance[0], packet.prim[0], inside, depth, weight);
+    }
+
+    // exact Fresnel reflectance for unpolarized light; 1 on total internal reflection
+    static float fresnel(float cosI, float eta)
+    {
+        float sinT2 = eta * eta * (1.0f - cosI * cosI);
+        if (sinT2 >= 1.0f)
+            return 1.0f;
+        float cosT = sqrtf(1.0f - sinT2);
+        float rs = (eta * cosI - cosT) / (eta * cosI + cosT);
+        float rp = (cosI - eta * cosT) / (cosI + eta * cosT);
+        return 0.5f * (rs * rs + rp * rp);
+    }
+
+    glm::vec3 shadeHit(const glm::vec3 &origin, const glm::vec3 &dir, float t, int instanceIndex, int prim,
+                       bool inside, int depth, float weight) const
+    {
+        if (instanceIndex < 0)
+            return job.skybox->Sample(dir);
+
+        const Instance &inst = instances[instanceIndex];
+        glm::vec3 position = origin + dir * t;
+        glm::vec3 normal = glm::normalize(inst.normalMatrix * triangles[prim].normal);
+        bool entering = glm::dot(dir, normal) < 0.0f;
+        if (!entering)
+            normal = -normal;
+        float cosI = -glm::dot(dir, normal);
+        float eta = entering ? refractionRatio : 1.0f / refractionRatio;
+        float F = fresnel(cosI, eta);
+
+        glm::vec3 color(0.0f);
+        if (entering)
+        {
+            // the point light's highlight on the outer surface, as in gem.frag
+            glm::vec3 lightDir = glm::normalize(lightPos - position);
+            float spec = powf(std::max(glm::dot(-dir, glm::reflect(-lightDir, normal)), 0.0f), materialShininess);
+            color += lightSpecular * (spec * materialSpecular) * (1.0f - lightingResistance);
+        }
+
+        const float epsilon = 1e-4f;
+        glm::vec3 reflected = glm::reflect(dir, normal);
+        if (depth >= job.settings.maxBounces)
+        {
+            // out of bounces: let the ray escape along the reflection
+            color += job.skybox->Sample(reflected);
+        }
+        else
+        {
+            if (F * weight > job.settings.cutoff)
+                color += F * trace(position + normal * epsilon, reflected, inside, depth + 1, weight * F);
+            if (F < 1.0f && (1.0f - F) * weight > job.settings.cutoff)
+            {
+                glm::vec3 refracted = glm::normalize(glm::refract(dir, normal, eta));
+                color += (1.0f - F) * trace(position - normal * epsilon, refracted, !inside, depth + 1, weight * (1.0f - F));
+            }
+        }
+
+        // light reaching us from inside the gem was absorbed along the way
+        if (inside)
+        {
+            glm::vec3 sigma = (glm::vec3(1.0f) - inst.tint) * job.settings.absorption;
+            color *= glm::vec3(expf(-sigma.x * t), expf(-sigma.y * t), expf(-sigma.z * t));
+        }
+        return color;
+    }
+
+    // slab test of up to four rays against a box; returns the mask of lanes that hit it
+    // closer than their current t
+    static int intersectBox(const RayPacket &p, const float* inv, const glm::vec3 &bmin, const glm::vec3 &bmax)
+    {
+#ifdef RAY_TRACER_SSE2
+        __m128 ox = _mm_loadu_ps(p.ox), oy = _mm_loadu_ps(p.oy), oz = _mm_loadu_ps(p.oz);
+        __m128 ix = _mm_loadu_ps(inv), iy = _mm_loadu_ps(inv + 4), iz = _mm_loadu_ps(inv + 8);
+        __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmin.x), ox), ix);
+        __m128 tx2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmax.x), ox), ix);
+        __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmin.y), oy), iy);
+        __m128 ty2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmax.y), oy), iy);
+        __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmin.z), oz), iz);
+        __m128 tz2 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmax.z), oz), iz);
+        __m128 tmin = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx1, tx2), _mm_min_ps(ty1, ty2)), _mm_min_ps(tz1, tz2));
+        __m128 tmax = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx1, tx2), _mm_max_ps(ty1, ty2)), _mm_max_ps(tz1, tz2));
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(tmax, tmin),
+                                _mm_and_ps(_mm_cmpgt_ps(tmax, _mm_setzero_ps()), _mm_cmplt_ps(tmin, _mm_loadu_ps(p.t))));
+        return _mm_movemask_ps(hit) & p.active;
+#else
+        int mask = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            if (!(p.active & (1 << k)))
+                continue;
+            float tx1 = (bmin.x - p.ox[k]) * inv[k], tx2 = (bmax.x - p.ox[k]) * inv[k];
+            float ty1 = (bmin.y - p.oy[k]) * inv[4 + k], ty2 = (bmax.y - p.oy[k]) * inv[4 + k];
+            float tz1 = (bmin.z - p.oz[k]) * inv[8 + k], tz2 = (bmax.z - p.oz[k]) * inv[8 + k];
+            float tmin = std::max(std::max(std::min(tx1, tx2), std::min(ty1, ty2)), std::min(tz1, tz2));
+            float tmax = std::min(std::min(std::max(tx1, tx2), std::max(ty1, ty2)), std::max(tz1, tz2));
+            if (tmax >= tmin && tmax > 0.0f && tmin < p.t[k])
+                mask |= 1 << k;
+        }
+        return mask;
+#endif
+    }
+
+    static void inverseDirections(const RayPacket &p, float* inv)
+    {
+        for (int k = 0; k < 4; k++)
+        {
+            inv[k] = 1.0f / p.dx[k];
+            inv[4 + k] = 1.0f / p.dy[k];
+            inv[8 + k] = 1.0f / p.dz[k];
+        }
+    }
+
+    // walks the instance BVH; each instance leaf re-expresses the packet in object space and
+    // walks the shared mesh BVH. The transform is affine and directions stay unnormalized, so
+    // hit distances are the same in both spaces.
+    void intersect(RayPacket &packet) const
+    {
+        if (sceneBVH.nodes.empty())
+            return;
+        float inv[12];
+        inverseDirections(packet, inv);
+
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const BVHNode &node = sceneBVH.nodes[stack[--top]];
+            if (!intersectBox(packet, inv, node.boundsMin, node.boundsMax))
+                continue;
+            if (node.count == 0)
+            {
+                stack[top++] = node.leftFirst + 1;
+                stack[top++] = node.leftFirst;
+                continue;
+            }
+            for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++)
+            {
+                uint32_t instanceIndex = sceneBVH.indices[i];
+                const glm::mat4 &toObject = instances[instanceIndex].toObject;
+                RayPacket local = packet;
+                for (int k = 0; k < 4; k++)
+                {
+                    if (!(packet.active & (1 << k)))
+                        continue;
+                    glm::vec3 o = glm::vec3(toObject * glm::vec4(packet.ox[k], packet.oy[k], packet.oz[k], 1.0f));
+                    glm::vec3 d = glm::vec3(toObject * glm::vec4(packet.dx[k], packet.dy[k], packet.dz[k], 0.0f));
+                    setLane(local, k, o, d);
+                }
+                intersectMesh(local);
+                for (int k = 0; k < 4; k++)
+                {
+                    if ((packet.active & (1 << k)) && local.t[k] < packet.t[k])
+                    {
+                        packet.t[k] = local.t[k];
+                        packet.prim[k] = local.prim[k];
+                        packet.instance[k] = (int)instanceIndex;
+                    }
+                }
+            }
+        }
+    }
+
+    void intersectMesh(RayPacket &packet) const
+    {
+        float inv[12];
+        inverseDirections(packet, inv);
+
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0)
+        {
+            const BVHNode &node = meshBVH.nodes[stack[--top]];
+            int mask = intersectBox(packet, inv, node.boundsMin, node.boundsMax);
+            if (!mask)
+                continue;
+            if (node.count == 0)
+            {
+                stack[top++] = node.leftFirst + 1;
+                stack[top++] = node.leftFirst;
+                continue;
+            }
+            for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++)
+            {
+                uint32_t prim = meshBVH.indices[i];
+                const Triangle &tri = triangles[prim];
+                for (int k = 0; k < 4; k++)
+                {
+                    if (!(mask & (1 << k)))
+                        continue;
+                    // Moller-Trumbore
+                    glm::vec3 d(packet.dx[k], packet.dy[k], packet.dz[k]);
+                    glm::vec3 h = glm::cross(d, tri.e2);
+                    float a = glm::dot(tri.e1, h);
+                    if (fabsf(a) < 1e-9f)
+                        continue;
+                    float f = 1.0f / a;
+                    glm::vec3 s = glm::vec3(packet.ox[k], packet.oy[k], packet.oz[k]) - tri.v0;
+                    float u = f * glm::dot(s, h);
+                    if (u < 0.0f || u > 1.0f)
+                        continue;
+                    glm::vec3 q = glm::cross(s, tri.e1);
+                    float v = f * glm::dot(d, q);
+                    if (v < 0.0f || u + v > 1.0f)
+                        continue;
+                    float t = f * glm::dot(tri.e2, q);
+                    if (t > 0.0f && t < packet.t[k])
+                    {
+                        packet.t[k] = t;
+                        packet.prim[k] = (int)prim;
+                    }
+                }
+            }
+        }
+    }
+};
+#endif
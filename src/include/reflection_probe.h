@@ -0,0 +1,146 @@
+#ifndef REFLECTION_PROBE_H
+#define REFLECTION_PROBE_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <functional>
+#include "gpu_timer.h"
+
+// Dynamic environment cubemap, re-rendered from one point in the scene so reflective objects can
+// show each other and not only the static skybox.
+//
+// Rendering six scene passes every frame would cost more than the gems themselves, so Update()
+// renders a few faces per call in round-robin order: as many as fit in BudgetMs going by the
+// measured GPU cost of a face, at least one and never more than a full cycle. The first call
+// renders all six so nothing samples an empty face. The probe is small (its reflections are
+// seen through curved facets) and gets a full mip chain, so it can be sampled like the skybox.
+//
+// The callback draws the scene with the view and projection of one face into the bound
+// framebuffer. Whatever it draws must not sample the probe itself.
+class ReflectionProbe {
+public:
+    glm::vec3 Center;
+    float BudgetMs;         // GPU time to spend per Update()
+
+    typedef std::function<void(const glm::mat4 &view, const glm::mat4 &projection)> DrawFace;
+
+    ReflectionProbe(int faceSize = 128, const glm::vec3 &center = glm::vec3(0.0f), float budgetMs = 0.5f)
+        : Center(center), BudgetMs(budgetMs), size(faceSize), levels(1), cubemap(0), fbo(0), depthBuffer(0),
+          nextFace(0), primed(false)
+    {
+        while ((size >> levels) > 0)
+            levels++;
+    }
+
+    ~ReflectionProbe()
+    {
+        if (fbo != 0)
+        {
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteTextures(1, &cubemap);
+            glDeleteRenderbuffers(1, &depthBuffer);
+        }
+    }
+
+    // renders this frame's faces with drawFace and refreshes the mip chain. Restores the
+    // framebuffer binding and viewport.
+    void Update(const DrawFace &drawFace, float nearPlane, float farPlane)
+    {
+        if (fbo == 0)
+            create();
+
+        int faces = 6;
+        if (primed)
+        {
+            float faceMs = timer.LastMs();
+            faces = faceMs > 0.0f ? (int)(BudgetMs / faceMs) : 1;
+            faces = std::min(std::max(faces, 1), 6);
+        }
+        primed = true;
+
+        GLint previousFramebuffer = 0;
+        GLint viewport[4];
+        glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, viewport);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, size, size);
+
+        glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, nearPlane, farPlane);
+        for (int i = 0; i < faces; i++)
+        {
+            // time one face only, so the measurement is the per face cost whatever the count
+            if (i == 0)
+                timer.Begin();
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + nextFace, cubemap, 0);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawFace(faceView(nextFace), projection);
+            if (i == 0)
+                timer.End();
+            nextFace = (nextFace + 1) % 6;
+        }
+
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    }
+
+    unsigned int Cubemap() const { return cubemap; }
+    int Size() const { return size; }
+    unsigned int Levels() const { return levels; }
+
+private:
+    int size;
+    unsigned int levels;
+    unsigned int cubemap;
+    unsigned int fbo;
+    unsigned int depthBuffer;
+    unsigned int nextFace;
+    bool primed;
+    GpuTimer timer;
+
+    // looks down a cube face from the centre; the up vectors follow the cubemap face layout
+    glm::mat4 faceView(unsigned int face) const
+    {
+        static const glm::vec3 directions[6] = {
+            glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(-1.0f,  0.0f,  0.0f),
+            glm::vec3( 0.0f,  1.0f,  0.0f), glm::vec3( 0.0f, -1.0f,  0.0f),
+            glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3( 0.0f,  0.0f, -1.0f)
+        };
+        static const glm::vec3 ups[6] = {
+            glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f),
+            glm::vec3(0.0f,  0.0f,  1.0f), glm::vec3(0.0f,  0.0f, -1.0f),
+            glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)
+        };
+        return glm::lookAt(Center, Center + directions[face], ups[face]);
+    }
+
+    void create()
+    {
+        glGenTextures(1, &cubemap);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+        for (unsigned int level = 0; level < levels; level++)
+            for (unsigned int face = 0; face < 6; face++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB8, size >> level, size >> level, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+        glGenRenderbuffers(1, &depthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X, cubemap, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+};
+#endif
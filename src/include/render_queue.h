@@ -0,0 +1,313 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <vector>
+#include "mesh.h"
+
+// Passes in the order they are replayed. The pass lives in the top bits of every sort key,
+// so everything in an earlier pass is drawn before anything in a later one.
+enum Render_Pass {
+    PASS_OPAQUE = 0,        // depth-writing geometry such as Model meshes
+    PASS_TRANSPARENT = 1,   // blended gems and their edges, back to front
+    PASS_SKYBOX = 2         // drawn last with GL_LEQUAL so it only fills untouched pixels
+};
+
+// Sub-order for draws that land on the same depth, e.g. a gem before its own wireframe edges.
+enum Render_Layer {
+    LAYER_GEM = 0,
+    LAYER_EDGE = 1
+};
+
+// Packet flags
+const uint32_t PACKET_INDEXED = 1 << 0;  // glDrawElements with unsigned int indices instead of glDrawArrays
+
+// Builds the 64-bit sort key of a draw.
+//   transparent: | pass:2 | depth:24 (far first) | layer:4 | program:8 | vao:8 | material:18 |
+//   otherwise:   | pass:2 | layer:4 | program:8 | vao:8 | material:18 | depth:24 (near first) |
+// depth is the camera distance divided by the far plane. Program, VAO and material ids are
+// truncated to their field widths; that only affects how well state changes are grouped,
+// never what gets drawn, since the packet carries the full names.
+inline uint64_t MakeSortKey(Render_Pass pass, float depth, Render_Layer layer, GLuint program, GLuint vao, uint32_t material)
+{
+    uint64_t d = (uint64_t)(std::min(std::max(depth, 0.0f), 1.0f) * 16777215.0f);
+    uint64_t state = ((uint64_t)(layer & 0xF) << 34) | ((uint64_t)(program & 0xFF) << 26) | ((uint64_t)(vao & 0xFF) << 18) | (material & 0x3FFFF);
+    uint64_t key = (uint64_t)pass << 62;
+    if (pass == PASS_TRANSPARENT)
+        key |= ((16777215 - d) << 38) | state;
+    else
+        key |= (state << 24) | d;
+    return key;
+}
+
+// A single recorded draw. Everything the replay needs is in here, so packets can be recorded
+// anywhere and executed later on the GL thread.
+struct DrawPacket {
+    GLuint program;
+    GLuint vao;
+    GLuint texture;         // bound to GL_TEXTURE0, 0 to leave the unit untouched
+    GLenum textureTarget;
+    GLenum primitive;
+    GLint first;
+    GLsizei count;
+    uint32_t flags;
+    float lineWidth;        // only applied to line primitives
+    uint32_t uniforms;      // index into the buffer's DrawUniforms
+    const Mesh* mesh;       // binds its material textures when set
+};
+
+// Per-draw uniforms. Anything constant over a frame (view, projection, lights) is set once per
+// program before the queue is submitted.
+struct DrawUniforms {
+    glm::mat4 model;
+    glm::vec3 color;
+};
+
+// Records draws for one thread. Buffers filled on worker threads are merged with Append() on the
+// GL thread before sorting.
+class CommandBuffer {
+public:
+    struct SortItem {
+        uint64_t key;
+        uint32_t packet;
+    };
+
+    vector<SortItem>     items;
+    vector<DrawPacket>   packets;
+    vector<DrawUniforms> uniforms;
+
+    void Clear()
+    {
+        items.clear();
+        packets.clear();
+        uniforms.clear();
+    }
+
+    // stores per-draw uniforms and returns their index for DrawPacket::uniforms
+    uint32_t PushUniforms(const glm::mat4 &model, const glm::vec3 &color)
+    {
+        DrawUniforms u;
+        u.model = model;
+        u.color = color;
+        uniforms.push_back(u);
+        return (uint32_t)(uniforms.size() - 1);
+    }
+
+    // records a non-indexed draw
+    void Draw(uint64_t key, GLuint program, GLuint vao, GLenum primitive, GLint first, GLsizei count,
+              uint32_t uniformIndex, GLuint texture = 0, GLenum textureTarget = GL_TEXTURE_2D, float lineWidth = 1.0f)
+    {
+        DrawPacket p;
+        p.program = program;
+        p.vao = vao;
+        p.texture = texture;
+        p.textureTarget = textureTarget;
+        p.primitive = primitive;
+        p.first = first;
+        p.count = count;
+        p.flags = 0;
+        p.lineWidth = lineWidth;
+        p.uniforms = uniformIndex;
+        p.mesh = NULL;
+        push(key, p);
+    }
+
+    // records a Mesh; its textures are bound on replay whenever the material changes
+    void DrawMesh(uint64_t key, GLuint program, const Mesh &mesh, uint32_t uniformIndex)
+    {
+        DrawPacket p;
+        p.program = program;
+        p.vao = mesh.VAO;
+        p.texture = 0;
+        p.textureTarget = GL_TEXTURE_2D;
+        p.primitive = GL_TRIANGLES;
+        p.first = 0;
+        p.count = (GLsizei)mesh.indexCount;
+        p.flags = PACKET_INDEXED;
+        p.lineWidth = 1.0f;
+        p.uniforms = uniformIndex;
+        p.mesh = &mesh;
+        push(key, p);
+    }
+
+    // merges a buffer recorded on another thread, rebasing its packet and uniform indices
+    void Append(const CommandBuffer &other)
+    {
+        uint32_t packetBase = (uint32_t)packets.size();
+        uint32_t uniformBase = (uint32_t)uniforms.size();
+        for (unsigned int i = 0; i < other.items.size(); i++)
+        {
+            SortItem item = other.items[i];
+            item.packet += packetBase;
+            items.push_back(item);
+        }
+        for (unsigned int i = 0; i < other.packets.size(); i++)
+        {
+            DrawPacket p = other.packets[i];
+            p.uniforms += uniformBase;
+            packets.push_back(p);
+        }
+        uniforms.insert(uniforms.end(), other.uniforms.begin(), other.uniforms.end());
+    }
+
+    // LSD radix sort of the keys, one byte per pass. All eight histograms are built in a single
+    // sweep, and bytes every key shares (usually the pass and program bits) are skipped.
+    // The sort is stable, so draws with equal keys replay in the order they were recorded.
+    void Sort()
+    {
+        size_t n = items.size();
+        if (n < 2)
+            return;
+        scratch.resize(n);
+
+        size_t counts[8][256];
+        std::fill(&counts[0][0], &counts[0][0] + 8 * 256, (size_t)0);
+        for (size_t i = 0; i < n; i++)
+            for (unsigned int b = 0; b < 8; b++)
+                counts[b][(items[i].key >> (b * 8)) & 0xFF]++;
+
+        SortItem* src = &items[0];
+        SortItem* dst = &scratch[0];
+        for (unsigned int b = 0; b < 8; b++)
+        {
+            unsigned int shift = b * 8;
+            if (counts[b][(src[0].key >> shift) & 0xFF] == n)
+                continue;
+
+            size_t offset = 0;
+            for (unsigned int i = 0; i < 256; i++)
+            {
+                size_t c = counts[b][i];
+                counts[b][i] = offset;
+                offset += c;
+            }
+            for (size_t i = 0; i < n; i++)
+                dst[counts[b][(src[i].key >> shift) & 0xFF]++] = src[i];
+            std::swap(src, dst);
+        }
+        if (src != &items[0])
+            items.swap(scratch);
+    }
+
+private:
+    vector<SortItem> scratch;
+
+    void push(uint64_t key, const DrawPacket &p)
+    {
+        SortItem item;
+        item.key = key;
+        item.packet = (uint32_t)packets.size();
+        items.push_back(item);
+        packets.push_back(p);
+    }
+};
+
+// Replays sorted command buffers on the GL thread, only touching state that actually changes
+// between consecutive packets.
+class RenderQueue {
+public:
+    // looks up the per-draw uniform locations of a program once; call after the shader is linked
+    void RegisterProgram(GLuint program, const char* modelName, const char* colorName)
+    {
+        ProgramSlots slots;
+        slots.program = program;
+        slots.model = glGetUniformLocation(program, modelName);
+        slots.color = glGetUniformLocation(program, colorName);
+        programs.push_back(slots);
+    }
+
+    // executes the buffer in key order; expects Sort() to have been called.
+    // instances > 1 repeats every draw, e.g. once per eye for the stereo programs (stereo.h)
+    void Submit(const CommandBuffer &commands, GLsizei instances = 1)
+    {
+        GLuint boundProgram = 0;
+        GLuint boundVAO = 0;
+        GLuint boundTexture = 0;
+        const Mesh* boundMaterial = NULL;
+        float boundLineWidth = -1.0f;
+        const ProgramSlots* slots = NULL;
+        int pass = -1;
+
+        for (unsigned int i = 0; i < commands.items.size(); i++)
+        {
+            const CommandBuffer::SortItem &item = commands.items[i];
+            const DrawPacket &p = commands.packets[item.packet];
+
+            int packetPass = (int)(item.key >> 62);
+            if (packetPass != pass)
+            {
+                // skybox depth is forced to 1.0, so it needs to pass when equal to the cleared depth
+                glDepthFunc(packetPass == PASS_SKYBOX ? GL_LEQUAL : GL_LESS);
+                pass = packetPass;
+            }
+            if (p.program != boundProgram)
+            {
+                glUseProgram(p.program);
+                boundProgram = p.program;
+                boundMaterial = NULL;
+                slots = findProgram(p.program);
+            }
+            if (p.vao != boundVAO)
+            {
+                glBindVertexArray(p.vao);
+                boundVAO = p.vao;
+            }
+            if (p.texture != 0 && p.texture != boundTexture)
+            {
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(p.textureTarget, p.texture);
+                boundTexture = p.texture;
+            }
+            if (p.mesh != NULL && p.mesh != boundMaterial)
+            {
+                p.mesh->BindTextures(p.program);
+                boundMaterial = p.mesh;
+                boundTexture = 0; // unit 0 may have been rebound
+            }
+            if ((p.primitive == GL_LINES || p.primitive == GL_LINE_STRIP || p.primitive == GL_LINE_LOOP) && p.lineWidth != boundLineWidth)
+            {
+                glLineWidth(p.lineWidth);
+                boundLineWidth = p.lineWidth;
+            }
+            if (slots != NULL)
+            {
+                const DrawUniforms &u = commands.uniforms[p.uniforms];
+                if (slots->model != -1)
+                    glUniformMatrix4fv(slots->model, 1, GL_FALSE, &u.model[0][0]);
+                if (slots->color != -1)
+                    glUniform3fv(slots->color, 1, &u.color[0]);
+            }
+
+            if (p.flags & PACKET_INDEXED)
+                glDrawElementsInstanced(p.primitive, p.count, GL_UNSIGNED_INT, (void*)(p.first * sizeof(unsigned int)), instances);
+            else
+                glDrawArraysInstanced(p.primitive, p.first, p.count, instances);
+        }
+
+        // always good practice to set everything back to defaults once configured.
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+        glDepthFunc(GL_LESS);
+    }
+
+private:
+    struct ProgramSlots {
+        GLuint program;
+        GLint model;
+        GLint color;
+    };
+    vector<ProgramSlots> programs;
+
+    const ProgramSlots* findProgram(GLuint program) const
+    {
+        for (unsigned int i = 0; i < programs.size(); i++)
+            if (programs[i].program == program)
+                return &programs[i];
+        return NULL;
+    }
+};
+#endif
@@ -0,0 +1,560 @@
+#ifndef SCENE_STREAM_H
+#define SCENE_STREAM_H
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+#include "cache_file.h"
+
+using namespace std;
+
+// On-disk gem field, split into cubic chunks so a viewer only ever holds the part of it nearby.
+//
+// layout (native byte order):
+//   SceneHeader
+//   SceneChunk[chunkCount]        the chunk index, sorted by coordinates
+//   per chunk: SceneInstance[instanceCount], starting on a page boundary
+//
+// SceneStream maps the file and keeps the chunks within LoadRadius of the viewer resident. A
+// background thread pages chunks in (so the render thread never takes the page faults) and
+// chunks beyond UnloadRadius are handed back to the OS, so resident memory stays bounded by
+// MaxResidentChunks however large the file is.
+const uint32_t SCENE_STREAM_VERSION = 1;
+const uint64_t SCENE_STREAM_PAGE = 4096;
+
+struct SceneHeader {
+    char     magic[8];          // "GEMSCNE"
+    uint32_t version;           // SCENE_STREAM_VERSION
+    uint32_t instanceSize;      // sizeof(SceneInstance) when written
+    float    chunkSize;         // edge length of a chunk in world units
+    uint32_t chunkCount;
+    uint64_t instanceCount;
+    uint64_t fileSize;
+};
+
+struct SceneChunk {
+    int32_t  x, y, z;           // chunk coordinates: the chunk spans [x, x + 1) * chunkSize
+    uint32_t instanceCount;
+    uint64_t offset;
+};
+
+struct SceneInstance {
+    glm::vec3 position;
+    glm::vec3 color;
+    float     phase;            // added to the spin angle, so neighbours don't turn in step
+    float     scale;
+};
+
+// lookup key of a chunk; exact for coordinates within +-2^20 chunks of the origin
+inline uint64_t SceneChunkKey(int x, int y, int z)
+{
+    return ((uint64_t)(x & 0x1fffff) << 42) | ((uint64_t)(y & 0x1fffff) << 21) | (uint64_t)(z & 0x1fffff);
+}
+
+// Writes a scene whose chunks are produced one at a time, so a field far larger than memory can
+// be written. index gives every chunk's coordinates and instance count; fill(i, out) is called
+// once per chunk, in index order, and must produce exactly that many instances.
+inline bool WriteSceneChunks(const string &path, float chunkSize, vector<SceneChunk> index,
+                             const std::function<void(unsigned int, vector<SceneInstance>&)> &fill)
+{
+    SceneHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, "GEMSCNE", 8);
+    header.version = SCENE_STREAM_VERSION;
+    header.instanceSize = sizeof(SceneInstance);
+    header.chunkSize = chunkSize;
+    header.chunkCount = (uint32_t)index.size();
+
+    uint64_t offset = sizeof(SceneHeader) + index.size() * sizeof(SceneChunk);
+    for (unsigned int i = 0; i < index.size(); i++)
+    {
+        offset = (offset + SCENE_STREAM_PAGE - 1) & ~(SCENE_STREAM_PAGE - 1);
+        index[i].offset = offset;
+        offset += (uint64_t)index[i].instanceCount * sizeof(SceneInstance);
+        header.instanceCount += index[i].instanceCount;
+    }
+    header.fileSize = offset;
+
+    return WriteFileSafely(path, [&](std::ofstream &out) {
+        out.write((const char*)&header, sizeof(header));
+        if (!index.empty())
+            out.write((const char*)&index[0], index.size() * sizeof(SceneChunk));
+        static const char zeros[SCENE_STREAM_PAGE] = { 0 };
+        vector<SceneInstance> instances;
+        for (unsigned int i = 0; i < index.size() && out; i++)
+        {
+            uint64_t at = (uint64_t)out.tellp();
+            if (index[i].offset > at)
+                out.write(zeros, (std::streamsize)(index[i].offset - at));
+            instances.clear();
+            fill(i, instances);
+            if (instances.size() != index[i].instanceCount)
+                return false;
+            if (!instances.empty())
+                out.write((const char*)&instances[0], instances.size() * sizeof(SceneInstance));
+        }
+        return true;
+    });
+}
+
+// buckets instances into chunks and writes them
+inline bool WriteScene(const string &path, float chunkSize, const vector<SceneInstance> &instances)
+{
+    unordered_map<uint64_t, unsigned int> lookup;
+    vector<SceneChunk> index;
+    vector<vector<unsigned int> > members;
+    for (unsigned int i = 0; i < instances.size(); i++)
+    {
+        SceneChunk chunk;
+        memset(&chunk, 0, sizeof(chunk));
+        chunk.x = (int32_t)floor(instances[i].position.x / chunkSize);
+        chunk.y = (int32_t)floor(instances[i].position.y / chunkSize);
+        chunk.z = (int32_t)floor(instances[i].position.z / chunkSize);
+        uint64_t key = SceneChunkKey(chunk.x, chunk.y, chunk.z);
+        unordered_map<uint64_t, unsigned int>::iterator it = lookup.find(key);
+        unsigned int slot;
+        if (it == lookup.end())
+        {
+            slot = (unsigned int)index.size();
+            lookup[key] = slot;
+            index.push_back(chunk);
+            members.push_back(vector<unsigned int>());
+        }
+        else
+            slot = it->second;
+        index[slot].instanceCount++;
+        members[slot].push_back(i);
+    }
+
+    // sort the index by coordinates, carrying the members along
+    vector<unsigned int> order(index.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+        if (index[a].x != index[b].x) return index[a].x < index[b].x;
+        if (index[a].y != index[b].y) return index[a].y < index[b].y;
+        return index[a].z < index[b].z;
+    });
+    vector<SceneChunk> sorted(index.size());
+    for (unsigned int i = 0; i < order.size(); i++)
+        sorted[i] = index[order[i]];
+
+    return WriteSceneChunks(path, chunkSize, sorted, [&](unsigned int chunk, vector<SceneInstance> &out) {
+        const vector<unsigned int> &m = members[order[chunk]];
+        for (unsigned int i = 0; i < m.size(); i++)
+            out.push_back(instances[m[i]]);
+    });
+}
+
+// a flat square field of gemsPerSide^2 gems, spacing apart and centred on the origin, in the
+// seven gem colours; generated chunk by chunk, so any size can be written
+inline bool WriteGemField(const string &path, unsigned int gemsPerSide, float spacing, float chunkSize, const glm::vec3 colors[7])
+{
+    if (gemsPerSide == 0)
+        return false;
+    float half = 0.5f * spacing * (float)(gemsPerSide - 1);
+    // grid column of the first gem at or after a world coordinate
+    auto firstAt = [&](float world) {
+        return std::max(0LL, std::min((long long)gemsPerSide, (long long)ceil((world + half) / spacing)));
+    };
+
+    int lo = (int)floor(-half / chunkSize);
+    int hi = (int)floor(half / chunkSize);
+    vector<SceneChunk> index;
+    for (int x = lo; x <= hi; x++)
+        for (int z = lo; z <= hi; z++)
+        {
+            long long columns = firstAt((x + 1) * chunkSize) - firstAt(x * chunkSize);
+            long long rows = firstAt((z + 1) * chunkSize) - firstAt(z * chunkSize);
+            if (columns <= 0 || rows <= 0)
+                continue;
+            SceneChunk chunk;
+            memset(&chunk, 0, sizeof(chunk));
+            chunk.x = x;
+            chunk.y = 0;
+            chunk.z = z;
+            chunk.instanceCount = (uint32_t)(columns * rows);
+            index.push_back(chunk);
+        }
+
+    return WriteSceneChunks(path, chunkSize, index, [&](unsigned int i, vector<SceneInstance> &out) {
+        const SceneChunk &chunk = index[i];
+        for (long long column = firstAt(chunk.x * chunkSize); column < firstAt((chunk.x + 1) * chunkSize); column++)
+            for (long long row = firstAt(chunk.z * chunkSize); row < firstAt((chunk.z + 1) * chunkSize); row++)
+            {
+                // cheap integer hash for a stable colour and phase per gem
+                uint32_t h = (uint32_t)(column * 73856093LL) ^ (uint32_t)(row * 19349663LL);
+                h ^= h >> 13;
+                h *= 0x5bd1e995u;
+                h ^= h >> 15;
+                SceneInstance instance;
+                instance.position = glm::vec3(column * spacing - half, 0.0f, row * spacing - half);
+                instance.color = colors[h % 7];
+                instance.phase = (float)(h >> 8 & 0xffff) / 65536.0f * 6.2831853f;
+                instance.scale = 1.0f;
+                out.push_back(instance);
+            }
+    });
+}
+
+class SceneStream {
+public:
+    float LoadRadius;                   // chunks closer than this to the viewer are paged in
+    float UnloadRadius;                 // and released once further than this
+    unsigned int MaxResidentChunks;
+
+    SceneStream(float loadRadius = 40.0f, float unloadRadius = 50.0f, unsigned int maxResidentChunks = 256)
+        : LoadRadius(loadRadius), UnloadRadius(unloadRadius), MaxResidentChunks(maxResidentChunks),
+          data(NULL), size(0), inFlight(0), stopping(false)
+    {
+    }
+
+    ~SceneStream() { Close(); }
+
+    // maps a scene and validates its header and index; false if it is missing, from another
+    // version or truncated. Nothing is resident until Update().
+    bool Open(const string &path)
+    {
+        Close();
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(SceneHeader))
+        {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t)info.st_size;
+        void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED)
+        {
+            size = 0;
+            return false;
+        }
+        data = (const unsigned char*)mapped;
+        // access follows the viewer, not the file order
+        madvise(mapped, size, MADV_RANDOM);
+#else
+        // no mmap; keep the header and index in memory and read chunks from the file on demand
+        file.open(path.c_str(), std::ios::binary | std::ios::ate);
+        if (!file)
+            return false;
+        size = (size_t)file.tellg();
+        SceneHeader h;
+        file.seekg(0);
+        if (size < sizeof(SceneHeader) || !file.read((char*)&h, sizeof(h)))
+            return false;
+        uint64_t tables = sizeof(SceneHeader) + (uint64_t)h.chunkCount * sizeof(SceneChunk);
+        if (tables > size)
+            return false;
+        fallback.resize((size_t)tables);
+        file.seekg(0);
+        if (!file.read((char*)&fallback[0], fallback.size()))
+            return false;
+        data = &fallback[0];
+#endif
+        if (!validate())
+        {
+            Close();
+            return false;
+        }
+
+        const SceneHeader* h = header();
+        chunkState.assign(h->chunkCount, CHUNK_UNLOADED);
+#ifdef _WIN32
+        loaded.assign(h->chunkCount, vector<SceneInstance>());
+#endif
+        for (unsigned int i = 0; i < h->chunkCount; i++)
+            lookup[SceneChunkKey(chunks()[i].x, chunks()[i].y, chunks()[i].z)] = i;
+        stopping = false;
+        worker = std::thread(&SceneStream::work, this);
+        return true;
+    }
+
+    void Close()
+    {
+        if (worker.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            wake.notify_all();
+            worker.join();
+        }
+        jobs.clear();
+        ready.clear();
+        resident.clear();
+        added.clear();
+        removed.clear();
+        lookup.clear();
+        chunkState.clear();
+#ifndef _WIN32
+        if (data)
+            munmap((void*)data, size);
+#else
+        file.close();
+        fallback.clear();
+        loaded.clear();
+#endif
+        data = NULL;
+        size = 0;
+    }
+
+    bool IsOpen() const { return data != NULL; }
+
+    // call once per frame on the render thread: takes in the chunks the worker has paged in,
+    // releases distant ones and queues the nearest missing ones
+    void Update(const glm::vec3 &viewer)
+    {
+        if (!data)
+            return;
+        float chunkSize = header()->chunkSize;
+        added.clear();
+        removed.clear();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (unsigned int i = 0; i < ready.size(); i++)
+                if (chunkState[ready[i]] == CHUNK_QUEUED)
+                {
+                    chunkState[ready[i]] = CHUNK_RESIDENT;
+                    resident.push_back(ready[i]);
+                    added.push_back(ready[i]);
+                }
+            ready.clear();
+        }
+
+        // release what the viewer has left behind
+        for (unsigned int i = 0; i < resident.size();)
+        {
+            if (distanceTo(resident[i], viewer) > UnloadRadius)
+            {
+                release(resident[i]);
+                vector<unsigned int>::iterator it = std::find(added.begin(), added.end(), resident[i]);
+                if (it != added.end())
+                    added.erase(it); // arrived and left in the same update
+                else
+                    removed.push_back(resident[i]);
+                resident[i] = resident.back();
+                resident.pop_back();
+            }
+            else
+                i++;
+        }
+
+        // queue the chunks in range that aren't resident or on their way, nearest first
+        vector<std::pair<float, unsigned int> > wanted;
+        int reach = (int)ceil(LoadRadius / chunkSize);
+        int cx = (int)floor(viewer.x / chunkSize), cy = (int)floor(viewer.y / chunkSize), cz = (int)floor(viewer.z / chunkSize);
+        for (int x = cx - reach; x <= cx + reach; x++)
+            for (int y = cy - reach; y <= cy + reach; y++)
+                for (int z = cz - reach; z <= cz + reach; z++)
+                {
+                    unordered_map<uint64_t, unsigned int>::iterator it = lookup.find(SceneChunkKey(x, y, z));
+                    if (it == lookup.end())
+                        continue;
+                    float distance = distanceTo(it->second, viewer);
+                    if (distance <= LoadRadius)
+                        wanted.push_back(std::make_pair(distance, it->second));
+                }
+        std::sort(wanted.begin(), wanted.end());
+
+        std::lock_guard<std::mutex> lock(mutex);
+        // a queued chunk that went out of range is dropped once it arrives
+        for (unsigned int i = 0; i < jobs.size();)
+        {
+            if (distanceTo(jobs[i], viewer) > UnloadRadius)
+            {
+                chunkState[jobs[i]] = CHUNK_UNLOADED;
+                jobs.erase(jobs.begin() + i);
+            }
+            else
+                i++;
+        }
+        unsigned int committed = (unsigned int)(resident.size() + jobs.size() + inFlight);
+        for (unsigned int i = 0; i < wanted.size() && committed < MaxResidentChunks; i++)
+        {
+            unsigned int chunk = wanted[i].second;
+            if (chunkState[chunk] != CHUNK_UNLOADED)
+                continue;
+            chunkState[chunk] = CHUNK_QUEUED;
+            jobs.push_back(chunk);
+            committed++;
+        }
+        if (!jobs.empty())
+            wake.notify_one();
+    }
+
+    // chunks that may be drawn this frame
+    const vector<unsigned int> &ResidentChunks() const { return resident; }
+    // the chunks the last Update() made resident and released, so a caller can follow the
+    // resident set without rescanning it. A released chunk's instances can't be read any more.
+    const vector<unsigned int> &Added() const { return added; }
+    const vector<unsigned int> &Removed() const { return removed; }
+    // chunks queued or being paged in
+    unsigned int Pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return (unsigned int)(jobs.size() + ready.size()) + inFlight;
+    }
+    unsigned int InstanceCount(unsigned int chunk) const { return chunks()[chunk].instanceCount; }
+    const SceneInstance* Instances(unsigned int chunk) const
+    {
+#ifndef _WIN32
+        return (const SceneInstance*)(data + chunks()[chunk].offset);
+#else
+        return loaded[chunk].empty() ? NULL : &loaded[chunk][0];
+#endif
+    }
+
+    uint64_t TotalInstances() const { return data ? header()->instanceCount : 0; }
+    unsigned int ResidentInstances() const
+    {
+        unsigned int count = 0;
+        for (unsigned int i = 0; i < resident.size(); i++)
+            count += InstanceCount(resident[i]);
+        return count;
+    }
+
+private:
+    enum Chunk_State { CHUNK_UNLOADED, CHUNK_QUEUED, CHUNK_RESIDENT };
+
+    const unsigned char* data;
+    size_t size;
+#ifdef _WIN32
+    std::ifstream file;
+    vector<unsigned char> fallback;
+    vector<vector<SceneInstance> > loaded;
+#endif
+    unordered_map<uint64_t, unsigned int> lookup;
+    vector<unsigned char> chunkState;   // Chunk_State; written on the render thread under the mutex
+    vector<unsigned int> resident;      // render thread only
+    vector<unsigned int> added;         // by the last Update()
+    vector<unsigned int> removed;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    deque<unsigned int> jobs;
+    vector<unsigned int> ready;
+    unsigned int inFlight;              // jobs the worker has taken but not finished
+    bool stopping;
+
+    const SceneHeader* header() const { return (const SceneHeader*)data; }
+    const SceneChunk* chunks() const { return (const SceneChunk*)(data + sizeof(SceneHeader)); }
+
+    // distance from the viewer to the nearest point of a chunk
+    float distanceTo(unsigned int chunk, const glm::vec3 &viewer) const
+    {
+        const SceneChunk &c = chunks()[chunk];
+        float s = header()->chunkSize;
+        glm::vec3 lo((float)c.x * s, (float)c.y * s, (float)c.z * s);
+        glm::vec3 nearest = glm::max(lo, glm::min(viewer, lo + glm::vec3(s)));
+        return glm::length(viewer - nearest);
+    }
+
+    void release(unsigned int chunk)
+    {
+        chunkState[chunk] = CHUNK_UNLOADED;
+#ifndef _WIN32
+        // clean private pages: dropping them costs nothing and they fault back in from the file
+        const SceneChunk &c = chunks()[chunk];
+        size_t length = (size_t)c.instanceCount * sizeof(SceneInstance);
+        if (length > 0)
+            madvise((void*)(data + c.offset), length, MADV_DONTNEED);
+#else
+        vector<SceneInstance>().swap(loaded[chunk]);
+#endif
+    }
+
+    // pages chunks in off the render thread
+    void work()
+    {
+        for (;;)
+        {
+            unsigned int chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (!stopping && jobs.empty())
+                    wake.wait(lock);
+                if (stopping)
+                    return;
+                chunk = jobs.front();
+                jobs.pop_front();
+                inFlight++;
+            }
+
+            const SceneChunk &c = chunks()[chunk];
+            size_t length = (size_t)c.instanceCount * sizeof(SceneInstance);
+#ifndef _WIN32
+            if (length > 0)
+            {
+                const unsigned char* begin = data + c.offset;
+                madvise((void*)begin, length, MADV_WILLNEED);
+                // touch every page so the faults happen here and not while drawing
+                volatile unsigned char sink = 0;
+                for (size_t offset = 0; offset < length; offset += SCENE_STREAM_PAGE)
+                    sink ^= begin[offset];
+                (void)sink;
+            }
+#else
+            vector<SceneInstance> instances(c.instanceCount);
+            if (length > 0)
+            {
+                file.seekg((std::streamoff)c.offset);
+                file.read((char*)&instances[0], length);
+            }
+#endif
+
+            std::lock_guard<std::mutex> lock(mutex);
+            inFlight--;
+#ifdef _WIN32
+            // the render thread only reads a chunk's vector once it is resident
+            if (chunkState[chunk] == CHUNK_QUEUED)
+                loaded[chunk].swap(instances);
+#endif
+            ready.push_back(chunk);
+        }
+    }
+
+    bool validate() const
+    {
+        const SceneHeader* h = header();
+        if (memcmp(h->magic, "GEMSCNE", 8) != 0 || h->version != SCENE_STREAM_VERSION ||
+            h->instanceSize != sizeof(SceneInstance) || h->fileSize != size || !(h->chunkSize > 0.0f))
+            return false;
+        uint64_t tables = sizeof(SceneHeader) + (uint64_t)h->chunkCount * sizeof(SceneChunk);
+        if (tables > size)
+            return false;
+        for (unsigned int i = 0; i < h->chunkCount; i++)
+        {
+            const SceneChunk &c = chunks()[i];
+            if (c.offset < tables || c.offset + (uint64_t)c.instanceCount * sizeof(SceneInstance) > size)
+                return false;
+        }
+        return true;
+    }
+};
+#endif
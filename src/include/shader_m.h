@@ -14,8 +14,10 @@ class Shader
 public:
     unsigned int ID;
     // constructor generates the shader on the fly
+    // defines (e.g. "#define SHADE_FACE\n") is inserted after the #version line of both stages,
+    // so one source file can be compiled into variants
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* defines = NULL)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -38,8 +40,8 @@ public:
             vShaderFile.close();
             fShaderFile.close();
             // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
+            vertexCode = withDefines(vShaderStream.str(), defines);
+            fragmentCode = withDefines(fShaderStream.str(), defines);
         }
         catch (std::ifstream::failure& e)
         {
@@ -69,6 +71,11 @@ public:
         glDeleteShader(vertex);
         glDeleteShader(fragment);
 
+    }
+    // wraps a program that is already linked, such as one shared through the AssetRegistry
+    // ------------------------------------------------------------------------
+    explicit Shader(unsigned int program) : ID(program)
+    {
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -136,6 +143,18 @@ public:
     }
 
 private:
+    // inserts defines after the #version line, which has to stay first
+    // ------------------------------------------------------------------------
+    static std::string withDefines(const std::string &code, const char* defines)
+    {
+        if (defines == NULL || defines[0] == '\0')
+            return code;
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return std::string(defines) + code;
+        return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
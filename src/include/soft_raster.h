@@ -0,0 +1,533 @@
+#ifndef SOFT_RASTER_H
+#define SOFT_RASTER_H
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SOFT_RASTER_SSE2 1
+#endif
+
+#include "gem_scene.h"
+
+using namespace std;
+
+// A cubemap held in memory for CPU sampling. Faces are in GL order (+X, -X, +Y, -Y, +Z, -Z)
+// with row 0 at t = 0, exactly as loadCubemap uploads them.
+class SoftCubemap {
+public:
+    int width[6];
+    int height[6];
+    vector<unsigned char> faces[6];
+
+    SoftCubemap()
+    {
+        for (int i = 0; i < 6; i++)
+            width[i] = height[i] = 0;
+    }
+
+    bool Load(const vector<std::string> &paths)
+    {
+        bool ok = true;
+        for (unsigned int i = 0; i < paths.size() && i < 6; i++)
+        {
+            int nrComponents;
+            unsigned char* data = stbi_load(paths[i].c_str(), &width[i], &height[i], &nrComponents, 3);
+            if (data)
+            {
+                faces[i].assign(data, data + width[i] * height[i] * 3);
+                stbi_image_free(data);
+            }
+            else
+            {
+                std::cout << "Cubemap texture failed to load at path: " << paths[i] << std::endl;
+                width[i] = height[i] = 0;
+                ok = false;
+            }
+        }
+        return ok;
+    }
+
+    // bilinear, clamp-to-edge lookup following the GL cube face selection rules
+    glm::vec3 Sample(const glm::vec3 &dir) const
+    {
+        float ax = fabsf(dir.x), ay = fabsf(dir.y), az = fabsf(dir.z);
+        int face;
+        float sc, tc, ma;
+        if (ax >= ay && ax >= az)
+        {
+            face = dir.x >= 0.0f ? 0 : 1;
+            sc = dir.x >= 0.0f ? -dir.z : dir.z;
+            tc = -dir.y;
+            ma = ax;
+        }
+        else if (ay >= az)
+        {
+            face = dir.y >= 0.0f ? 2 : 3;
+            sc = dir.x;
+            tc = dir.y >= 0.0f ? dir.z : -dir.z;
+            ma = ay;
+        }
+        else
+        {
+            face = dir.z >= 0.0f ? 4 : 5;
+            sc = dir.z >= 0.0f ? dir.x : -dir.x;
+            tc = -dir.y;
+            ma = az;
+        }
+        int w = width[face], h = height[face];
+        if (w == 0 || ma == 0.0f)
+            return glm::vec3(0.0f);
+
+        float s = (sc / ma + 1.0f) * 0.5f;
+        float t = (tc / ma + 1.0f) * 0.5f;
+        float u = s * w - 0.5f;
+        float v = t * h - 0.5f;
+        int x0 = (int)floorf(u), y0 = (int)floorf(v);
+        float fx = u - x0, fy = v - y0;
+        int x1 = std::min(std::max(x0 + 1, 0), w - 1), y1 = std::min(std::max(y0 + 1, 0), h - 1);
+        x0 = std::min(std::max(x0, 0), w - 1);
+        y0 = std::min(std::max(y0, 0), h - 1);
+
+        const unsigned char* data = &faces[face][0];
+        const unsigned char* p00 = data + (y0 * w + x0) * 3;
+        const unsigned char* p10 = data + (y0 * w + x1) * 3;
+        const unsigned char* p01 = data + (y1 * w + x0) * 3;
+        const unsigned char* p11 = data + (y1 * w + x1) * 3;
+        glm::vec3 c;
+        for (int i = 0; i < 3; i++)
+        {
+            float top = p00[i] + (p10[i] - p00[i]) * fx;
+            float bottom = p01[i] + (p11[i] - p01[i]) * fx;
+            c[i] = (top + (bottom - top) * fy) * (1.0f / 255.0f);
+        }
+        return c;
+    }
+};
+
+// One gem instance: its model matrix, final color (already multiplied by colorMult) and camera
+// distance, which orders the blended draws exactly like the OpenGL path.
+struct SoftGem {
+    glm::mat4 model;
+    glm::vec3 color;
+    float distance;
+};
+
+// gem.frag evaluated on the CPU: Phong lighting mixed with a refraction and a reflection lookup
+inline glm::vec4 ShadeGem(const glm::vec3 &position, const glm::vec3 &normal, const glm::vec3 &objectColor,
+                          const glm::vec3 &cameraPos, const SoftCubemap &skybox)
+{
+    //ambient
+    glm::vec3 ambient = lightAmbient * materialAmbient;
+
+    //diffuse
+    glm::vec3 norm = glm::normalize(normal);
+    glm::vec3 lightDir = glm::normalize(lightPos - position);
+    float diff = std::max(glm::dot(norm, lightDir), 0.0f);
+    glm::vec3 diffuse = lightDiffuse * (diff * materialDiffuse);
+
+    //specular
+    glm::vec3 viewDir = glm::normalize(cameraPos - position);
+    glm::vec3 reflectDir = glm::reflect(-lightDir, norm);
+    float spec = powf(std::max(glm::dot(viewDir, reflectDir), 0.0f), materialShininess);
+    glm::vec3 specular = lightSpecular * (spec * materialSpecular);
+
+    glm::vec3 result = ambient + diffuse + specular;
+
+    glm::vec3 I = -viewDir;
+    glm::vec3 Rr = glm::refract(I, norm, refractionRatio);
+    glm::vec3 Rl = glm::reflect(I, norm);
+
+    // mix refraction and reflection, apply color, then lighting
+    glm::vec3 processResult = glm::mix(skybox.Sample(Rr), skybox.Sample(Rl), reflectRefractRatio);
+    processResult = objectColor * processResult;
+    processResult = glm::mix(result, processResult, lightingResistance);
+    return glm::vec4(processResult, opacity);
+}
+
+// Tile-binned CPU rasterizer for the gem scene. Triangles are set up per gem, binned into
+// screen tiles in submission order, and tiles are rasterized in parallel (OpenMP), each one
+// running depth test and blending in the same order the GL path would. Coverage is tested
+// four pixels at a time with integer edge functions on 1/16 pixel snapped vertices and a
+// top-left fill rule, so shared edges are never blended twice.
+class SoftRasterizer {
+public:
+    static const int TILE_SIZE = 64;
+
+    SoftRasterizer(int width, int height) : width(width), height(height)
+    {
+        tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+        tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+        color.resize(width * height);
+        depth.resize(width * height);
+        pixels.resize(width * height * 3);
+        bins.resize(tilesX * tilesY);
+    }
+
+    int Width() const { return width; }
+    int Height() const { return height; }
+
+    // RGB8, top row first
+    const vector<unsigned char> &Pixels() const { return pixels; }
+
+    // renders the gems back to front over the clear color, then fills the rest with the skybox
+    void Render(vector<SoftGem> gems, const glm::mat4 &view, const glm::mat4 &projection,
+                const glm::vec3 &cameraPos, const SoftCubemap &skybox)
+    {
+        std::stable_sort(gems.begin(), gems.end(), fartherFirst);
+        glm::mat4 viewProjection = projection * view;
+
+        // vertex stage and triangle setup, one gem per iteration
+        vector<vector<Triangle> > perGem(gems.size());
+        #pragma omp parallel for schedule(dynamic)
+        for (int g = 0; g < (int)gems.size(); g++)
+            setupGem(gems[g], g, viewProjection, perGem[g]);
+
+        // bin in submission order so every tile sees its triangles in draw order
+        triangles.clear();
+        for (unsigned int t = 0; t < bins.size(); t++)
+            bins[t].clear();
+        for (unsigned int g = 0; g < perGem.size(); g++)
+        {
+            for (unsigned int i = 0; i < perGem[g].size(); i++)
+            {
+                const Triangle &tri = perGem[g][i];
+                uint32_t index = (uint32_t)triangles.size();
+                triangles.push_back(tri);
+                for (int ty = tri.minY / TILE_SIZE; ty <= tri.maxY / TILE_SIZE; ty++)
+                    for (int tx = tri.minX / TILE_SIZE; tx <= tri.maxX / TILE_SIZE; tx++)
+                        bins[ty * tilesX + tx].push_back(index);
+            }
+        }
+
+        // skybox rays: direction = inverse(projection * rotation-only view) applied to the far plane
+        glm::mat4 skyInverse = glm::inverse(projection * glm::mat4(glm::mat3(view)));
+
+        int tileCount = tilesX * tilesY;
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int t = 0; t < tileCount; t++)
+            renderTile(t, gems, cameraPos, skybox, skyInverse);
+    }
+
+    bool WritePPM(const std::string &path) const
+    {
+        FILE* fp = fopen(path.c_str(), "wb");
+        if (fp == NULL)
+        {
+            std::cout << "Failed to write image: " << path << std::endl;
+            return false;
+        }
+        fprintf(fp, "P6\n%d %d\n255\n", width, height);
+        fwrite(&pixels[0], 1, pixels.size(), fp);
+        fclose(fp);
+        return true;
+    }
+
+private:
+    // clip-space vertex with the varyings gem.vert passes on
+    struct ClipVertex {
+        glm::vec4 clip;
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+
+    struct Triangle {
+        // edge i is opposite vertex i; E(x, y) = A * x + B * y + C in 1/16 pixel units
+        int32_t A[3], B[3];
+        int64_t C[3];
+        int32_t bias[3];            // -1 for edges that don't own their pixels (top-left rule)
+        int minX, minY, maxX, maxY; // pixel bounds, clamped to the screen
+        // barycentric planes for l1 and l2 in pixel coordinates
+        float l1[3], l2[3];
+        float z[3], invW[3];
+        glm::vec3 positionW[3];     // varyings divided by w for perspective correction
+        glm::vec3 normalW[3];
+        int gem;
+    };
+
+    int width, height;
+    int tilesX, tilesY;
+    vector<glm::vec3> color;
+    vector<float> depth;
+    vector<unsigned char> pixels;
+    vector<Triangle> triangles;
+    vector<vector<uint32_t> > bins;
+
+    static bool fartherFirst(const SoftGem &a, const SoftGem &b)
+    {
+        return a.distance > b.distance;
+    }
+
+    static ClipVertex lerpVertex(const ClipVertex &a, const ClipVertex &b, float t)
+    {
+        ClipVertex v;
+        v.clip = glm::mix(a.clip, b.clip, t);
+        v.position = glm::mix(a.position, b.position, t);
+        v.normal = glm::mix(a.normal, b.normal, t);
+        return v;
+    }
+
+    // Sutherland-Hodgman against the near plane and a guard band 4x the viewport, which keeps
+    // snapped coordinates small enough for the integer edge functions.
+    static int clipPolygon(ClipVertex* poly, int count, ClipVertex* scratch)
+    {
+        const float guard = 4.0f;
+        for (int plane = 0; plane < 5 && count > 0; plane++)
+        {
+            int outCount = 0;
+            for (int i = 0; i < count; i++)
+            {
+                const ClipVertex &a = poly[i];
+                const ClipVertex &b = poly[(i + 1) % count];
+                float da = planeDistance(a.clip, plane, guard);
+                float db = planeDistance(b.clip, plane, guard);
+                if (da >= 0.0f)
+                    scratch[outCount++] = a;
+                if ((da >= 0.0f) != (db >= 0.0f))
+                    scratch[outCount++] = lerpVertex(a, b, da / (da - db));
+            }
+            for (int i = 0; i < outCount; i++)
+                poly[i] = scratch[i];
+            count = outCount;
+        }
+        return count;
+    }
+
+    static float planeDistance(const glm::vec4 &c, int plane, float guard)
+    {
+        switch (plane)
+        {
+        case 0: return c.z + c.w;           // near
+        case 1: return guard * c.w - c.x;
+        case 2: return guard * c.w + c.x;
+        case 3: return guard * c.w - c.y;
+        default: return guard * c.w + c.y;
+        }
+    }
+
+    void setupGem(const SoftGem &gem, int gemIndex, const glm::mat4 &viewProjection, vector<Triangle> &out) const
+    {
+        glm::mat3 normalMatrix = glm::mat3(glm::transpose(glm::inverse(gem.model)));
+        out.reserve(gemVertexCount / 3);
+        for (int v = 0; v < gemVertexCount; v += 3)
+        {
+            ClipVertex poly[9], scratch[9];
+            for (int k = 0; k < 3; k++)
+            {
+                const float* src = &gemVertices[(v + k) * 6];
+                glm::vec4 world = gem.model * glm::vec4(src[0], src[1], src[2], 1.0f);
+                poly[k].position = glm::vec3(world);
+                poly[k].normal = normalMatrix * glm::vec3(src[3], src[4], src[5]);
+                poly[k].clip = viewProjection * world;
+            }
+            int count = clipPolygon(poly, 3, scratch);
+            for (int k = 1; k + 1 < count; k++)
+            {
+                Triangle tri;
+                if (setupTriangle(poly[0], poly[k], poly[k + 1], gemIndex, tri))
+                    out.push_back(tri);
+            }
+        }
+    }
+
+    bool setupTriangle(const ClipVertex &c0, const ClipVertex &c1, const ClipVertex &c2, int gemIndex, Triangle &tri) const
+    {
+        const ClipVertex* v[3] = { &c0, &c1, &c2 };
+        int32_t X[3], Y[3];
+        float sx[3], sy[3];
+        for (int i = 0; i < 3; i++)
+        {
+            float invW = 1.0f / v[i]->clip.w;
+            sx[i] = (v[i]->clip.x * invW * 0.5f + 0.5f) * width;
+            sy[i] = (v[i]->clip.y * invW * 0.5f + 0.5f) * height;
+            X[i] = (int32_t)floorf(sx[i] * 16.0f + 0.5f);
+            Y[i] = (int32_t)floorf(sy[i] * 16.0f + 0.5f);
+        }
+
+        int64_t area = (int64_t)(X[1] - X[0]) * (Y[2] - Y[0]) - (int64_t)(Y[1] - Y[0]) * (X[2] - X[0]);
+        if (area == 0)
+            return false;
+        // no face culling in the GL path, so wind everything counter-clockwise
+        if (area < 0)
+        {
+            std::swap(v[1], v[2]);
+            std::swap(X[1], X[2]);
+            std::swap(Y[1], Y[2]);
+            std::swap(sx[1], sx[2]);
+            std::swap(sy[1], sy[2]);
+            area = -area;
+        }
+
+        tri.minX = std::max(0, (int)((std::min(std::min(X[0], X[1]), X[2]) - 8) >> 4));
+        tri.minY = std::max(0, (int)((std::min(std::min(Y[0], Y[1]), Y[2]) - 8) >> 4));
+        tri.maxX = std::min(width - 1, (int)((std::max(std::max(X[0], X[1]), X[2]) + 8) >> 4));
+        tri.maxY = std::min(height - 1, (int)((std::max(std::max(Y[0], Y[1]), Y[2]) + 8) >> 4));
+        if (tri.minX > tri.maxX || tri.minY > tri.maxY)
+            return false;
+
+        for (int i = 0; i < 3; i++)
+        {
+            int a = (i + 1) % 3, b = (i + 2) % 3;
+            tri.A[i] = Y[a] - Y[b];
+            tri.B[i] = X[b] - X[a];
+            tri.C[i] = (int64_t)X[a] * Y[b] - (int64_t)Y[a] * X[b];
+            bool topLeft = tri.A[i] > 0 || (tri.A[i] == 0 && tri.B[i] < 0);
+            tri.bias[i] = topLeft ? 0 : -1;
+        }
+
+        // barycentric planes from the unsnapped float positions, for interpolation only
+        float fArea = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sy[1] - sy[0]) * (sx[2] - sx[0]);
+        float invArea = 1.0f / fArea;
+        tri.l1[0] = (sy[2] - sy[0]) * invArea;
+        tri.l1[1] = (sx[0] - sx[2]) * invArea;
+        tri.l1[2] = (sx[2] * sy[0] - sx[0] * sy[2]) * invArea;
+        tri.l2[0] = (sy[0] - sy[1]) * invArea;
+        tri.l2[1] = (sx[1] - sx[0]) * invArea;
+        tri.l2[2] = (sx[0] * sy[1] - sx[1] * sy[0]) * invArea;
+
+        for (int i = 0; i < 3; i++)
+        {
+            float invW = 1.0f / v[i]->clip.w;
+            tri.z[i] = v[i]->clip.z * invW * 0.5f + 0.5f;
+            tri.invW[i] = invW;
+            tri.positionW[i] = v[i]->position * invW;
+            tri.normalW[i] = v[i]->normal * invW;
+        }
+        tri.gem = gemIndex;
+        return true;
+    }
+
+    void renderTile(int tile, const vector<SoftGem> &gems, const glm::vec3 &cameraPos,
+                    const SoftCubemap &skybox, const glm::mat4 &skyInverse)
+    {
+        int x0 = (tile % tilesX) * TILE_SIZE, y0 = (tile / tilesX) * TILE_SIZE;
+        int x1 = std::min(x0 + TILE_SIZE, width) - 1, y1 = std::min(y0 + TILE_SIZE, height) - 1;
+
+        // glClearColor(0.1f, 0.1f, 0.1f, 1.0f)
+        for (int y = y0; y <= y1; y++)
+        {
+            for (int x = x0; x <= x1; x++)
+            {
+                color[y * width + x] = glm::vec3(0.1f);
+                depth[y * width + x] = 1.0f;
+            }
+        }
+
+        const vector<uint32_t> &bin = bins[tile];
+        for (unsigned int i = 0; i < bin.size(); i++)
+            rasterize(triangles[bin[i]], std::max(x0, triangles[bin[i]].minX), std::max(y0, triangles[bin[i]].minY),
+                      std::min(x1, triangles[bin[i]].maxX), std::min(y1, triangles[bin[i]].maxY), gems, cameraPos, skybox);
+
+        // skybox is drawn last with GL_LEQUAL at depth 1.0, so it only lands on untouched pixels
+        for (int y = y0; y <= y1; y++)
+        {
+            float ndcY = (y + 0.5f) / height * 2.0f - 1.0f;
+            for (int x = x0; x <= x1; x++)
+            {
+                int p = y * width + x;
+                if (depth[p] >= 1.0f)
+                {
+                    float ndcX = (x + 0.5f) / width * 2.0f - 1.0f;
+                    glm::vec4 dir = skyInverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+                    color[p] = skybox.Sample(glm::vec3(dir) / dir.w);
+                }
+            }
+        }
+
+        // resolve to 8-bit, flipping so the first row is the top of the image
+        for (int y = y0; y <= y1; y++)
+        {
+            unsigned char* row = &pixels[(height - 1 - y) * width * 3];
+            for (int x = x0; x <= x1; x++)
+            {
+                const glm::vec3 &c = color[y * width + x];
+                for (int i = 0; i < 3; i++)
+                    row[x * 3 + i] = (unsigned char)(glm::clamp(c[i], 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    // edge function values at the center of pixel (x, y), clamped into int32. Within a tile the
+    // function changes by far less than the clamp limit, so clamping never flips a sign.
+    static int32_t edgeAt(const Triangle &tri, int i, int x, int y)
+    {
+        int64_t e = (int64_t)tri.A[i] * (x * 16 + 8) + (int64_t)tri.B[i] * (y * 16 + 8) + tri.C[i] + tri.bias[i];
+        const int64_t limit = (int64_t)1 << 30;
+        return (int32_t)std::min(std::max(e, -limit), limit);
+    }
+
+    void rasterize(const Triangle &tri, int bx0, int by0, int bx1, int by1, const vector<SoftGem> &gems,
+                   const glm::vec3 &cameraPos, const SoftCubemap &skybox)
+    {
+        if (bx0 > bx1 || by0 > by1)
+            return;
+        for (int y = by0; y <= by1; y++)
+        {
+            int32_t e0 = edgeAt(tri, 0, bx0, y);
+            int32_t e1 = edgeAt(tri, 1, bx0, y);
+            int32_t e2 = edgeAt(tri, 2, bx0, y);
+            int32_t s0 = tri.A[0] * 16, s1 = tri.A[1] * 16, s2 = tri.A[2] * 16;
+#ifdef SOFT_RASTER_SSE2
+            __m128i E0 = _mm_setr_epi32(e0, e0 + s0, e0 + 2 * s0, e0 + 3 * s0);
+            __m128i E1 = _mm_setr_epi32(e1, e1 + s1, e1 + 2 * s1, e1 + 3 * s1);
+            __m128i E2 = _mm_setr_epi32(e2, e2 + s2, e2 + 2 * s2, e2 + 3 * s2);
+            __m128i S0 = _mm_set1_epi32(4 * s0), S1 = _mm_set1_epi32(4 * s1), S2 = _mm_set1_epi32(4 * s2);
+            __m128i minusOne = _mm_set1_epi32(-1);
+            for (int x = bx0; x <= bx1; x += 4)
+            {
+                __m128i inside = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(E0, minusOne), _mm_cmpgt_epi32(E1, minusOne)),
+                                               _mm_cmpgt_epi32(E2, minusOne));
+                int mask = _mm_movemask_ps(_mm_castsi128_ps(inside));
+                if (bx1 - x < 3)
+                    mask &= (1 << (bx1 - x + 1)) - 1;
+                for (int k = 0; mask != 0; k++, mask >>= 1)
+                    if (mask & 1)
+                        shadePixel(tri, x + k, y, gems, cameraPos, skybox);
+                E0 = _mm_add_epi32(E0, S0);
+                E1 = _mm_add_epi32(E1, S1);
+                E2 = _mm_add_epi32(E2, S2);
+            }
+#else
+            for (int x = bx0; x <= bx1; x++, e0 += s0, e1 += s1, e2 += s2)
+                if ((e0 | e1 | e2) >= 0)
+                    shadePixel(tri, x, y, gems, cameraPos, skybox);
+#endif
+        }
+    }
+
+    void shadePixel(const Triangle &tri, int x, int y, const vector<SoftGem> &gems,
+                    const glm::vec3 &cameraPos, const SoftCubemap &skybox)
+    {
+        float px = x + 0.5f, py = y + 0.5f;
+        float b1 = tri.l1[0] * px + tri.l1[1] * py + tri.l1[2];
+        float b2 = tri.l2[0] * px + tri.l2[1] * py + tri.l2[2];
+        float b0 = 1.0f - b1 - b2;
+
+        // GL_LESS depth test, depth writes on
+        int p = y * width + x;
+        float z = b0 * tri.z[0] + b1 * tri.z[1] + b2 * tri.z[2];
+        if (!(z < depth[p]))
+            return;
+        depth[p] = z;
+
+        float w = 1.0f / (b0 * tri.invW[0] + b1 * tri.invW[1] + b2 * tri.invW[2]);
+        glm::vec3 position = (tri.positionW[0] * b0 + tri.positionW[1] * b1 + tri.positionW[2] * b2) * w;
+        glm::vec3 normal = (tri.normalW[0] * b0 + tri.normalW[1] * b1 + tri.normalW[2] * b2) * w;
+
+        glm::vec4 src = ShadeGem(position, normal, gems[tri.gem].color, cameraPos, skybox);
+
+        // glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA) into a normalized framebuffer
+        glm::vec3 &dst = color[p];
+        dst = glm::clamp(glm::vec3(src) * src.w + dst * (1.0f - src.w), 0.0f, 1.0f);
+    }
+};
+#endif
@@ -0,0 +1,158 @@
+#ifndef SPATIAL_GRID_H
+#define SPATIAL_GRID_H
+
+#include <glm/glm.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#include <vector>
+#include "frustum.h"
+
+using namespace std;
+
+// Loose uniform grid over instance positions, hashed by cell so only occupied cells cost
+// anything. Per-frame queries (culling, distance sorting, LOD) visit the cells that are in view
+// instead of every instance.
+//
+// An instance belongs to one cell. The grid is loose: the instance stays in its cell until it
+// moves more than the looseness past the cell's edge, so gems orbiting or bobbing across a border
+// don't hop back and forth every frame, and Move() is only a bounds check for most of them.
+// A cell's bounds for culling are grown by the looseness plus maxRadius, the largest extent of
+// an instance around its position, so a cell that is out of view has nothing in view.
+class SpatialGrid {
+public:
+    struct VisibleCell {
+        float distance;                         // from the eye to the cell centre
+        const vector<unsigned int>* members;    // instance ids
+    };
+
+    SpatialGrid(float size = 4.0f, float loose = 1.0f, float radius = 1.0f)
+        : cellSize(size), looseness(loose), maxRadius(radius), migrations(0)
+    {
+    }
+
+    void Clear()
+    {
+        cells.clear();
+        entries.clear();
+    }
+
+    // ids are small indices (such as positions in an instance array), not handles
+    void Insert(unsigned int id, const glm::vec3 &position)
+    {
+        if (id >= entries.size())
+            entries.resize(id + 1);
+        attach(id, position);
+    }
+
+    // keeps the instance in its cell unless it has left the cell's loose bounds
+    void Move(unsigned int id, const glm::vec3 &position)
+    {
+        if (id >= entries.size() || !entries[id].used)
+        {
+            Insert(id, position);
+            return;
+        }
+        const Entry &e = entries[id];
+        glm::vec3 lo = cellOrigin(e.x, e.y, e.z) - glm::vec3(looseness);
+        glm::vec3 hi = lo + glm::vec3(cellSize + 2.0f * looseness);
+        if (position.x >= lo.x && position.y >= lo.y && position.z >= lo.z &&
+            position.x <= hi.x && position.y <= hi.y && position.z <= hi.z)
+            return;
+        detach(id);
+        attach(id, position);
+        migrations++;
+    }
+
+    void Remove(unsigned int id)
+    {
+        if (id < entries.size() && entries[id].used)
+            detach(id);
+    }
+
+    // the occupied cells whose loose bounds meet the frustum, nearest first. Cell order is a
+    // coarse depth order: instances in different cells are ordered, those in one cell aren't.
+    void VisibleCells(const Frustum &frustum, const glm::vec3 &eye, vector<VisibleCell> &out) const
+    {
+        out.clear();
+        float grow = looseness + maxRadius;
+        for (unordered_map<uint64_t, Cell>::const_iterator it = cells.begin(); it != cells.end(); ++it)
+        {
+            const Cell &cell = it->second;
+            glm::vec3 origin = cellOrigin(cell.x, cell.y, cell.z);
+            if (!frustum.IntersectsBox(origin - glm::vec3(grow), origin + glm::vec3(cellSize + grow)))
+                continue;
+            VisibleCell visible;
+            visible.distance = glm::length(eye - (origin + glm::vec3(cellSize * 0.5f)));
+            visible.members = &cell.members;
+            out.push_back(visible);
+        }
+        std::sort(out.begin(), out.end(), [](const VisibleCell &a, const VisibleCell &b) { return a.distance < b.distance; });
+    }
+
+    unsigned int CellCount() const { return (unsigned int)cells.size(); }
+    // instances that have changed cells since the grid was made
+    unsigned int Migrations() const { return migrations; }
+
+private:
+    struct Cell {
+        int x, y, z;
+        vector<unsigned int> members;
+    };
+    struct Entry {
+        Entry() : used(false), x(0), y(0), z(0), slot(0) {}
+        bool used;
+        int x, y, z;            // the cell
+        unsigned int slot;      // index in the cell's members
+    };
+
+    float cellSize;
+    float looseness;
+    float maxRadius;
+    unsigned int migrations;
+    unordered_map<uint64_t, Cell> cells;
+    vector<Entry> entries;      // by id
+
+    static uint64_t cellKey(int x, int y, int z)
+    {
+        return ((uint64_t)(x & 0x1fffff) << 42) | ((uint64_t)(y & 0x1fffff) << 21) | (uint64_t)(z & 0x1fffff);
+    }
+
+    glm::vec3 cellOrigin(int x, int y, int z) const
+    {
+        return glm::vec3((float)x, (float)y, (float)z) * cellSize;
+    }
+
+    void attach(unsigned int id, const glm::vec3 &position)
+    {
+        Entry &e = entries[id];
+        e.x = (int)floor(position.x / cellSize);
+        e.y = (int)floor(position.y / cellSize);
+        e.z = (int)floor(position.z / cellSize);
+        Cell &cell = cells[cellKey(e.x, e.y, e.z)];
+        cell.x = e.x;
+        cell.y = e.y;
+        cell.z = e.z;
+        e.slot = (unsigned int)cell.members.size();
+        e.used = true;
+        cell.members.push_back(id);
+    }
+
+    // swap-removes the instance from its cell and drops the cell once it is empty
+    void detach(unsigned int id)
+    {
+        Entry &e = entries[id];
+        unordered_map<uint64_t, Cell>::iterator it = cells.find(cellKey(e.x, e.y, e.z));
+        vector<unsigned int> &members = it->second.members;
+        unsigned int last = members.back();
+        members[e.slot] = last;
+        entries[last].slot = e.slot;
+        members.pop_back();
+        if (members.empty())
+            cells.erase(it);
+        e.used = false;
+    }
+};
+#endif
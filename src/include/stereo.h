@@ -0,0 +1,136 @@
+#ifndef STEREO_H
+#define STEREO_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include "camera.h"
+
+// Single-pass side-by-side stereo. Every draw is submitted with two instances; shaders built with
+// Defines() take the eye from gl_InstanceID & 1 and its view, projection and position from the
+// StereoViews uniform block at binding STEREO_VIEWS_BINDING, so both eyes come from one pass
+// over the command buffer.
+//
+// Each eye gets its half of the target through gl_ViewportIndex when the vertex shader may write
+// it (ARB_shader_viewport_layer_array). Otherwise both eyes share one full-width viewport: the
+// vertex shader squeezes each eye into its half and a clip distance cuts it off at the middle.
+//
+// The eyes are parallel cameras with off-axis frustums that converge at Convergence, so objects
+// at that distance appear at the screen plane.
+const GLuint STEREO_VIEWS_BINDING = 0;
+
+// std140 layout of the StereoViews block
+struct StereoViews {
+    glm::mat4 view[2];
+    glm::mat4 projection[2];
+    glm::vec4 eyePosition[2];
+};
+
+class StereoRenderer {
+public:
+    float EyeSeparation;    // world units between the eyes
+    float Convergence;      // distance of zero parallax
+
+    StereoRenderer(float eyeSeparation = 0.065f, float convergence = 6.0f)
+        : EyeSeparation(eyeSeparation), Convergence(convergence), ubo(0), viewportArray(false), queried(false)
+    {
+    }
+
+    ~StereoRenderer()
+    {
+        if (ubo != 0)
+            glDeleteBuffers(1, &ubo);
+    }
+
+    // true if each eye is routed to its own viewport; needs the context
+    bool UsesViewportArray()
+    {
+        if (!queried)
+        {
+            viewportArray = GLAD_GL_VERSION_4_1 && hasExtension("GL_ARB_shader_viewport_layer_array");
+            queried = true;
+        }
+        return viewportArray;
+    }
+
+    // prefix for Shader's defines that builds the stereo variant of a program
+    const char* Defines()
+    {
+        return UsesViewportArray() ? "#define STEREO\n#define STEREO_VIEWPORT\n" : "#define STEREO\n";
+    }
+
+    // fills the uniform block for both eyes of a camera frame; each eye gets half its width
+    void Update(const CameraFrame &camera)
+    {
+        StereoViews views;
+        float nearPlane = camera.NearPlane, farPlane = camera.FarPlane;
+        float top = nearPlane * tan(camera.FovY * 0.5f);
+        float halfWidth = top * camera.Aspect * 0.5f;
+        for (int eye = 0; eye < 2; eye++)
+        {
+            float side = eye == 0 ? -0.5f : 0.5f;
+            glm::vec3 position = camera.Position + camera.Right * (side * EyeSeparation);
+            views.view[eye] = glm::lookAt(position, position + camera.Front, camera.Up);
+            // shift the frustum towards the other eye so both meet at the convergence distance
+            float shift = -side * EyeSeparation * nearPlane / Convergence;
+            views.projection[eye] = glm::frustum(-halfWidth + shift, halfWidth + shift, -top, top, nearPlane, farPlane);
+            views.eyePosition[eye] = glm::vec4(position, 1.0f);
+        }
+
+        if (ubo == 0)
+        {
+            glGenBuffers(1, &ubo);
+            glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+            glBufferData(GL_UNIFORM_BUFFER, sizeof(StereoViews), NULL, GL_DYNAMIC_DRAW);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(StereoViews), &views);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, STEREO_VIEWS_BINDING, ubo);
+    }
+
+    // sets up the eyes' viewports in a width x height target; draws between Begin() and End()
+    // need 2 instances
+    void Begin(int width, int height)
+    {
+        if (UsesViewportArray())
+        {
+            glViewportIndexedf(0, 0.0f, 0.0f, width * 0.5f, (float)height);
+            glViewportIndexedf(1, width * 0.5f, 0.0f, width * 0.5f, (float)height);
+        }
+        else
+        {
+            glViewport(0, 0, width, height);
+            glEnable(GL_CLIP_DISTANCE0);
+        }
+    }
+
+    // back to one viewport covering the target
+    void End(int width, int height)
+    {
+        if (!UsesViewportArray())
+            glDisable(GL_CLIP_DISTANCE0);
+        glViewport(0, 0, width, height); // sets every viewport
+    }
+
+private:
+    GLuint ubo;
+    bool viewportArray;
+    bool queried;
+
+    static bool hasExtension(const char* name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+            if (extension != NULL && strcmp(extension, name) == 0)
+                return true;
+        }
+        return false;
+    }
+};
+#endif
@@ -0,0 +1,609 @@
+#ifndef TEXTURE_COMPRESS_H
+#define TEXTURE_COMPRESS_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <stb_image.h>
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "cache_file.h"
+
+using namespace std;
+
+// CPU block compression of 8-bit textures into BC1 (RGB, 4 bits per texel) and BC7 (RGBA,
+// 8 bits per texel), with the full mip chain, cached on disk next to the source as
+// <source>.texcache so each image is only encoded once.
+//
+// BC1 endpoints come from the principal axis of each block's colours, refined by least squares.
+// BC7 only uses mode 6 (one subset, RGBA endpoints with a shared p-bit, 16 interpolation steps);
+// it is the mode that suits smooth images best and keeps the encoder small. Blocks are encoded
+// in parallel with OpenMP.
+//
+// The cache holds the image as stbi_load returns it, so a change to
+// stbi_set_flip_vertically_on_load needs the .texcache files deleted.
+
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+enum Texture_Compression {
+    COMPRESS_NONE = 0,
+    COMPRESS_BC1 = 1,   // opaque images (1 or 3 components)
+    COMPRESS_BC7 = 2    // images with alpha (2 or 4 components)
+};
+
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+
+inline unsigned int CompressedBlockBytes(Texture_Compression format)
+{
+    return format == COMPRESS_BC1 ? 8 : 16;
+}
+
+inline GLenum CompressedInternalFormat(Texture_Compression format)
+{
+    return format == COMPRESS_BC1 ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_BPTC_UNORM;
+}
+
+// which formats the context can sample; query on the GL thread, use anywhere
+struct CompressionSupport {
+    bool bc1;
+    bool bc7;
+
+    CompressionSupport() : bc1(false), bc7(false) {}
+
+    static CompressionSupport Query()
+    {
+        CompressionSupport support;
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        vector<GLint> formats(std::max(count, 1));
+        if (count > 0)
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, &formats[0]);
+        for (GLint i = 0; i < count; i++)
+        {
+            if (formats[i] == GL_COMPRESSED_RGB_S3TC_DXT1_EXT)
+                support.bc1 = true;
+            if (formats[i] == GL_COMPRESSED_RGBA_BPTC_UNORM)
+                support.bc7 = true;
+        }
+        // BPTC is core since 4.2, but not every driver lists it as a general purpose format
+        if (GLAD_GL_VERSION_4_2)
+            support.bc7 = true;
+        return support;
+    }
+
+    // format for an image with this many components, COMPRESS_NONE if the context can't sample it
+    Texture_Compression For(int components) const
+    {
+        if (components == 2 || components == 4)
+            return bc7 ? COMPRESS_BC7 : COMPRESS_NONE;
+        return bc1 ? COMPRESS_BC1 : COMPRESS_NONE;
+    }
+};
+
+struct CompressedTexture {
+    Texture_Compression format;
+    int width, height;
+    int components;                         // of the source image
+    vector<vector<unsigned char> > levels;  // full mip chain, level 0 first
+
+    CompressedTexture() : format(COMPRESS_NONE), width(0), height(0), components(0) {}
+};
+
+// ----------------------------------------------------------------------------------------------
+// block encoders; blocks are 16 RGBA texels in rows
+
+// principal axis of the block's texels (power iteration on the covariance matrix); mean is filled in
+inline void blockPrincipalAxis(const float (*texels)[4], int channels, float mean[4], float axis[4])
+{
+    for (int c = 0; c < 4; c++)
+        mean[c] = 0.0f;
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < channels; c++)
+            mean[c] += texels[i][c] / 16.0f;
+    float cov[4][4] = { { 0.0f } };
+    for (int i = 0; i < 16; i++)
+        for (int a = 0; a < channels; a++)
+            for (int b = 0; b < channels; b++)
+                cov[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+    for (int c = 0; c < 4; c++)
+        axis[c] = c < channels ? 1.0f : 0.0f;
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        float length = 0.0f;
+        for (int a = 0; a < channels; a++)
+        {
+            for (int b = 0; b < channels; b++)
+                next[a] += cov[a][b] * axis[b];
+            length = std::max(length, std::fabs(next[a]));
+        }
+        if (length == 0.0f)
+            break; // flat block, any axis will do
+        for (int a = 0; a < channels; a++)
+            axis[a] = next[a] / length;
+    }
+}
+
+// endpoints at the extremes of the texels' projections onto the principal axis
+inline void blockAxisEndpoints(const float (*texels)[4], int channels, float lo[4], float hi[4])
+{
+    float mean[4], axis[4];
+    blockPrincipalAxis(texels, channels, mean, axis);
+    float minT = 0.0f, maxT = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++)
+            t += (texels[i][c] - mean[c]) * axis[c];
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for (int c = 0; c < 4; c++)
+    {
+        lo[c] = std::min(std::max(mean[c] + axis[c] * minT, 0.0f), 255.0f);
+        hi[c] = std::min(std::max(mean[c] + axis[c] * maxT, 0.0f), 255.0f);
+    }
+}
+
+// least squares endpoints for fixed interpolation weights; false if the weights are degenerate
+inline bool blockFitEndpoints(const float (*texels)[4], int channels, const float weights[16], float lo[4], float hi[4])
+{
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = { 0.0f, 0.0f, 0.0f, 0.0f }, bx[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++)
+    {
+        float b = weights[i], a = 1.0f - b;
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+        for (int c = 0; c < channels; c++)
+        {
+            ax[c] += a * texels[i][c];
+            bx[c] += b * texels[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f)
+        return false;
+    for (int c = 0; c < channels; c++)
+    {
+        lo[c] = std::min(std::max((bb * ax[c] - ab * bx[c]) / det, 0.0f), 255.0f);
+        hi[c] = std::min(std::max((aa * bx[c] - ab * ax[c]) / det, 0.0f), 255.0f);
+    }
+    return true;
+}
+
+inline uint16_t pack565(const float color[4])
+{
+    int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+inline void unpack565(uint16_t packed, int color[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 in four colour mode: palette c0, c1, (2 c0 + c1) / 3, (c0 + 2 c1) / 3
+inline void EncodeBC1Block(const unsigned char rgba[64], unsigned char out[8])
+{
+    float texels[16][4];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            texels[i][c] = rgba[i * 4 + c];
+
+    float lo[4], hi[4];
+    blockAxisEndpoints(texels, 3, lo, hi);
+
+    // index -> position along c0..c1
+    static const float indexWeight[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+    uint16_t bestC0 = 0, bestC1 = 0;
+    uint32_t bestIndices = 0;
+    int bestError = -1;
+    for (int pass = 0; pass < 3; pass++)
+    {
+        uint16_t c0 = pack565(hi), c1 = pack565(lo);
+        int e0[3], e1[3], palette[4][3];
+        unpack565(c0, e0);
+        unpack565(c1, e1);
+        for (int c = 0; c < 3; c++)
+        {
+            palette[0][c] = e0[c];
+            palette[1][c] = e1[c];
+            palette[2][c] = (2 * e0[c] + e1[c]) / 3;
+            palette[3][c] = (e0[c] + 2 * e1[c]) / 3;
+        }
+
+        uint32_t indices = 0;
+        int error = 0;
+        float weights[16];
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = -1;
+            for (int p = 0; p < 4; p++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 3; c++)
+                {
+                    int d = palette[p][c] - rgba[i * 4 + c];
+                    distance += d * d;
+                }
+                if (bestDistance < 0 || distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+            error += bestDistance;
+            weights[i] = 1.0f - indexWeight[best]; // lo is c1, so weights run from hi to lo
+        }
+        if (bestError < 0 || error < bestError)
+        {
+            bestError = error;
+            bestC0 = c0;
+            bestC1 = c1;
+            bestIndices = indices;
+        }
+        if (error == 0 || !blockFitEndpoints(texels, 3, weights, lo, hi))
+            break;
+    }
+
+    // four colour mode needs c0 > c1; swapping the endpoints swaps indices 0<->1 and 2<->3
+    if (bestC0 < bestC1)
+    {
+        std::swap(bestC0, bestC1);
+        bestIndices ^= 0x55555555;
+    }
+    else if (bestC0 == bestC1)
+        bestIndices = 0; // three colour mode; index 0 is still c0
+    out[0] = (unsigned char)(bestC0 & 0xFF);
+    out[1] = (unsigned char)(bestC0 >> 8);
+    out[2] = (unsigned char)(bestC1 & 0xFF);
+    out[3] = (unsigned char)(bestC1 >> 8);
+    for (int i = 0; i < 4; i++)
+        out[4 + i] = (unsigned char)(bestIndices >> (i * 8));
+}
+
+// little-endian bit stream, as BC7 blocks are laid out
+struct BlockBitWriter {
+    unsigned char *out;
+    int position;
+
+    void Write(uint32_t value, int bits)
+    {
+        for (int i = 0; i < bits; i++, position++)
+            if ((value >> i) & 1)
+                out[position >> 3] |= (unsigned char)(1 << (position & 7));
+    }
+};
+
+// 7-bit endpoint plus shared p-bit that best matches color; returns the squared error
+inline float quantizeBC7Endpoint(const float color[4], int quantized[4], int &pBit)
+{
+    float bestError = -1.0f;
+    pBit = 0;
+    for (int p = 0; p < 2; p++)
+    {
+        int q[4];
+        float error = 0.0f;
+        for (int c = 0; c < 4; c++)
+        {
+            q[c] = std::min(std::max((int)((color[c] - p) / 2.0f + 0.5f), 0), 127);
+            float d = (float)((q[c] << 1) | p) - color[c];
+            error += d * d;
+        }
+        if (bestError < 0.0f || error < bestError)
+        {
+            bestError = error;
+            pBit = p;
+            for (int c = 0; c < 4; c++)
+                quantized[c] = q[c];
+        }
+    }
+    return bestError;
+}
+
+// BC7 mode 6: one subset, RGBA 7.7.7.7 endpoints with a p-bit each, 4-bit indices
+inline void EncodeBC7Block(const unsigned char rgba[64], unsigned char out[16])
+{
+    static const int weights4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+    float texels[16][4];
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            texels[i][c] = rgba[i * 4 + c];
+
+    float lo[4], hi[4];
+    blockAxisEndpoints(texels, 4, lo, hi);
+
+    int bestQ[2][4] = { { 0 } }, bestP[2] = { 0, 0 };
+    int bestIndices[16] = { 0 };
+    int bestError = -1;
+    for (int pass = 0; pass < 3; pass++)
+    {
+        int q[2][4], p[2];
+        quantizeBC7Endpoint(lo, q[0], p[0]);
+        quantizeBC7Endpoint(hi, q[1], p[1]);
+        int e[2][4];
+        for (int c = 0; c < 4; c++)
+        {
+            e[0][c] = (q[0][c] << 1) | p[0];
+            e[1][c] = (q[1][c] << 1) | p[1];
+        }
+        int palette[16][4];
+        for (int s = 0; s < 16; s++)
+            for (int c = 0; c < 4; c++)
+                palette[s][c] = ((64 - weights4[s]) * e[0][c] + weights4[s] * e[1][c] + 32) >> 6;
+
+        int indices[16];
+        int error = 0;
+        float fitWeights[16];
+        for (int i = 0; i < 16; i++)
+        {
+            int best = 0, bestDistance = -1;
+            for (int s = 0; s < 16; s++)
+            {
+                int distance = 0;
+                for (int c = 0; c < 4; c++)
+                {
+                    int d = palette[s][c] - rgba[i * 4 + c];
+                    distance += d * d;
+                }
+                if (bestDistance < 0 || distance < bestDistance)
+                {
+                    bestDistance = distance;
+                    best = s;
+                }
+            }
+            indices[i] = best;
+            error += bestDistance;
+            fitWeights[i] = weights4[best] / 64.0f;
+        }
+        if (bestError < 0 || error < bestError)
+        {
+            bestError = error;
+            memcpy(bestQ, q, sizeof(q));
+            memcpy(bestP, p, sizeof(p));
+            memcpy(bestIndices, indices, sizeof(indices));
+        }
+        if (error == 0 || !blockFitEndpoints(texels, 4, fitWeights, lo, hi))
+            break;
+    }
+
+    // the first index is stored without its top bit, so it must be below 8
+    if (bestIndices[0] >= 8)
+    {
+        for (int c = 0; c < 4; c++)
+            std::swap(bestQ[0][c], bestQ[1][c]);
+        std::swap(bestP[0], bestP[1]);
+        for (int i = 0; i < 16; i++)
+            bestIndices[i] = 15 - bestIndices[i];
+    }
+
+    memset(out, 0, 16);
+    BlockBitWriter bits = { out, 0 };
+    bits.Write(1 << 6, 7); // mode 6
+    for (int c = 0; c < 4; c++)
+    {
+        bits.Write(bestQ[0][c], 7);
+        bits.Write(bestQ[1][c], 7);
+    }
+    bits.Write(bestP[0], 1);
+    bits.Write(bestP[1], 1);
+    bits.Write(bestIndices[0], 3);
+    for (int i = 1; i < 16; i++)
+        bits.Write(bestIndices[i], 4);
+}
+
+// ----------------------------------------------------------------------------------------------
+// images
+
+// compresses one RGBA8 level; edge blocks repeat the last row and column. Rows of blocks are
+// spread over an OpenMP team unless parallel is false, as it should be on threads that are
+// already one of many (such as TextureStreamer's workers).
+inline void CompressImage(const unsigned char *rgba, int width, int height, Texture_Compression format, vector<unsigned char> &out,
+                          bool parallel = true)
+{
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    unsigned int blockBytes = CompressedBlockBytes(format);
+    out.resize((size_t)blocksX * blocksY * blockBytes);
+
+    #pragma omp parallel for schedule(dynamic) if(parallel)
+    for (int by = 0; by < blocksY; by++)
+    {
+        unsigned char block[64];
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            for (int y = 0; y < 4; y++)
+                for (int x = 0; x < 4; x++)
+                {
+                    int sx = std::min(bx * 4 + x, width - 1), sy = std::min(by * 4 + y, height - 1);
+                    memcpy(&block[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+                }
+            unsigned char *dst = &out[((size_t)by * blocksX + bx) * blockBytes];
+            if (format == COMPRESS_BC1)
+                EncodeBC1Block(block, dst);
+            else
+                EncodeBC7Block(block, dst);
+        }
+    }
+}
+
+// next mip level of an RGBA8 image, 2x2 box filter (odd sizes repeat the last row or column)
+inline void downsampleRGBA(const vector<unsigned char> &src, int width, int height, vector<unsigned char> &dst)
+{
+    int w = std::max(width / 2, 1), h = std::max(height / 2, 1);
+    dst.resize((size_t)w * h * 4);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+            int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+            for (int c = 0; c < 4; c++)
+            {
+                int sum = src[((size_t)y0 * width + x0) * 4 + c] + src[((size_t)y0 * width + x1) * 4 + c] +
+                          src[((size_t)y1 * width + x0) * 4 + c] + src[((size_t)y1 * width + x1) * 4 + c];
+                dst[((size_t)y * w + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+}
+
+// compresses an 8-bit image of 1 to 4 components and its whole mip chain
+inline void CompressTexture(const unsigned char *data, int width, int height, int components, Texture_Compression format, CompressedTexture &out,
+                            bool parallel = true)
+{
+    vector<unsigned char> level((size_t)width * height * 4);
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        const unsigned char *s = data + i * components;
+        unsigned char *d = &level[i * 4];
+        d[0] = s[0];
+        d[1] = components >= 3 ? s[1] : s[0];
+        d[2] = components >= 3 ? s[2] : s[0];
+        d[3] = components == 4 ? s[3] : (components == 2 ? s[1] : 255);
+    }
+
+    out.format = format;
+    out.width = width;
+    out.height = height;
+    out.components = components;
+    out.levels.clear();
+    int w = width, h = height;
+    vector<unsigned char> next;
+    for (;;)
+    {
+        out.levels.push_back(vector<unsigned char>());
+        CompressImage(&level[0], w, h, format, out.levels.back(), parallel);
+        if (w == 1 && h == 1)
+            break;
+        downsampleRGBA(level, w, h, next);
+        level.swap(next);
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+    }
+}
+
+// ----------------------------------------------------------------------------------------------
+// on-disk cache
+
+struct TextureCacheHeader {
+    char     magic[8];          // "GEMTEX"
+    uint32_t version;           // TEXTURE_CACHE_VERSION
+    uint32_t format;            // Texture_Compression
+    uint32_t width;
+    uint32_t height;
+    uint32_t components;
+    uint32_t levelCount;
+};
+
+class TextureCache {
+public:
+    static string PathFor(const string &source)
+    {
+        return source + ".texcache";
+    }
+
+    static bool Write(const string &cachePath, const CompressedTexture &texture)
+    {
+        TextureCacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, "GEMTEX", 7);
+        header.version = TEXTURE_CACHE_VERSION;
+        header.format = texture.format;
+        header.width = texture.width;
+        header.height = texture.height;
+        header.components = texture.components;
+        header.levelCount = (uint32_t)texture.levels.size();
+
+        return WriteFileSafely(cachePath, [&](std::ofstream &out) {
+            out.write((const char*)&header, sizeof(header));
+            for (unsigned int i = 0; i < texture.levels.size(); i++)
+                out.write((const char*)&texture.levels[i][0], texture.levels[i].size());
+            return true;
+        });
+    }
+
+    // false if the file is missing, from another version, or doesn't hold the whole chain
+    static bool Read(const string &cachePath, CompressedTexture &texture)
+    {
+        std::ifstream in(cachePath.c_str(), std::ios::binary);
+        TextureCacheHeader header;
+        if (!in || !in.read((char*)&header, sizeof(header)))
+            return false;
+        if (memcmp(header.magic, "GEMTEX", 7) != 0 || header.version != TEXTURE_CACHE_VERSION ||
+            (header.format != COMPRESS_BC1 && header.format != COMPRESS_BC7) ||
+            header.width == 0 || header.height == 0 || header.levelCount > 32)
+            return false;
+
+        texture.format = (Texture_Compression)header.format;
+        texture.width = (int)header.width;
+        texture.height = (int)header.height;
+        texture.components = (int)header.components;
+        texture.levels.resize(header.levelCount);
+        int w = texture.width, h = texture.height;
+        for (unsigned int i = 0; i < header.levelCount; i++)
+        {
+            texture.levels[i].resize((size_t)((w + 3) / 4) * ((h + 3) / 4) * CompressedBlockBytes(texture.format));
+            if (!in.read((char*)&texture.levels[i][0], texture.levels[i].size()))
+                return false;
+            w = std::max(w / 2, 1);
+            h = std::max(h / 2, 1);
+        }
+        return true;
+    }
+};
+
+// compressed image of a file, from its cache when fresh, otherwise loaded, encoded and cached.
+// False if the file can't be loaded or the context supports no format for it; the caller then
+// falls back to an uncompressed upload. parallel is passed on to CompressImage.
+inline bool LoadCompressedTexture(const string &filename, const CompressionSupport &support, CompressedTexture &texture,
+                                  bool parallel = true)
+{
+    string cachePath = TextureCache::PathFor(filename);
+    if (CacheIsFresh(cachePath, filename) && TextureCache::Read(cachePath, texture))
+    {
+        if (support.For(texture.components) == texture.format)
+            return true;
+    }
+
+    int width, height, components;
+    if (!stbi_info(filename.c_str(), &width, &height, &components) || support.For(components) == COMPRESS_NONE)
+        return false;
+    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &components, 0);
+    if (!data)
+        return false;
+    CompressTexture(data, width, height, components, support.For(components), texture, parallel);
+    stbi_image_free(data);
+    TextureCache::Write(cachePath, texture);
+    return true;
+}
+
+// specifies every level of texture into target (a 2D texture or a cube face) of the bound texture
+inline void UploadCompressedTexture(GLenum target, const CompressedTexture &texture)
+{
+    GLenum internalFormat = CompressedInternalFormat(texture.format);
+    int w = texture.width, h = texture.height;
+    for (unsigned int i = 0; i < texture.levels.size(); i++)
+    {
+        glCompressedTexImage2D(target, i, internalFormat, w, h, 0, (GLsizei)texture.levels[i].size(), &texture.levels[i][0]);
+        w = std::max(w / 2, 1);
+        h = std::max(h / 2, 1);
+    }
+}
+#endif
@@ -0,0 +1,317 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <stb_image.h>
+#include "texture_compress.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// Streams 2D textures in the background. Request() hands back a texture name right away, filled
+// with a 1x1 placeholder; worker threads decode the file with stb_image and Update() uploads the
+// results on the GL thread through pixel unpack buffers, within a time budget per frame.
+// The real image is specified into the same texture name, so anything holding the id (such as
+// Mesh::textures) picks it up on the next draw without being told.
+// Where the context supports it, workers load (or encode and cache) the block compressed form
+// from texture_compress.h instead, and the upload specifies its prebuilt mip chain.
+//
+// A texture deleted before its image arrives must be passed to Cancel() first: GL hands deleted
+// names out again, so the late image would otherwise land in whatever texture reuses the name.
+// Owners that may outlive the streamer cancel through a Handle, which expires with it; the
+// destructor drops every outstanding request, so there is nothing left to cancel by then.
+//
+// stbi_set_flip_vertically_on_load is global state in stb_image; set it before the first Request.
+class TextureStreamer {
+public:
+    typedef std::weak_ptr<TextureStreamer*> Handle;
+
+    // threads: decode workers, 0 for one less than the hardware threads.
+    // Workers start on the first Request, so an unused streamer costs nothing.
+    TextureStreamer(unsigned int threads = 0)
+        : threadCount(threads), stopping(false), pending(0), nextSerial(0), nextPBO(0), supportQueried(false),
+          self(std::make_shared<TextureStreamer*>(this))
+    {
+        if (threadCount == 0)
+        {
+            unsigned int hw = std::thread::hardware_concurrency();
+            threadCount = hw > 1 ? hw - 1 : 1;
+        }
+        pbos[0] = pbos[1] = pbos[2] = pbos[3] = 0;
+    }
+
+    ~TextureStreamer()
+    {
+        self.reset();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+        for (unsigned int i = 0; i < ready.size(); i++)
+            stbi_image_free(ready[i].data);
+        if (pbos[0] != 0)
+            glDeleteBuffers(PBO_COUNT, pbos);
+    }
+
+    // queues a file for decoding and returns a texture that samples as the placeholder colour
+    // until the image is resident. Must be called on the GL thread.
+    unsigned int Request(const string &filename, const unsigned char placeholder[4] = NULL)
+    {
+        static const unsigned char white[4] = { 255, 255, 255, 255 };
+        if (placeholder == NULL)
+            placeholder = white;
+
+        unsigned int textureID;
+        glGenTextures(1, &textureID);
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        // a single 1x1 level is a complete mip chain, so the final sampler state can be set now
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholder);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        if (!supportQueried)
+        {
+            // needs the context, so it waits for the first request on the GL thread
+            support = CompressionSupport::Query();
+            supportQueried = true;
+        }
+
+        Job job;
+        job.texture = textureID;
+        job.filename = filename;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job.serial = nextSerial++;
+            live[textureID] = job.serial;
+            if (workers.empty())
+                for (unsigned int i = 0; i < threadCount; i++)
+                    workers.push_back(std::thread(&TextureStreamer::work, this));
+            jobs.push_back(job);
+            pending++;
+        }
+        wake.notify_one();
+        return textureID;
+    }
+
+    // uploads decoded images until budgetMs has been spent; call once per frame on the GL thread.
+    // At least one image is uploaded per call so a small budget can't stall streaming entirely.
+    void Update(double budgetMs = 2.0)
+    {
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        bool uploaded = false;
+        for (;;)
+        {
+            Decoded image;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (ready.empty())
+                    break;
+                if (uploaded)
+                {
+                    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+                    if (elapsed.count() >= budgetMs)
+                        break;
+                }
+                image = std::move(ready.front());
+                ready.pop_front();
+                live.erase(image.texture);
+                pending--;
+            }
+            upload(image);
+            uploaded = true;
+        }
+    }
+
+    // drops the request for texture, queued, decoding or decoded; call before deleting a texture
+    // that may not be resident yet. Does nothing for one that is.
+    void Cancel(unsigned int texture)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (live.erase(texture) == 0)
+            return;
+        pending--;
+        for (unsigned int i = 0; i < jobs.size();)
+        {
+            if (jobs[i].texture == texture)
+                jobs.erase(jobs.begin() + i);
+            else
+                i++;
+        }
+        for (unsigned int i = 0; i < ready.size();)
+        {
+            if (ready[i].texture == texture)
+            {
+                stbi_image_free(ready[i].data);
+                ready.erase(ready.begin() + i);
+            }
+            else
+                i++;
+        }
+        // one still decoding is dropped by its worker, which finds the serial gone
+    }
+
+    // Cancel(texture) on the streamer behind handle, if it still exists
+    static void Cancel(const Handle &handle, unsigned int texture)
+    {
+        std::shared_ptr<TextureStreamer*> streamer = handle.lock();
+        if (streamer)
+            (*streamer)->Cancel(texture);
+    }
+
+    Handle GetHandle() const { return self; }
+
+    // number of requests not yet resident
+    unsigned int Pending()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return pending;
+    }
+
+private:
+    static const unsigned int PBO_COUNT = 4;
+
+    struct Job {
+        unsigned int texture;
+        uint64_t serial;        // tells a request apart from a later one that reuses the name
+        string filename;
+    };
+    struct Decoded {
+        unsigned int texture;
+        uint64_t serial;
+        unsigned char* data; // NULL if the file failed to load or is compressed
+        int width, height, components;
+        string filename;
+        CompressedTexture compressed;
+    };
+
+    unsigned int threadCount;
+    vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    deque<Job> jobs;
+    deque<Decoded> ready;
+    bool stopping;
+    unsigned int pending;
+    // the serial of each texture's outstanding request; a cancelled one has none
+    unordered_map<unsigned int, uint64_t> live;
+    uint64_t nextSerial;
+
+    // uploads rotate through a few unpack buffers so a copy never waits on the previous transfer
+    GLuint pbos[PBO_COUNT];
+    unsigned int nextPBO;
+
+    // written before the first job is queued, read-only for the workers after that
+    CompressionSupport support;
+    bool supportQueried;
+
+    // the only strong reference behind every Handle, dropped first thing in the destructor
+    std::shared_ptr<TextureStreamer*> self;
+
+    // decode worker: runs stbi_load off the GL thread
+    void work()
+    {
+        for (;;)
+        {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (!stopping && jobs.empty())
+                    wake.wait(lock);
+                if (stopping)
+                    return;
+                job = jobs.front();
+                jobs.pop_front();
+            }
+
+            Decoded image;
+            image.texture = job.texture;
+            image.serial = job.serial;
+            image.filename = job.filename;
+            image.data = NULL;
+            // the workers are the parallelism; an OpenMP team in each would oversubscribe the CPU
+            if (!LoadCompressedTexture(job.filename, support, image.compressed, false))
+                image.data = stbi_load(job.filename.c_str(), &image.width, &image.height, &image.components, 0);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            unordered_map<unsigned int, uint64_t>::iterator it = live.find(image.texture);
+            if (it == live.end() || it->second != image.serial)
+            {
+                // cancelled while it was decoding
+                stbi_image_free(image.data);
+                continue;
+            }
+            ready.push_back(std::move(image));
+        }
+    }
+
+    void upload(const Decoded &image)
+    {
+        if (!image.compressed.levels.empty())
+        {
+            glBindTexture(GL_TEXTURE_2D, image.texture);
+            UploadCompressedTexture(GL_TEXTURE_2D, image.compressed);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)image.compressed.levels.size() - 1);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return;
+        }
+
+        if (!image.data)
+        {
+            // keep the placeholder, as TextureFromFile keeps an empty texture
+            std::cout << "Texture failed to load at path: " << image.filename << std::endl;
+            return;
+        }
+
+        GLenum format;
+        if (image.components == 1)
+            format = GL_RED;
+        else if (image.components == 3)
+            format = GL_RGB;
+        else
+            format = GL_RGBA;
+        GLsizeiptr size = (GLsizeiptr)image.width * image.height * image.components;
+
+        if (pbos[0] == 0)
+            glGenBuffers(PBO_COUNT, pbos);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbos[nextPBO]);
+        nextPBO = (nextPBO + 1) % PBO_COUNT;
+        // orphan the previous storage so mapping doesn't wait for an upload still in flight
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+        void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (dst)
+        {
+            memcpy(dst, image.data, size);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        stbi_image_free(image.data);
+
+        // rows of 1 or 3 byte texels aren't 4-byte aligned in general
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glBindTexture(GL_TEXTURE_2D, image.texture);
+        if (dst)
+            glTexImage2D(GL_TEXTURE_2D, 0, format, image.width, image.height, 0, format, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    }
+};
+#endif
@@ -0,0 +1,129 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D scene;
+uniform vec2 texelSize;         // 1 / texture size
+uniform vec2 regionScale;       // rendered region / texture size
+uniform float edgeThreshold;
+uniform float edgeThresholdMin;
+uniform float subpixel;
+uniform int searchSteps;
+
+// step lengths along an edge, growing once the nearby samples have been checked
+const float stepLength[12] = float[](1.0, 1.0, 1.0, 1.0, 1.0, 1.5, 2.0, 2.0, 2.0, 2.0, 4.0, 8.0);
+
+float luma(vec3 color)
+{
+    return sqrt(dot(color, vec3(0.299, 0.587, 0.114))); // perceptual, roughly gamma 2
+}
+
+// luma at uv + offset texels, kept inside the rendered region
+float lumaAt(vec2 uv, vec2 offset)
+{
+    vec2 p = clamp(uv + offset * texelSize, texelSize * 0.5, regionScale - texelSize * 0.5);
+    return luma(textureLod(scene, p, 0.0).rgb);
+}
+
+void main()
+{
+    vec2 uv = TexCoords * regionScale;
+    vec3 centerColor = textureLod(scene, uv, 0.0).rgb;
+
+    float lumaC = luma(centerColor);
+    float lumaN = lumaAt(uv, vec2( 0.0,  1.0));
+    float lumaS = lumaAt(uv, vec2( 0.0, -1.0));
+    float lumaE = lumaAt(uv, vec2( 1.0,  0.0));
+    float lumaW = lumaAt(uv, vec2(-1.0,  0.0));
+    float lumaMin = min(lumaC, min(min(lumaN, lumaS), min(lumaE, lumaW)));
+    float lumaMax = max(lumaC, max(max(lumaN, lumaS), max(lumaE, lumaW)));
+    float range = lumaMax - lumaMin;
+    if (searchSteps == 0 || range < max(edgeThresholdMin, lumaMax * edgeThreshold))
+    {
+        FragColor = vec4(centerColor, 1.0);
+        return;
+    }
+
+    float lumaNE = lumaAt(uv, vec2( 1.0,  1.0));
+    float lumaNW = lumaAt(uv, vec2(-1.0,  1.0));
+    float lumaSE = lumaAt(uv, vec2( 1.0, -1.0));
+    float lumaSW = lumaAt(uv, vec2(-1.0, -1.0));
+
+    // edge orientation from second differences
+    float horizontal = abs(lumaNW + lumaNE - 2.0 * lumaN) + 2.0 * abs(lumaW + lumaE - 2.0 * lumaC) + abs(lumaSW + lumaSE - 2.0 * lumaS);
+    float vertical   = abs(lumaNW + lumaSW - 2.0 * lumaW) + 2.0 * abs(lumaN + lumaS - 2.0 * lumaC) + abs(lumaNE + lumaSE - 2.0 * lumaE);
+    bool isHorizontal = horizontal >= vertical;
+
+    // which side of the pixel the edge is on
+    float luma1 = isHorizontal ? lumaS : lumaW;
+    float luma2 = isHorizontal ? lumaN : lumaE;
+    float gradient1 = luma1 - lumaC;
+    float gradient2 = luma2 - lumaC;
+    bool side1 = abs(gradient1) >= abs(gradient2);
+    float gradientScaled = 0.25 * max(abs(gradient1), abs(gradient2));
+    float stepSize = isHorizontal ? texelSize.y : texelSize.x;
+    float lumaLocalAverage;
+    if (side1)
+    {
+        stepSize = -stepSize;
+        lumaLocalAverage = 0.5 * (luma1 + lumaC);
+    }
+    else
+        lumaLocalAverage = 0.5 * (luma2 + lumaC);
+
+    // walk both ways along the edge, half a pixel over on its boundary
+    vec2 edgeUV = uv;
+    if (isHorizontal)
+        edgeUV.y += stepSize * 0.5;
+    else
+        edgeUV.x += stepSize * 0.5;
+    vec2 along = isHorizontal ? vec2(texelSize.x, 0.0) : vec2(0.0, texelSize.y);
+
+    vec2 uv1 = edgeUV - along;
+    vec2 uv2 = edgeUV + along;
+    float lumaEnd1 = 0.0, lumaEnd2 = 0.0;
+    bool reached1 = false, reached2 = false;
+    for (int i = 0; i < searchSteps && !(reached1 && reached2); i++)
+    {
+        if (!reached1)
+        {
+            lumaEnd1 = luma(textureLod(scene, clamp(uv1, vec2(0.0), regionScale), 0.0).rgb) - lumaLocalAverage;
+            reached1 = abs(lumaEnd1) >= gradientScaled;
+            if (!reached1)
+                uv1 -= along * stepLength[min(i + 1, 11)];
+        }
+        if (!reached2)
+        {
+            lumaEnd2 = luma(textureLod(scene, clamp(uv2, vec2(0.0), regionScale), 0.0).rgb) - lumaLocalAverage;
+            reached2 = abs(lumaEnd2) >= gradientScaled;
+            if (!reached2)
+                uv2 += along * stepLength[min(i + 1, 11)];
+        }
+    }
+
+    // offset towards the nearer end, if that end really is where this pixel's edge stops
+    float distance1 = isHorizontal ? (uv.x - uv1.x) : (uv.y - uv1.y);
+    float distance2 = isHorizontal ? (uv2.x - uv.x) : (uv2.y - uv.y);
+    bool nearer1 = distance1 < distance2;
+    float edgeLength = distance1 + distance2;
+    float pixelOffset = -min(distance1, distance2) / edgeLength + 0.5;
+    bool centerSmaller = lumaC < lumaLocalAverage;
+    bool correctVariation = ((nearer1 ? lumaEnd1 : lumaEnd2) < 0.0) != centerSmaller;
+    float finalOffset = correctVariation ? pixelOffset : 0.0;
+
+    // sub-pixel softening from the 3x3 average
+    float lumaAverage = (2.0 * (lumaN + lumaS + lumaE + lumaW) + lumaNE + lumaNW + lumaSE + lumaSW) / 12.0;
+    float subpixelOffset1 = clamp(abs(lumaAverage - lumaC) / range, 0.0, 1.0);
+    float subpixelOffset2 = (-2.0 * subpixelOffset1 + 3.0) * subpixelOffset1 * subpixelOffset1;
+    float subpixelOffset = subpixelOffset2 * subpixelOffset2 * subpixel;
+    finalOffset = max(finalOffset, subpixelOffset);
+
+    vec2 finalUV = uv;
+    if (isHorizontal)
+        finalUV.y += finalOffset * stepSize;
+    else
+        finalUV.x += finalOffset * stepSize;
+    finalUV = clamp(finalUV, texelSize * 0.5, regionScale - texelSize * 0.5);
+    FragColor = vec4(textureLod(scene, finalUV, 0.0).rgb, 1.0);
+}
@@ -4,6 +4,14 @@ out vec4 FragColor;
 in vec3 Normal;
 in vec3 Position;
 
+// Shading tiers, picked per gem by its size on screen:
+//   default       Phong plus a refraction and a reflection fetch, per fragment
+//   SHADE_SINGLE  Phong plus the reflection fetch only, which carries most of the mix
+//   SHADE_FACE    everything evaluated per face in gem.vert
+#ifdef SHADE_FACE
+flat in vec3 FaceColor;
+#endif
+
 struct Material {
 	vec3 ambient;
 	vec3 diffuse;
@@ -22,16 +30,36 @@ struct Light {
 
 uniform Light light;
 
+#ifdef STEREO
+layout (std140, binding = 0) uniform StereoViews {
+	mat4 eyeView[2];
+	mat4 eyeProjection[2];
+	vec4 eyePosition[2];
+};
+flat in int Eye;
+#define cameraPos eyePosition[Eye].xyz
+#else
 uniform vec3 cameraPos;
+#endif
 uniform samplerCube skybox;
 uniform vec3 objectColor;
 
+// environment level of detail. The facets turn the environment around quickly, so as a gem
+// shrinks on screen each pixel covers a wider spread of reflected directions; the lookup LOD
+// follows that spread instead of the (near zero) derivatives across a flat facet.
+uniform float envLodScale;      // texels of spread per pixel at distance 1, 0 for level 0 always
+uniform float envMaxLod;        // last mip of skybox
+uniform float envRoughness;     // extra blur in [0, 1]; needs the GGX prefiltered chain to look right
+
 float reflectRefractRatio = 0.8;
 float lightingResistance = 0.6;
 float opacity = 0.7;
 
 void main()
 {             
+#ifdef SHADE_FACE
+	FragColor = vec4(FaceColor, opacity);
+#else
 	//ambient
 	vec3 ambient = light.ambient * material.ambient;
 
@@ -62,12 +90,20 @@ void main()
     vec3 Rl = reflect(I, normalize(Normal));
 
 
+	float viewDistance = length(cameraPos - Position);
+	float envLod = max(log2(max(viewDistance * envLodScale, 1.0)), envRoughness * envMaxLod);
+	envLod = min(envLod, envMaxLod);
+
+#ifdef SHADE_SINGLE
+	vec3 processResult = textureLod(skybox, Rl, envLod).rgb;
+#else
 	// mix refraction and reflection 
 	vec3 processResult = mix(
-							texture(skybox, Rr).rgb, 
-							texture(skybox, Rl).rgb, 
+							textureLod(skybox, Rr, envLod).rgb, 
+							textureLod(skybox, Rl, envLod).rgb, 
 							reflectRefractRatio
 						);
+#endif
 
 	// experimental: reduce the contrast seen in the emerald
 	//processResult = processResult - (processResult - 0.5) * 0.1;
@@ -80,4 +116,5 @@ void main()
 	processResult = mix(result, processResult, lightingResistance);
 
     FragColor = vec4(processResult, opacity);
+#endif
 }  
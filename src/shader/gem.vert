@@ -1,18 +1,107 @@
 #version 460 core
+#ifdef STEREO
+#ifdef STEREO_VIEWPORT
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+// both eyes from one draw: even instances are the left eye, odd ones the right (stereo.h)
+layout (std140, binding = 0) uniform StereoViews {
+	mat4 eyeView[2];
+	mat4 eyeProjection[2];
+	vec4 eyePosition[2];
+};
+#define EYE (gl_InstanceID & 1)
+#define view eyeView[EYE]
+#define projection eyeProjection[EYE]
+#define cameraPos eyePosition[EYE].xyz
+#else
+uniform mat4 view;
+uniform mat4 projection;
+#endif
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 
 out vec3 Normal;
 out vec3 Position;
+#ifdef STEREO
+flat out int Eye;
+#endif
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+#ifdef SHADE_FACE
+// Lowest shading tier, for gems a few pixels across: the whole of gem.frag's shading runs here
+// and each face takes the colour of its provoking vertex. The facets are planar, so the normal
+// is exact; only the view direction is taken at one corner instead of per pixel.
+flat out vec3 FaceColor;
+
+struct Material {
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+	float shininess;
+};
+
+uniform Material material;
+
+struct Light {
+	vec3 position;
+	vec3 ambient;
+	vec3 diffuse;
+	vec3 specular;
+};
+
+uniform Light light;
+
+#ifndef STEREO
+uniform vec3 cameraPos;
+#endif
+uniform samplerCube skybox;
+uniform vec3 objectColor;
+uniform float envLodScale;
+uniform float envMaxLod;
+uniform float envRoughness;
+
+float reflectRefractRatio = 0.8;
+float lightingResistance = 0.6;
+
+vec3 shadeFace(vec3 norm, vec3 position)
+{
+	vec3 ambient = light.ambient * material.ambient;
+	vec3 lightDir = normalize(light.position - position);
+	vec3 diffuse = light.diffuse * (max(dot(norm, lightDir), 0.0) * material.diffuse);
+	vec3 viewDir = normalize(cameraPos - position);
+	float spec = pow(max(dot(viewDir, reflect(-lightDir, norm)), 0.0), material.shininess);
+	vec3 result = ambient + diffuse + light.specular * (spec * material.specular);
+
+	float ratio = 1.00 / 1.58;
+	vec3 I = -viewDir;
+	float viewDistance = length(cameraPos - position);
+	float envLod = min(max(log2(max(viewDistance * envLodScale, 1.0)), envRoughness * envMaxLod), envMaxLod);
+	vec3 processResult = mix(
+							textureLod(skybox, refract(I, norm, ratio), envLod).rgb,
+							textureLod(skybox, reflect(I, norm), envLod).rgb,
+							reflectRefractRatio
+						);
+	return mix(result, objectColor * processResult, lightingResistance);
+}
+#endif
 
 void main()
 {
     Normal = mat3(transpose(inverse(model))) * aNormal;
     Position = vec3(model * vec4(aPos, 1.0));
     gl_Position = projection * view * model * vec4(aPos, 1.0);
+#ifdef SHADE_FACE
+    FaceColor = shadeFace(normalize(Normal), Position);
+#endif
+#ifdef STEREO
+    Eye = EYE;
+#ifdef STEREO_VIEWPORT
+    gl_ViewportIndex = EYE;
+#else
+    // one viewport spans both eyes: squeeze into this eye's half and clip at the middle
+    gl_Position.x = gl_Position.x * 0.5 + (EYE == 0 ? -0.5 : 0.5) * gl_Position.w;
+    gl_ClipDistance[0] = EYE == 0 ? -gl_Position.x : gl_Position.x;
+#endif
+#endif
 }
-
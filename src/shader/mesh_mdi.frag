@@ -0,0 +1,17 @@
+#version 460 core
+out vec4 FragColor;
+
+in vec3 Normal;
+in vec3 Position;
+in vec2 TexCoords;
+flat in uint Material;
+
+// one entry per material of the current batch; Material is the same for a whole draw,
+// so indexing the arrays with it is allowed
+uniform sampler2D texture_diffuse[8];
+uniform sampler2D texture_specular[8];
+
+void main()
+{
+    FragColor = texture(texture_diffuse[Material], TexCoords);
+}
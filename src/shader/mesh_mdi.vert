@@ -0,0 +1,34 @@
+#version 460 core
+// Vertex shader for meshes drawn through a GeometryPool: the model matrix and material of each
+// draw come from the pool's storage buffer, indexed by gl_DrawID.
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+struct DrawData {
+    mat4 model;
+    uint material;
+};
+
+layout (std430, binding = 0) readonly buffer Draws {
+    DrawData draws[];
+};
+
+out vec3 Normal;
+out vec3 Position;
+out vec2 TexCoords;
+flat out uint Material;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform int drawOffset; // first draw of the current multi-draw call
+
+void main()
+{
+    DrawData draw = draws[drawOffset + gl_DrawID];
+    Normal = mat3(transpose(inverse(draw.model))) * aNormal;
+    Position = vec3(draw.model * vec4(aPos, 1.0));
+    TexCoords = aTexCoords;
+    Material = draw.material;
+    gl_Position = projection * view * vec4(Position, 1.0);
+}
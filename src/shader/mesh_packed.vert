@@ -0,0 +1,42 @@
+#version 460 core
+// Vertex shader for Meshes created with VERTEX_PACKED (see PackedVertex in mesh.h).
+// Outputs the same Normal/Position as gem.vert, plus texture coordinates and the tangent frame.
+layout (location = 0) in vec3 aPos;       // unorm16, within the mesh bounds
+layout (location = 1) in vec2 aNormal;    // octahedral, snorm16
+layout (location = 2) in vec2 aTexCoords; // half float
+layout (location = 3) in vec4 aTangent;   // 2_10_10_10: xyz tangent, w bitangent sign
+
+out vec3 Normal;
+out vec3 Position;
+out vec2 TexCoords;
+out mat3 TBN;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 positionOffset;
+uniform vec3 positionScale;
+
+vec3 octDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main()
+{
+    vec3 pos = positionOffset + aPos * positionScale;
+    mat3 normalMatrix = mat3(transpose(inverse(model)));
+    vec3 N = normalize(normalMatrix * octDecode(aNormal));
+    vec3 T = normalize(mat3(model) * aTangent.xyz);
+    vec3 B = cross(N, T) * aTangent.w;
+
+    Normal = N;
+    Position = vec3(model * vec4(pos, 1.0));
+    TexCoords = aTexCoords;
+    TBN = mat3(T, B, N);
+    gl_Position = projection * view * model * vec4(pos, 1.0);
+}
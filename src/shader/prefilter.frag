@@ -0,0 +1,86 @@
+#version 460 core
+out vec4 FragColor;
+
+uniform samplerCube environment;
+uniform int face;           // 0..5 in cubemap order (+X, -X, +Y, -Y, +Z, -Z)
+uniform float roughness;
+uniform float faceSize;     // of the level being written
+uniform float sourceSize;   // of environment's level 0
+
+const float PI = 3.14159265359;
+const uint SAMPLE_COUNT = 64u;
+
+// direction through a texel of a cubemap face, following the GL face orientation table
+vec3 faceDirection(int f, vec2 uv)
+{
+    if (f == 0) return vec3( 1.0, -uv.y, -uv.x);
+    if (f == 1) return vec3(-1.0, -uv.y,  uv.x);
+    if (f == 2) return vec3( uv.x,  1.0,  uv.y);
+    if (f == 3) return vec3( uv.x, -1.0, -uv.y);
+    if (f == 4) return vec3( uv.x, -uv.y,  1.0);
+    return vec3(-uv.x, -uv.y, -1.0);
+}
+
+float radicalInverse(uint bits)
+{
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return float(bits) * 2.3283064365386963e-10;
+}
+
+// GGX-distributed half vector around N
+vec3 importanceSampleGGX(vec2 xi, vec3 N, float a)
+{
+    float phi = 2.0 * PI * xi.x;
+    float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (a * a - 1.0) * xi.y));
+    float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    vec3 H = vec3(cos(phi) * sinTheta, sin(phi) * sinTheta, cosTheta);
+
+    vec3 up = abs(N.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    vec3 tangent = normalize(cross(up, N));
+    vec3 bitangent = cross(N, tangent);
+    return normalize(tangent * H.x + bitangent * H.y + N * H.z);
+}
+
+void main()
+{
+    vec2 uv = gl_FragCoord.xy / faceSize * 2.0 - 1.0;
+    vec3 N = normalize(faceDirection(face, uv));
+
+    if (roughness == 0.0)
+    {
+        FragColor = vec4(textureLod(environment, N, 0.0).rgb, 1.0);
+        return;
+    }
+
+    // split sum approximation: view = normal = reflection direction
+    float a = roughness * roughness;
+    float texelSolidAngle = 4.0 * PI / (6.0 * sourceSize * sourceSize);
+    vec3 color = vec3(0.0);
+    float weight = 0.0;
+    for (uint i = 0u; i < SAMPLE_COUNT; i++)
+    {
+        vec2 xi = vec2(float(i) / float(SAMPLE_COUNT), radicalInverse(i));
+        vec3 H = importanceSampleGGX(xi, N, a);
+        vec3 L = normalize(2.0 * dot(N, H) * H - N);
+        float NdotL = dot(N, L);
+        if (NdotL <= 0.0)
+            continue;
+
+        // read from the mip whose texels cover about the solid angle this sample stands for,
+        // so 64 samples integrate the lobe without sparkling
+        float NdotH = max(dot(N, H), 0.0);
+        float d = (NdotH * NdotH * (a * a - 1.0) + 1.0);
+        float D = a * a / (PI * d * d);
+        float pdf = D * 0.25; // D * NdotH / (4 * HdotV) with N = V
+        float sampleSolidAngle = 1.0 / (float(SAMPLE_COUNT) * pdf + 0.0001);
+        float lod = 0.5 * log2(sampleSolidAngle / texelSolidAngle) + 1.0;
+
+        color += textureLod(environment, L, max(lod, 0.0)).rgb * NdotL;
+        weight += NdotL;
+    }
+    FragColor = vec4(color / weight, 1.0);
+}
@@ -1,16 +1,39 @@
 #version 460 core
+#ifdef STEREO
+#ifdef STEREO_VIEWPORT
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+// both eyes from one draw: even instances are the left eye, odd ones the right (stereo.h)
+layout (std140, binding = 0) uniform StereoViews {
+	mat4 eyeView[2];
+	mat4 eyeProjection[2];
+	vec4 eyePosition[2];
+};
+#define EYE (gl_InstanceID & 1)
+#define view mat4(mat3(eyeView[EYE])) // rotation only, as for the mono skybox
+#define projection eyeProjection[EYE]
+#else
+uniform mat4 view;
+uniform mat4 projection;
+#endif
 layout (location = 0) in vec3 aPos;
 
 out vec3 TexCoords;
 
-uniform mat4 projection;
-uniform mat4 view;
-
 void main()
 {
     TexCoords = aPos;
     vec4 pos = projection * view * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
+#ifdef STEREO
+#ifdef STEREO_VIEWPORT
+    gl_ViewportIndex = EYE;
+#else
+    // one viewport spans both eyes: squeeze into this eye's half and clip at the middle
+    gl_Position.x = gl_Position.x * 0.5 + (EYE == 0 ? -0.5 : 0.5) * gl_Position.w;
+    gl_ClipDistance[0] = EYE == 0 ? -gl_Position.x : gl_Position.x;
+#endif
+#endif
 }  
 
 
@@ -8,14 +8,32 @@
 #include "shader_m.h"
 #include "camera.h"
 #include "model.h"
+#include "render_queue.h"
 #include "filesystem.h"
-
+#include "gem_scene.h"
+#include "ray_tracer.h"
+#include "env_prefilter.h"
+#include "texture_compress.h"
+#include "dynamic_resolution.h"
+#include "post_aa.h"
+#include "stereo.h"
+#include "reflection_probe.h"
+#include "frame_pacer.h"
+#include "input_recorder.h"
+#include "scene_stream.h"
+#include "spatial_grid.h"
+
+#include <cstdio>
+#include <iomanip>
 #include <iostream>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void window_refresh_callback(GLFWwindow* window);
 void processInput(GLFWwindow* window);
+void processMovement(GLFWwindow* window);
 unsigned int loadTexture(const char* path);
 unsigned int loadCubemap(vector<std::string> faces);
 
@@ -27,7 +45,12 @@ const unsigned int SCR_HEIGHT = 1152;//1440;
 Camera camera(glm::vec3(0.0f, 1.0f, 6.0f));
 float lastX = (float)SCR_WIDTH / 2.0;
 float lastY = (float)SCR_HEIGHT / 2.0;
+// framebuffer size in pixels; follows resizes, and differs from the window size on retina displays
+int fbWidth = SCR_WIDTH;
+int fbHeight = SCR_HEIGHT;
 bool firstMouse = true;
+const float nearPlane = 0.1f;
+const float farPlane = 100.0f;
 
 // timing
 float deltaTime = 0.0f;
@@ -51,70 +74,130 @@ bool lButtonLock = false;
 float lineWidth = 10.0f;
 float lineWidthMaxDistance = 10.0f;
 
-//lighting
-//glm::vec3 lightPos(1.2f, 0.2f, 2.0f);
-glm::vec3 lightPos(-7.5f, 2.0f, -10.0f);
-
-
-// diamond dimensions (each from origin)
-const float innerRadius = 0.5f;
-const float outerRadius = 0.7f;
-const float outerHeight = 0.35f;
-const float innerHeight = 0.5f;
-const float pointHeight = -0.5f;
-
-const float sqrt3 = sqrt(3);
-const glm::vec2 innerCorner = glm::vec2(innerRadius / 2, sqrt3 * innerRadius / 2);
-const glm::vec2 outerCorner = glm::vec2(outerRadius / 2, sqrt3 * outerRadius / 2);
-
-// assists with calculation of midpoints
-const glm::vec2 midCorner = glm::vec2((outerCorner.x + outerRadius) / 2, outerCorner.y / 2);
-
-// Normals
-const glm::vec3 midNormal = glm::normalize(glm::vec3(sqrt3 * 21.0f / 400.0f, sqrt3 * 7.0f / 100.0f, 21.0f / 400.0f));
-const glm::vec3 midCenterNormal = glm::normalize(glm::vec3(0.0f, sqrt3 / 20.0f, 0.075f));
-const glm::vec3 bottomNormal = glm::normalize(glm::vec3(sqrt3 * 119.0f / 400.0f, sqrt3 * -49.0f / 200.0f, 119.0f / 400.0f));
-const glm::vec3 bottomCenterNormal = glm::normalize(glm::vec3(0.0f, sqrt3 * -0.245f, 0.595f));
-
-// for calculating gem locations
-const float PI = 3.1415926f;
-const float gemDist = 2.5f;
-
-// gem colors,locations
-map<int, glm::vec3> gemLocs = {
-    {0, glm::vec3(0.0f, 0.0f, gemDist)},
-    {1, glm::vec3(gemDist *  sin(2 * PI / 7), 0.0f, gemDist * cos(2 * PI / 7))},
-    {2, glm::vec3(gemDist *  sin(4 * PI / 7), 0.0f, gemDist * cos(4 * PI / 7))},
-    {3, glm::vec3(gemDist *  sin(6 * PI / 7), 0.0f, gemDist * cos(6 * PI / 7))},
-    {4, glm::vec3(gemDist * -sin(6 * PI / 7), 0.0f, gemDist * cos(6 * PI / 7))},
-    {5, glm::vec3(gemDist * -sin(4 * PI / 7), 0.0f, gemDist * cos(4 * PI / 7))},
-    {6, glm::vec3(gemDist * -sin(2 * PI / 7), 0.0f, gemDist * cos(2 * PI / 7))},
-};
-
-const float colorMult = 2.1f;
-
-glm::vec3 colors[7] = {
-    glm::vec3(1.0f, 0.0f, 0.0f),
-    glm::vec3(1.0f, 1.0f, 0.0f),
-    glm::vec3(0.0f, 1.0f, 0.0f),
-    glm::vec3(0.0f, 1.0f, 1.0f),
-    glm::vec3(0.0f, 0.0f, 1.0f),
-    glm::vec3(1.0f, 0.0f, 1.0f),
-    glm::vec3(1.0f, 1.0f, 1.0f),
-};
-
-int main()
+// gems reflect the GGX prefiltered environment rather than the plain mip chain
+bool prefilter_enabled = true;
+bool gButtonLock = false;
+
+// dynamic resolution: the scene is rendered at a scale that holds a GPU time target
+bool dynres_enabled = false;
+bool fButtonLock = false;
+
+// per-gem shading tiers by screen size
+bool shading_lod_enabled = true;
+bool kButtonLock = false;
+
+// post-process anti-aliasing preset, cycled with X
+AA_Preset aaPreset = AA_OFF;
+bool xButtonLock = false;
+
+// side-by-side stereo, both eyes drawn in one instanced pass
+bool stereo_enabled = false;
+bool vButtonLock = false;
+
+// gems reflect a dynamic probe of the scene instead of only the skybox
+bool probe_enabled = true;
+bool bButtonLock = false;
+
+// low-latency mode: raw mouse motion, input read just before the view is built, a frame limiter
+// and no frames queued ahead; the title bar shows the measured input to present latency
+bool low_latency_enabled = false;
+bool nButtonLock = false;
+// swap mode cycled with M; activeSwapMode is what the driver supports of it
+Swap_Mode swapMode = SWAP_VSYNC;
+Swap_Mode activeSwapMode = SWAP_VSYNC;
+bool mButtonLock = false;
+
+// idle mode: once nothing has changed for a few frames the loop stops drawing and sleeps until
+// input arrives; the window keeps showing the last frame
+bool idle_enabled = true;
+bool iButtonLock = false;
+bool inputActivity = true; // set by the input and window callbacks, cleared once per frame
+
+// CPU ray traced view
+bool trace_enabled = false;
+bool tButtonLock = false;
+const int traceDownscale = 4; // trace at a quarter of the framebuffer size, then upscale
+
+// gem locations; revolve mode 3 updates their heights in place
+map<int, glm::vec3> gemLocs = makeGemLocations();
+
+// every key, cursor and scroll event goes through here, so a session can be recorded and replayed
+InputRecorder inputRecorder;
+
+int main(int argc, char** argv)
 {
+    // command line, for reproducible performance runs:
+    //   --record <log>        log input and timesteps
+    //   --replay <log>        replay a log instead of live input, then print frame time statistics
+    //   --fixed-dt <seconds>  step the animation by a fixed amount every frame
+    //   --headless            hidden window and no vsync; needs --replay
+    //   --scene <file>        stream a gem field from a scene file instead of the ring
+    //   --write-field <file> <gems per side>  write a square gem field and exit
+    string recordPath, replayPath, scenePath;
+    bool headless = false;
+    for (int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc)
+            recordPath = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            replayPath = argv[++i];
+        else if (arg == "--fixed-dt" && i + 1 < argc)
+            inputRecorder.FixedDt = (float)atof(argv[++i]);
+        else if (arg == "--headless")
+            headless = true;
+        else if (arg == "--scene" && i + 1 < argc)
+            scenePath = argv[++i];
+        else if (arg == "--write-field" && i + 2 < argc)
+        {
+            string fieldPath = argv[++i];
+            unsigned int gemsPerSide = (unsigned int)atoi(argv[++i]);
+            if (!WriteGemField(fieldPath, gemsPerSide, fieldSpacing, fieldChunkSize, colors))
+            {
+                std::cout << "Failed to write gem field: " << fieldPath << std::endl;
+                return -1;
+            }
+            return 0;
+        }
+        else
+        {
+            std::cout << "Usage: " << argv[0] << " [--record <log> | --replay <log> [--headless]] [--fixed-dt <seconds>]"
+                      << " [--scene <file>] [--write-field <file> <gems per side>]" << std::endl;
+            return -1;
+        }
+    }
+    if ((headless && replayPath.empty()) || (!recordPath.empty() && !replayPath.empty()))
+    {
+        std::cout << "--headless needs --replay, and --record can't be combined with it" << std::endl;
+        return -1;
+    }
+
     // glfw: initialize and configure
     // ------------------------------
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    if (headless)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    if (!recordPath.empty() && !inputRecorder.Record(recordPath))
+    {
+        std::cout << "Failed to open input log for writing: " << recordPath << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    if (!replayPath.empty() && !inputRecorder.Replay(replayPath))
+    {
+        std::cout << "Failed to read input log: " << replayPath << std::endl;
+        glfwTerminate();
+        return -1;
+    }
 
     // glfw window creation
     // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "IT356 Final Project (Derek Jennings)", NULL, NULL);
+    const char* windowTitle = "IT356 Final Project (Derek Jennings)";
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, windowTitle, NULL, NULL);
     if (window == NULL)
     {
         std::cout << "Failed to create GLFW window" << std::endl;
@@ -123,8 +206,17 @@ int main()
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
+    glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+    // a replay feeds the callbacks from the log instead
+    if (inputRecorder.Replaying())
+        inputRecorder.SetCallbacks(mouse_callback, scroll_callback);
+    else
+    {
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+    }
 
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -137,735 +229,608 @@ int main()
         return -1;
     }
 
-    // configure global opengl state
-    // -----------------------------
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    // build and compile shaders
-    // -------------------------
-    Shader shader("../../src/shader/gem.vert", "../../src/shader/gem.frag");
-    Shader skyboxShader("../../src/shader/skybox.vert", "../../src/shader/skybox.frag");
-    Shader wireShader("../../src/shader/gem.vert", "../../src/shader/basic.frag");
-
-    // set up vertex data (and buffer(s)) and configure vertex attributes
-    // ------------------------------------------------------------------
-    //float cubeVertices[] = {
-    //    // positions          // normals
-    //    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-    //     0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-    //     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-    //     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-    //    -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-    //    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
-    //
-    //    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
-    //     0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
-    //     0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
-    //     0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
-    //    -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
-    //    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
-    //
-    //    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-    //    -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-    //    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-    //    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
-    //    -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-    //    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
-    //
-    //     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-    //     0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-    //     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-    //     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
-    //     0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-    //     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
-    //
-    //    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-    //     0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-    //     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-    //     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-    //    -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
-    //    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
-    //
-    //    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-    //     0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
-    //     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-    //     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-    //    -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
-    //    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
-    //};
-
-    /// 6-sided gem
-    /// "right" = +x, "up" = +y, "front" = +z
-    float gemVertices[] = {
-        //positions
-            //normals
-
-        //-innerRadius / 2, innerHeight, -sqrt3 * innerRadius / 2,  // left top back
-        //-innerRadius / 2, innerHeight,  sqrt3* innerRadius / 2,  // left top front
-        // innerRadius / 2, innerHeight, -sqrt3 * innerRadius / 2,  // right top back
-        // innerRadius / 2, innerHeight,  sqrt3* innerRadius / 2,  // right top front
-
-        //-outerRadius / 2, outerHeight, -sqrt3 * outerRadius / 2,  // left top back
-        //-outerRadius / 2, outerHeight,  sqrt3* outerRadius / 2,  // left top front
-        // outerRadius / 2, outerHeight, -sqrt3 * outerRadius / 2,  // right top back
-        // outerRadius / 2, outerHeight,  sqrt3* outerRadius / 2,  // right top front
-
-        //////////////////////////// LIST OF VERTICES /////////////////////////////////
-        
-        ///// top (hexagon)
-        //-innerRadius, innerHeight, 0.0f,  // left top center (inner)
-        //-innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-        //-innerCorner.x, innerHeight,  innerCorner.y,  // left top front
-        // innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-        // innerCorner.x, innerHeight,  innerCorner.y,  // right top front
-        // innerRadius, innerHeight, 0.0f,  // right top center
-
-        ///// Sides
-        //-outerRadius, outerHeight, 0.0f,  // left side center
-        //-outerCorner.x, outerHeight, -outerCorner.y,  // left side back
-        //-outerCorner.x, outerHeight,  outerCorner.y,  // left side front
-        // outerCorner.x, outerHeight, -outerCorner.y,  // right side back
-        // outerCorner.x, outerHeight,  outerCorner.y,  // right side front
-        // outerRadius, outerHeight, 0.0f,  // right side center
-
-        ///// Bottom point
-        //0.0f, pointHeight, 0.0f,  // bottom center point
-
-        ///// Midpoints; used for setting up the inner triangles of a face
-        //-midCorner.x, outerHeight, -midCorner.y,  // leftish side backish
-        // 0.0f, outerHeight, -outerCorner.y,  // center side back
-        // midCorner.x, outerHeight, -midCorner.y,  // rightish side backish
-        // midCorner.x, outerHeight,  midCorner.y,  // rightish side frontish
-        // 0.0f, outerHeight, outerCorner.y,  // center side front
-        //-midCorner.x, outerHeight,  midCorner.y,  // leftish side frontish
-
-        ///////////////////////////////////////////////////////////////////////////////
-
-        /// Face: top (hexagon)
-        // Tri: left
-        -innerRadius, innerHeight, 0.0f,  // left top center
-            0.0f, 1.0f, 0.0f,  // normal pointing up
-        -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-            0.0f, 1.0f, 0.0f,
-        -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
-            0.0f, 1.0f, 0.0f,
-        // Tri: left center back
-        -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
-            0.0f, 1.0f, 0.0f,
-        -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-            0.0f, 1.0f, 0.0f,
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-            0.0f, 1.0f, 0.0f,
-        // Tri: right center front
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-            0.0f, 1.0f, 0.0f,
-        -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
-            0.0f, 1.0f, 0.0f,
-         innerCorner.x, innerHeight,  innerCorner.y,  // right top front
-            0.0f, 1.0f, 0.0f,
-        // Tri: right
-         innerCorner.x, innerHeight,  innerCorner.y,  // right top front
-            0.0f, 1.0f, 0.0f,
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-            0.0f, 1.0f, 0.0f,
-         innerRadius, innerHeight, 0.0f,  // right top center
-            0.0f, 1.0f, 0.0f,
-
-        /// Face: left upper side back
-        // Tri: leftest lower backish
-        -innerRadius, innerHeight, 0.0f,  // left top center
-            //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
-            -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
-        -outerRadius, outerHeight, 0.0f,  // left side center
-            //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
-            -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
-        -midCorner.x, outerHeight, -midCorner.y,  // leftish side backish
-            //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
-            -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
-        // Tri: lefter upper backisher
-        -midCorner.x, outerHeight, -midCorner.y,  // leftish side backish
-            //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
-            -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
-        -innerRadius, innerHeight, 0.0f,  // left top center
-            //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
-            -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
-        -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-            //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
-            -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
-        // Tri: leftish lower backerest
-        -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-            //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
-            -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
-        -midCorner.x, outerHeight, -midCorner.y,  // leftish side backish
-            //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
-            -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
-        -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
-            //-0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL left upper back
-            -midNormal.x, midNormal.y, -midNormal.z,  // left upper back
-        
-        /// Face: center upper side back
-        // Tri: left lower back
-        -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
-            //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
-            0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
-        -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-            //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
-            0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
-         0.0f, outerHeight, -outerCorner.y,  // center side back
-            //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
-            0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
-        // Tri: center upper back
-         0.0f, outerHeight, -outerCorner.y,  // center side back
-            //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
-            0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
-        -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-            //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
-            0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-            //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
-            0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
-        // Tri: right lower back
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-            //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
-            0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
-         0.0f, outerHeight, -outerCorner.y,  // center side back
-            //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
-            0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
-         outerCorner.x, outerHeight, -outerCorner.y,  // right side back
-            //0.0f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL center upper back
-            0.0f, midCenterNormal.y, -midCenterNormal.z,  // center upper back
-        
-        /// Face: right upper side back
-        // Tri: rightish lower backerest
-         outerCorner.x, outerHeight, -outerCorner.y,  // right side back
-            //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
-            midNormal.x, midNormal.y, -midNormal.z,  // right upper back
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-            //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
-            midNormal.x, midNormal.y, -midNormal.z,  // right upper back
-         midCorner.x, outerHeight, -midCorner.y,  // rightish side backish
-            //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
-            midNormal.x, midNormal.y, -midNormal.z,  // right upper back
-        // Tri: right upper backer
-         midCorner.x, outerHeight, -midCorner.y,  // rightish side backish
-            //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
-            midNormal.x, midNormal.y, -midNormal.z,  // right upper back
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-            //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
-            midNormal.x, midNormal.y, -midNormal.z,  // right upper back
-         innerRadius, innerHeight, 0.0f,  // right top center
-            //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
-            midNormal.x, midNormal.y, -midNormal.z,  // right upper back
-        // Tri: rightest lower backish
-         innerRadius, innerHeight, 0.0f,  // right top center
-            //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
-            midNormal.x, midNormal.y, -midNormal.z,  // right upper back
-         midCorner.x, outerHeight, -midCorner.y,  // rightish side backish
-            //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
-             midNormal.x, midNormal.y, -midNormal.z,  // right upper back
-         outerRadius, outerHeight, 0.0f,  // right side center
-            //0.707f, 0.707f, -0.707f,  // PLACEHOLDER NORMAL right upper back
-             midNormal.x, midNormal.y, -midNormal.z,  // right upper back
-        
-        /// Face: right upper side front
-        // Tri: rightest lower frontish
-         outerRadius, outerHeight, 0.0f,  // right side center
-            //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
-            midNormal.x, midNormal.y, midNormal.z,  // right upper front
-         innerRadius, innerHeight, 0.0f,  // right top center
-            //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
-            midNormal.x, midNormal.y, midNormal.z,  // right upper front
-         midCorner.x, outerHeight, midCorner.y,  // rightish side frontish
-            //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
-            midNormal.x, midNormal.y, midNormal.z,  // right upper front
-        // Tri: righter upper fronter
-         midCorner.x, outerHeight, midCorner.y,  // rightish side frontish
-            //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
-            midNormal.x, midNormal.y, midNormal.z,  // right upper front
-         innerRadius, innerHeight, 0.0f,  // right top center
-            //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
-            midNormal.x, midNormal.y, midNormal.z,  // right upper front
-         innerCorner.x, innerHeight, innerCorner.y,  // right top front
-            //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
-            midNormal.x, midNormal.y, midNormal.z,  // right upper front
-        // Tri: rightish lower fronterest
-         innerCorner.x, innerHeight, innerCorner.y,  // right top front
-            //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
-            midNormal.x, midNormal.y, midNormal.z,  // right upper front
-         midCorner.x, outerHeight, midCorner.y,  // rightish side frontish
-            //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
-            midNormal.x, midNormal.y, midNormal.z,  // right upper front
-         outerCorner.x, outerHeight, outerCorner.y,  // right side front
-            //0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL right upper front
-            midNormal.x, midNormal.y, midNormal.z,  // right upper front
-        
-        /// Face: center upper side front
-        // Tri: rightish lower side front
-         outerCorner.x, outerHeight, outerCorner.y,  // right side front
-            //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
-            0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
-         innerCorner.x, innerHeight, innerCorner.y,  // right top front
-            //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
-            0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
-         0.0f, outerHeight, outerCorner.y,  // center side front
-             //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
-            0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
-        // Tri: center upper side front
-         0.0f, outerHeight, outerCorner.y,  // center side front
-            //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
-            0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
-         innerCorner.x, innerHeight, innerCorner.y,  // right top front
-            //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
-             0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
-         -innerCorner.x, innerHeight, innerCorner.y,  // left top front
-             //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
-            0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
-        // Tri: leftish lower side front
-         -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
-            //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
-            0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
-         0.0f, outerHeight, outerCorner.y,  // center side front
-            //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
-            0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
-         -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
-            //0.0f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL center upper front
-            0.0f, midCenterNormal.y, midCenterNormal.z,  // center upper front
-        
-        /// Face: left upper side front
-        // Tri: leftish lower side fronterest
-         -outerCorner.x, outerHeight, outerCorner.y,  // left side front
-            //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
-            -midNormal.x, midNormal.y, midNormal.z,  // left upper front
-         -innerCorner.x, innerHeight, innerCorner.y,  // left top front
-            //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
-            -midNormal.x, midNormal.y, midNormal.z,  // left upper front
-         -midCorner.x, outerHeight, midCorner.y,  // leftish side frontish
-            //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
-            -midNormal.x, midNormal.y, midNormal.z,  // left upper front
-        // Tri: lefter upper side fronter
-         -midCorner.x, outerHeight, midCorner.y,  // leftish side frontish
-            //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
-            -midNormal.x, midNormal.y, midNormal.z,  // left upper front
-         -innerCorner.x, innerHeight, innerCorner.y,  // left top front
-            //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
-            -midNormal.x, midNormal.y, midNormal.z,  // left upper front
-         -innerRadius, innerHeight, 0.0f,  // left top center (inner)
-            //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
-            -midNormal.x, midNormal.y, midNormal.z,  // left upper front
-        // Tri: leftest lower side frontish
-         -innerRadius, innerHeight, 0.0f,  // left top center (inner)
-            //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
-            -midNormal.x, midNormal.y, midNormal.z,  // left upper front
-         -midCorner.x, outerHeight, midCorner.y,  // leftish side frontish
-            //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
-            -midNormal.x, midNormal.y, midNormal.z,  // left upper front
-         -outerRadius, outerHeight, 0.0f,  // left side center
-            //-0.707f, 0.707f, 0.707f,  // PLACEHOLDER NORMAL left upper front
-            -midNormal.x, midNormal.y, midNormal.z,  // left upper front
-
-        /// Faces: lower sides
-        // Face: left lower back
-        -outerRadius, outerHeight, 0.0f,  // left side center
-            //-0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL left lower back
-            -bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // left lower back
-        -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
-            //-0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL left lower back
-            -bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // left lower back
-        0.0f, pointHeight, 0.0f,  // bottom center point
-            //-0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL left lower back
-            -bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // left lower back
-        // Face: center lower back
-        -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
-            //0.0f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL center lower back
-            0.0f, bottomCenterNormal.y, -bottomCenterNormal.z,  // center lower back
-         outerCorner.x, outerHeight, -outerCorner.y,  // right side back
-            //0.0f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL center lower back
-            0.0f, bottomCenterNormal.y, -bottomCenterNormal.z,  // center lower back
-        0.0f, pointHeight, 0.0f,  // bottom center point
-            //0.0f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL center lower back
-            0.0f, bottomCenterNormal.y, -bottomCenterNormal.z,  // center lower back
-        // Face: right lower back
-         outerCorner.x, outerHeight, -outerCorner.y,  // right side back
-             //0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL right lower back
-            bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // right lower back
-         outerRadius, outerHeight, 0.0f,  // right side center
-             //0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL right lower back
-            bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // right lower back
-         0.0f, pointHeight, 0.0f,  // bottom center point
-             //0.707f, -0.707f, -0.707f,  // PLACEHOLDER NORMAL right lower back
-            bottomNormal.x, bottomNormal.y, -bottomNormal.z,  // right lower back
-        // Face: right lower front
-         outerRadius, outerHeight, 0.0f,  // right side center
-             //0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL right lower front
-            bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
-         outerCorner.x, outerHeight,  outerCorner.y,  // right side front
-             //0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL right lower front
-            bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
-         0.0f, pointHeight, 0.0f,  // bottom center point
-             //0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL right lower front
-            bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
-        // Face: center lower front
-         outerCorner.x, outerHeight,  outerCorner.y,  // right side front
-            //0.0f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL center lower front
-            0.0f, bottomCenterNormal.y, bottomCenterNormal.z,  // right lower front
-        -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
-            //0.0f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL center lower front
-            0.0f, bottomCenterNormal.y, bottomCenterNormal.z,  // right lower front
-         0.0f, pointHeight, 0.0f,  // bottom center point
-            //0.0f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL center lower front
-            0.0f, bottomCenterNormal.y, bottomCenterNormal.z,  // right lower front
-        // Face: left lower front
-        -outerCorner.x, outerHeight, outerCorner.y,  // left side front
-             //-0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL left lower front
-            -bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
-        -outerRadius, outerHeight, 0.0f,  // left side center
-             //-0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL left lower front
-            -bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
-        0.0f, pointHeight, 0.0f,  // bottom center point
-             //-0.707f, -0.707f, 0.707f,  // PLACEHOLDER NORMAL left lower front
-            -bottomNormal.x, bottomNormal.y, bottomNormal.z,  // right lower front
-
-    };
-    float gemEdges[] = {
-        /// top (hexagon)
-        // Edge: left back
-        -innerRadius, innerHeight, 0.0f,  // left top center
-        -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-        // Edge: back
-        -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-        // Edge: right back
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-         innerRadius, innerHeight, 0.0f,  // right top center
-        // Edge: right front
-         innerRadius, innerHeight, 0.0f,  // right top center
-         innerCorner.x, innerHeight,  innerCorner.y,  // right top front
-        // Edge: front
-         innerCorner.x, innerHeight,  innerCorner.y,  // right top front
-        -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
-        // Edge: left front
-        -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
-        -innerRadius, innerHeight, 0.0f,  // left top center
-
-        /// upper sides (verticals)
-        // Edge: left center
-        -innerRadius, innerHeight, 0.0f,  // left top center
-        -outerRadius, outerHeight, 0.0f,  // left side center
-        // Edge: left back
-        -innerCorner.x, innerHeight, -innerCorner.y,  // left top back
-        -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
-        // Edge: right back
-         innerCorner.x, innerHeight, -innerCorner.y,  // right top back
-         outerCorner.x, outerHeight, -outerCorner.y,  // right side back
-        // Edge: right center
-         innerRadius, innerHeight, 0.0f,  // right top center
-         outerRadius, outerHeight, 0.0f,  // right side center
-        // Edge: right front
-         innerCorner.x, innerHeight,  innerCorner.y,  // right top front
-         outerCorner.x, outerHeight,  outerCorner.y,  // right side front
-        // Edge: left front
-        -innerCorner.x, innerHeight,  innerCorner.y,  // left top front
-        -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
-
-        /// sides (horizontals)
-        // Edge: left side back
-        -outerRadius, outerHeight, 0.0f,  // left side center
-        -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
-        // Edge: center side back
-        -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
-         outerCorner.x, outerHeight, -outerCorner.y,  // right side back
-        // Edge: right side back
-         outerCorner.x, outerHeight, -outerCorner.y,  // right side back
-         outerRadius, outerHeight, 0.0f,  // right side center
-        // Edge: right side front
-         outerRadius, outerHeight, 0.0f,  // right side center
-         outerCorner.x, outerHeight,  outerCorner.y,  // right side front
-        // Edge: center side front
-         outerCorner.x, outerHeight,  outerCorner.y,  // right side front
-        -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
-        // Edge: left side front
-        -outerCorner.x, outerHeight,  outerCorner.y,  // left side front
-        -outerRadius, outerHeight, 0.0f,  // left side center
-
-        /// lower sides
-        // Edge: left lower center
-        -outerRadius, outerHeight, 0.0f,  // left side center
-         0.0f, pointHeight, 0.0f,  // bottom center point
-        // Edge: left lower back
-         0.0f, pointHeight, 0.0f,  // bottom center point
-        -outerCorner.x, outerHeight, -outerCorner.y,  // left side back
-        // Edge: right lower back
-         outerCorner.x, outerHeight, -outerCorner.y,  // right side back
-         0.0f, pointHeight, 0.0f,  // bottom center point
-        // Edge: right lower center
-         0.0f, pointHeight, 0.0f,  // bottom center point
-         outerRadius, outerHeight, 0.0f,  // right side center
-        // Edge: right lower front
-         outerCorner.x, outerHeight,  outerCorner.y,  // right side front
-         0.0f, pointHeight, 0.0f,  // bottom center point
-        // Edge: left lower front
-         0.0f, pointHeight, 0.0f,  // bottom center point
-        -outerCorner.x, outerHeight, outerCorner.y,  // left side front
-    };
-
-    float skyboxVertices[] = {
-        // positions          
-        -1.0f,  1.0f, -1.0f,
-        -1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-
-        -1.0f, -1.0f,  1.0f,
-        -1.0f, -1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f, -1.0f,
-        -1.0f,  1.0f,  1.0f,
-        -1.0f, -1.0f,  1.0f,
-
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-
-        -1.0f, -1.0f,  1.0f,
-        -1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f, -1.0f,  1.0f,
-        -1.0f, -1.0f,  1.0f,
-
-        -1.0f,  1.0f, -1.0f,
-         1.0f,  1.0f, -1.0f,
-         1.0f,  1.0f,  1.0f,
-         1.0f,  1.0f,  1.0f,
-        -1.0f,  1.0f,  1.0f,
-        -1.0f,  1.0f, -1.0f,
-
-        -1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f,  1.0f,
-         1.0f, -1.0f, -1.0f,
-         1.0f, -1.0f, -1.0f,
-        -1.0f, -1.0f,  1.0f,
-         1.0f, -1.0f,  1.0f
-    };
-
-    // gem VAO
-    unsigned int gemVAO, gemVBO;
-    glGenVertexArrays(1, &gemVAO);
-    glGenBuffers(1, &gemVBO);
-    glBindVertexArray(gemVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, gemVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(gemVertices), &gemVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
-    // gem edges VAO
-    unsigned int edgeVAO, edgeVBO;
-    glGenVertexArrays(1, &edgeVAO);
-    glGenBuffers(1, &edgeVBO);
-    glBindVertexArray(edgeVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, edgeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(gemEdges), &gemEdges, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    // skybox VAO
-    unsigned int skyboxVAO, skyboxVBO;
-    glGenVertexArrays(1, &skyboxVAO);
-    glGenBuffers(1, &skyboxVBO);
-    glBindVertexArray(skyboxVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-
-    // load textures
-    // -------------
-    vector<std::string> faces
+    // everything that owns GL objects lives in this block, so their destructors run while the
+    // context still exists
     {
-        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_right.png"),
-        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_left.png"),
-        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_up.png"),
-        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_down.png"),
-        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_front.png"),
-        FileSystem::getPath("resources/textures/land_skybox/vz_classic_land_back.png")
-    };
-    unsigned int cubemapTexture = loadCubemap(faces);
-
-    // shader configuration
-    // --------------------
-    shader.use();
-    shader.setInt("skybox", 0);
-    //shader.setVec3("objectColor", glm::vec3(0.7f, 1.5f, 0.7f));
-    shader.setVec3("objectColor", glm::vec3(1.0f, 1.8f, 1.0f));
+        // configure global opengl state
+        // -----------------------------
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS); // filter across cubemap face edges
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        // build and compile shaders
+        // -------------------------
+        // programs are shared through the AssetRegistry, keyed by their stages and defines, so a
+        // variant asked for twice is compiled once; each key is released at shutdown
+        vector<string> programKeys;
+        auto program = [&](const char* vertexPath, const char* fragmentPath, const string &defines) -> Shader {
+            string key = AssetRegistry::ProgramKey(vertexPath, fragmentPath, defines);
+            programKeys.push_back(key);
+            return Shader(AssetRegistry::Get().AcquireProgram(key, [&]() {
+                return Shader(vertexPath, fragmentPath, defines.empty() ? NULL : defines.c_str()).ID;
+            }));
+        };
+        Shader shader = program("../../src/shader/gem.vert", "../../src/shader/gem.frag", "");
+        Shader shaderSingle = program("../../src/shader/gem.vert", "../../src/shader/gem.frag", "#define SHADE_SINGLE\n");
+        Shader shaderFace = program("../../src/shader/gem.vert", "../../src/shader/gem.frag", "#define SHADE_FACE\n");
+        // gem programs by Shade_Tier
+        Shader* gemShaders[SHADE_TIER_COUNT] = { &shader, &shaderSingle, &shaderFace };
+        Shader skyboxShader = program("../../src/shader/skybox.vert", "../../src/shader/skybox.frag", "");
+        Shader wireShader = program("../../src/shader/gem.vert", "../../src/shader/basic.frag", "");
+        Shader prefilterShader = program("../../src/shader/prefilter.vert", "../../src/shader/prefilter.frag", "");
+        Shader fxaaShader = program("../../src/shader/fullscreen.vert", "../../src/shader/fxaa.frag", "");
+        // stereo variants, which read both eyes' matrices from the StereoViews block
+        StereoRenderer stereoRenderer;
+        string stereoDefines = stereoRenderer.Defines();
+        Shader stereoShader = program("../../src/shader/gem.vert", "../../src/shader/gem.frag", stereoDefines);
+        Shader stereoShaderSingle = program("../../src/shader/gem.vert", "../../src/shader/gem.frag", stereoDefines + "#define SHADE_SINGLE\n");
+        Shader stereoShaderFace = program("../../src/shader/gem.vert", "../../src/shader/gem.frag", stereoDefines + "#define SHADE_FACE\n");
+        Shader* stereoGemShaders[SHADE_TIER_COUNT] = { &stereoShader, &stereoShaderSingle, &stereoShaderFace };
+        Shader stereoSkyboxShader = program("../../src/shader/skybox.vert", "../../src/shader/skybox.frag", stereoDefines);
+        Shader stereoWireShader = program("../../src/shader/gem.vert", "../../src/shader/basic.frag", stereoDefines);
+
+        // set up vertex data (and buffer(s)) and configure vertex attributes
+        // ------------------------------------------------------------------
+        //float cubeVertices[] = {
+        //    // positions          // normals
+        //    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+        //     0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+        //     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+        //     0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+        //    -0.5f,  0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+        //    -0.5f, -0.5f, -0.5f,  0.0f,  0.0f, -1.0f,
+        //
+        //    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
+        //     0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
+        //     0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
+        //     0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
+        //    -0.5f,  0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
+        //    -0.5f, -0.5f,  0.5f,  0.0f,  0.0f, 1.0f,
+        //
+        //    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+        //    -0.5f,  0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+        //    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+        //    -0.5f, -0.5f, -0.5f, -1.0f,  0.0f,  0.0f,
+        //    -0.5f, -0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+        //    -0.5f,  0.5f,  0.5f, -1.0f,  0.0f,  0.0f,
+        //
+        //     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+        //     0.5f,  0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+        //     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+        //     0.5f, -0.5f, -0.5f,  1.0f,  0.0f,  0.0f,
+        //     0.5f, -0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+        //     0.5f,  0.5f,  0.5f,  1.0f,  0.0f,  0.0f,
+        //
+        //    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+        //     0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+        //     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+        //     0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+        //    -0.5f, -0.5f,  0.5f,  0.0f, -1.0f,  0.0f,
+        //    -0.5f, -0.5f, -0.5f,  0.0f, -1.0f,  0.0f,
+        //
+        //    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
+        //     0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,
+        //     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+        //     0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+        //    -0.5f,  0.5f,  0.5f,  0.0f,  1.0f,  0.0f,
+        //    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f
+        //};
+
+        // gem VAO
+        unsigned int gemVAO, gemVBO;
+        glGenVertexArrays(1, &gemVAO);
+        glGenBuffers(1, &gemVBO);
+        glBindVertexArray(gemVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, gemVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(gemVertices), &gemVertices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        // gem edges VAO
+        unsigned int edgeVAO, edgeVBO;
+        glGenVertexArrays(1, &edgeVAO);
+        glGenBuffers(1, &edgeVBO);
+        glBindVertexArray(edgeVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, edgeVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(gemEdges), &gemEdges, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        // skybox VAO
+        unsigned int skyboxVAO, skyboxVBO;
+        glGenVertexArrays(1, &skyboxVAO);
+        glGenBuffers(1, &skyboxVBO);
+        glBindVertexArray(skyboxVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, skyboxVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), &skyboxVertices, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+
+        // load textures
+        // -------------
+        vector<std::string> faces = skyboxFaces();
+        unsigned int cubemapTexture = loadCubemap(faces);
+        unsigned int cubemapLevels = CubemapLevelCount(cubemapTexture);
+        int cubemapSize = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &cubemapSize);
+        // computed once; level 0 matches the skybox, so switching only changes the distant look
+        unsigned int prefilteredTexture = PrefilterCubemap(prefilterShader.ID, cubemapTexture, cubemapSize);
+        unsigned int prefilteredLevels = CubemapLevelCount(prefilteredTexture);
+
+        // shader configuration
+        // --------------------
+        for (int i = 0; i < 2 * SHADE_TIER_COUNT; i++) {
+            Shader &gemShader = i < SHADE_TIER_COUNT ? *gemShaders[i] : *stereoGemShaders[i - SHADE_TIER_COUNT];
+            gemShader.use();
+            gemShader.setInt("skybox", 0);
+            //gemShader.setVec3("objectColor", glm::vec3(0.7f, 1.5f, 0.7f));
+            gemShader.setVec3("objectColor", glm::vec3(1.0f, 1.8f, 1.0f));
+            gemShader.setFloat("envRoughness", materialRoughness);
+        }
 
-    skyboxShader.use();
-    skyboxShader.setInt("skybox", 0);
+        skyboxShader.use();
+        skyboxShader.setInt("skybox", 0);
+        stereoSkyboxShader.use();
+        stereoSkyboxShader.setInt("skybox", 0);
+
+        // draws are recorded into a command buffer each frame and replayed in sort-key order
+        CommandBuffer commands;
+        RenderQueue renderQueue;
+        for (int tier = 0; tier < SHADE_TIER_COUNT; tier++) {
+            renderQueue.RegisterProgram(gemShaders[tier]->ID, "model", "objectColor");
+            renderQueue.RegisterProgram(stereoGemShaders[tier]->ID, "model", "objectColor");
+        }
+        renderQueue.RegisterProgram(wireShader.ID, "model", "myColor");
+        renderQueue.RegisterProgram(stereoWireShader.ID, "model", "myColor");
+        renderQueue.RegisterProgram(skyboxShader.ID, "model", "objectColor");
+        renderQueue.RegisterProgram(stereoSkyboxShader.ID, "model", "objectColor");
+
+        // offscreen target for dynamic resolution; the scene pass aims at 85% of a refresh interval
+        // so the blit, the swap and whatever else shares the GPU still fit
+        DynamicResolution dynamicResolution;
+        const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        if (videoMode != NULL && videoMode->refreshRate > 0)
+            dynamicResolution.TargetMs = 0.85f * 1000.0f / (float)videoMode->refreshRate;
+
+        // anti-aliasing post pass; reads the offscreen target and also does the upscale
+        PostAA postAA(fxaaShader.ID);
+        float lastTitleUpdate = 0.0f;
+
+        // the low-latency limiter runs at the refresh rate
+        FramePacer framePacer;
+        LatencyMeter latencyMeter;
+        float refreshRate = videoMode != NULL && videoMode->refreshRate > 0 ? (float)videoMode->refreshRate : 60.0f;
+        // a headless replay runs as fast as it can
+        if (headless)
+            swapMode = SWAP_IMMEDIATE;
+        activeSwapMode = ApplySwapMode(swapMode);
+        vector<float> replayFrameMs;
+
+        // idle mode: a few quiet frames are still drawn (the probe needs up to six to refresh every
+        // face), then the loop sleeps, waking at least every idleWakeSeconds to look again.
+        // Recording and replaying need every frame, so they never idle.
+        const unsigned int idleSettleFrames = 8;
+        const double idleWakeSeconds = 0.5;
+        unsigned int quietFrames = 0;
+        glm::mat4 lastViewProjection = glm::mat4(0.0f);
+        bool canIdle = !headless && !inputRecorder.Recording() && !inputRecorder.Replaying();
+
+        // CPU ray tracer; its image replaces the GL passes while toggled on with T
+        RayTracer rayTracer;
+        SoftCubemap traceSkybox;
+        vector<TraceInstance> traceInstances;
+        vector<unsigned char> tracePixels;
+        unsigned int traceTexture = 0, traceFBO = 0;
+        glm::mat4 lastTraceView = glm::mat4(0.0f);
+
+        // dynamic environment probe at the centre of the ring, so the gems reflect each other
+        ReflectionProbe reflectionProbe(128, glm::vec3(0.0f));
+        // the gems drawn this frame, kept from frame to frame and updated in place
+        vector<GemInstance> frameGems;
+        // frameGems by cell, moved incrementally as the gems move, so each view only visits the
+        // cells it can see
+        SpatialGrid gemGrid(4.0f, 1.0f, outerRadius);
+        vector<SpatialGrid::VisibleCell> visibleCells;
+        // streamed field: the frameGems slots of each resident chunk, and slots free for reuse
+        unordered_map<unsigned int, vector<unsigned int> > chunkGems;
+        vector<unsigned int> freeGems;
+
+        // a streamed field replaces the ring when a scene file is given
+        SceneStream sceneStream;
+        if (!scenePath.empty() && !sceneStream.Open(scenePath))
+            std::cout << "Failed to open scene: " << scenePath << std::endl;
+
+        // Draws the scene as seen from eyePos with the gem programs reflecting environment, a
+        // cubemap of environmentSize with environmentLevels mips, culling the gems to frustum (that of
+        // projection * view). The stereo programs take their matrices from the StereoViews block
+        // instead, and every draw is made once per eye.
+        auto drawScene = [&](const glm::mat4 &view, const glm::mat4 &projection, const Frustum &frustum, const glm::vec3 &eyePos,
+                             unsigned int environment, unsigned int environmentLevels, int environmentSize,
+                             float pixelSpread, bool stereo) {
+            // Environment LOD: a pixel at distance 1 spans pixelSpread world units, and across a gem
+            // (outerRadius * 2 wide) the facets sweep roughly 2 radians of directions
+            float texelsPerRadian = (float)environmentSize / (PI * 0.5f);
+
+            // Per-view uniforms; these are the same for every gem so they are set once per view
+            // rather than once per draw, on each shading tier's program.
+            Shader** tierShaders = stereo ? stereoGemShaders : gemShaders;
+            for (int tier = 0; tier < SHADE_TIER_COUNT; tier++) {
+                Shader &gemShader = *tierShaders[tier];
+                gemShader.use();
+
+                // Material
+                gemShader.setVec3("material.ambient", materialAmbient);
+                gemShader.setVec3("material.diffuse", materialDiffuse);
+                gemShader.setVec3("material.specular", materialSpecular);
+                gemShader.setFloat("material.shininess", materialShininess);
+
+                // Lighting
+                gemShader.setVec3("light.position", lightPos);
+                gemShader.setVec3("light.ambient", lightAmbient);
+                gemShader.setVec3("light.diffuse", lightDiffuse);
+                gemShader.setVec3("light.specular", lightSpecular);
+
+                gemShader.setMat4("view", view);
+                gemShader.setMat4("projection", projection);
+                gemShader.setVec3("cameraPos", eyePos);
+
+                gemShader.setFloat("envLodScale", pixelSpread * (2.0f / (outerRadius * 2.0f)) * texelsPerRadian);
+                gemShader.setFloat("envMaxLod", (float)(environmentLevels - 1));
+            }
 
-    
-    glLineWidth(lineWidth);
-    //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            Shader &edgeShader = stereo ? stereoWireShader : wireShader;
+            if (wireframe_enabled) {
+                edgeShader.use();
+                edgeShader.setMat4("view", view);
+                edgeShader.setMat4("projection", projection);
+                edgeShader.setVec3("cameraPos", eyePos);
+            }
 
-    // render loop
-    // -----------
-    while (!glfwWindowShouldClose(window))
-    {
-        // per-frame time logic
-        // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
-
-        // input
-        // -----
-        processInput(window);
-
-        // render
-        // ------
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Camera
-        glm::mat4 view = camera.GetViewMatrix();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        
-        // sort the transparent gems before rendering
-        std::map<float, std::pair<int, glm::vec3>> sorted;
-        for (std::map<int, glm::vec3>::reverse_iterator it = gemLocs.rbegin(); it != gemLocs.rend(); ++it)
+            Shader &backgroundShader = stereo ? stereoSkyboxShader : skyboxShader;
+            backgroundShader.use();
+            backgroundShader.setMat4("view", glm::mat4(glm::mat3(view))); // remove translation from the view matrix
+            backgroundShader.setMat4("projection", projection);
+
+            // Record the gems in the cells in view. Transparent draws are keyed by distance, so
+            // sorting the command buffer puts them back to front; the cells come nearest first,
+            // which leaves the sort little to do. A stereo view is culled with the mono frustum,
+            // which is wider than either eye's.
+            commands.Clear();
+            gemGrid.VisibleCells(frustum, eyePos, visibleCells);
+            for (unsigned int cell = 0; cell < visibleCells.size(); cell++)
+            {
+                const vector<unsigned int> &members = *visibleCells[cell].members;
+                for (unsigned int member = 0; member < members.size(); member++)
+                {
+                    const GemInstance &instance = frameGems[members[member]];
+                    float distance = glm::length(eyePos - instance.position);
+                    glm::mat4 model = sceneStream.IsOpen() ? fieldGemModelMatrix(instance, angle) : instance.model;
+                    const glm::vec3 &color = instance.color;
+                    float depth = distance / farPlane;
+
+                    uint32_t gemUniforms = commands.PushUniforms(model, color * colorMult);
+                    // cheaper shading for gems that are small on screen
+                    GLuint gemProgram = tierShaders[shading_lod_enabled ? gemShadeTier(distance, pixelSpread) : SHADE_FULL]->ID;
+                    commands.Draw(MakeSortKey(PASS_TRANSPARENT, depth, LAYER_GEM, gemProgram, gemVAO, environment),
+                                  gemProgram, gemVAO, GL_TRIANGLES, 0, gemVertexCount, gemUniforms, environment, GL_TEXTURE_CUBE_MAP);
+
+                    // wireframe edges
+                    if (wireframe_enabled) {
+                        // Adjust line width based on distance
+                        float edgeWidth = 1.0f;
+                        if (distance <= lineWidthMaxDistance)
+                            edgeWidth = lineWidth - (lineWidth * distance) / lineWidthMaxDistance;
+
+                        uint32_t edgeUniforms = commands.PushUniforms(model, (color - 0.5f) * 0.5f + 0.5f);
+                        commands.Draw(MakeSortKey(PASS_TRANSPARENT, depth, LAYER_EDGE, edgeShader.ID, edgeVAO, 0),
+                                      edgeShader.ID, edgeVAO, GL_LINES, 0, gemEdgeVertexCount, edgeUniforms, 0, GL_TEXTURE_2D, edgeWidth);
+                    }
+                }
+            }
+
+            // draw skybox as last
+            uint32_t skyboxUniforms = commands.PushUniforms(glm::mat4(1.0f), glm::vec3(1.0f));
+            commands.Draw(MakeSortKey(PASS_SKYBOX, 1.0f, LAYER_GEM, backgroundShader.ID, skyboxVAO, cubemapTexture),
+                          backgroundShader.ID, skyboxVAO, GL_TRIANGLES, 0, skyboxVertexCount, skyboxUniforms, cubemapTexture, GL_TEXTURE_CUBE_MAP);
+
+            commands.Sort();
+            renderQueue.Submit(commands, stereo ? 2 : 1); // one instance per eye
+        };
+
+        glLineWidth(lineWidth);
+        //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+
+        // render loop
+        // -----------
+        while (!glfwWindowShouldClose(window))
         {
-            float distance = glm::length(camera.Position - it->second);
-            sorted[distance] = std::pair<int, glm::vec3> {it->first, it->second};
-        }
+            // wait before reading any input, so the wait doesn't add to the latency
+            framePacer.TargetFps = low_latency_enabled && !headless ? refreshRate : 0.0f;
+            framePacer.Wait();
+
+            // per-frame time logic
+            // --------------------
+            float currentFrame = static_cast<float>(glfwGetTime());
+            // the recorded or fixed timestep when there is one; the wall clock otherwise
+            deltaTime = inputRecorder.BeginFrame(currentFrame - lastFrame);
+            if (inputRecorder.Finished())
+                break;
+            if (inputRecorder.Replaying() && inputRecorder.Frame() > 0)
+                replayFrameMs.push_back((currentFrame - lastFrame) * 1000.0f);
+            lastFrame = currentFrame;
+
+            // input
+            // -----
+            processInput(window);
+
+            // animate the gems; every view drawn this frame uses the same transforms
+            if (sceneStream.IsOpen()) {
+                // page the field in around the camera; the gems only spin, each from its own phase,
+                // so their models are built when drawn and only the chunks that came or went this
+                // frame touch the list and the grid
+                sceneStream.Update(camera.Position);
+                if (revolveMode >= 1)
+                    angle += deltaTime / rotateDivisor;
+                const vector<unsigned int> &removed = sceneStream.Removed();
+                for (unsigned int c = 0; c < removed.size(); c++) {
+                    vector<unsigned int> &slots = chunkGems[removed[c]];
+                    for (unsigned int i = 0; i < slots.size(); i++) {
+                        gemGrid.Remove(slots[i]);
+                        freeGems.push_back(slots[i]);
+                    }
+                    chunkGems.erase(removed[c]);
+                }
+                const vector<unsigned int> &added = sceneStream.Added();
+                for (unsigned int c = 0; c < added.size(); c++) {
+                    const SceneInstance* instances = sceneStream.Instances(added[c]);
+                    vector<unsigned int> &slots = chunkGems[added[c]];
+                    for (unsigned int i = 0; i < sceneStream.InstanceCount(added[c]); i++) {
+                        unsigned int slot;
+                        if (!freeGems.empty()) {
+                            slot = freeGems.back();
+                            freeGems.pop_back();
+                        }
+                        else {
+                            slot = (unsigned int)frameGems.size();
+                            frameGems.push_back(GemInstance());
+                        }
+                        GemInstance &gem = frameGems[slot];
+                        gem.position = instances[i].position;
+                        gem.color = instances[i].color;
+                        gem.phase = instances[i].phase;
+                        gem.scale = instances[i].scale;
+                        gemGrid.Insert(slot, gem.position);
+                        slots.push_back(slot);
+                    }
+                }
+            }
+            else {
+                frameGems.resize(gemLocs.size());
+                for (std::map<int, glm::vec3>::iterator it = gemLocs.begin(); it != gemLocs.end(); ++it)
+                {
+                    int gem = it->first;
+                    glm::vec3 gemPos = it->second;
+
+                    // Transformations
+                    if (revolveMode >= 1)
+                    {
+                        angle += deltaTime / rotateDivisor;
+                    }
+                    if (revolveMode >= 2) {
+                        revolveOffset += deltaTime / revolveDivisor;
+
+                        float gemTimeOffset = (PI * 2.0f * (float)gem) / 7.0f;
+
+                        // move gems up and down
+                        if (revolveMode >= 3) {
+                            // Update height location of each gem
+                            float gemHeightOffset = revolveHeight * sin(PI * (revolveOffset * revolveHeightSpeedMult) + gemTimeOffset);
+                            gemPos.y = gemHeightOffset;
+                            it->second.y = gemHeightOffset;
+                        }
+                    }
+                    GemInstance &instance = frameGems[gem];
+                    instance.model = gemModelMatrix(gemPos, revolveOffset, angle);
+                    instance.position = glm::vec3(instance.model[3]); // after the orbit
+                    instance.color = colors[gem];
+                    instance.phase = 0.0f;
+                    instance.scale = 1.0f;
+                    // usually a bounds check; the gem only changes cells when it has left its own
+                    gemGrid.Move(gem, instance.position);
+                }
+            }
 
-        // Render the gems in order
-        for (std::map<float, std::pair<int, glm::vec3>>::reverse_iterator it = sorted.rbegin(); it != sorted.rend(); ++it) {
-            shader.use();
-
-            // Material
-            shader.setVec3("material.ambient", glm::vec3(0.0f, 0.1f, 0.06f));
-            shader.setVec3("material.diffuse", glm::vec3(0.07568f, 0.61424f, 0.07568f));
-            shader.setVec3("material.specular", glm::vec3(0.633f, 0.727811f, 0.633f));
-            shader.setFloat("material.shininess", 6.0f);
-
-            // Lighting
-            glm::vec3 lightColor = glm::vec3(1.0, 1.0, 1.0);
-            glm::vec3 diffuseColor = lightColor * glm::vec3(0.5f); //decrease the influence
-            glm::vec3 ambientColor = diffuseColor * glm::vec3(0.2f); //low influence
-            shader.setVec3("light.position", lightPos);
-            shader.setVec3("light.ambient", ambientColor);
-            shader.setVec3("light.diffuse", diffuseColor);
-            shader.setVec3("light.specular", glm::vec3(1.0, 1.0, 1.0));
-
-            // Transformations
-            glm::mat4 model = glm::mat4(1.0f);
-            if (revolveMode >= 1)
-            {
-                angle += deltaTime / rotateDivisor;
+            // idle: nothing to draw that isn't already on screen. Anything that can change the
+            // image counts: input (including toggles and window damage), animation, the camera,
+            // scene chunks still streaming in, and the ray tracer refining its image.
+            glm::mat4 viewProjection = camera.GetFrame((float)fbWidth / (float)std::max(fbHeight, 1), nearPlane, farPlane).ViewProjection;
+            bool changed = inputActivity || revolveMode != 0 || trace_enabled || viewProjection != lastViewProjection ||
+                           (sceneStream.IsOpen() && sceneStream.Pending() > 0);
+            inputActivity = false;
+            lastViewProjection = viewProjection;
+            quietFrames = changed ? 0 : quietFrames + 1;
+            if (idle_enabled && canIdle && quietFrames > idleSettleFrames) {
+                if (quietFrames == idleSettleFrames + 1)
+                    glfwSetWindowTitle(window, (string(windowTitle) + " | idle").c_str());
+                glfwWaitEventsTimeout(idleWakeSeconds);
+                // the time asleep isn't animation time
+                lastFrame = static_cast<float>(glfwGetTime());
+                continue;
+            }
+
+            // render
+            // ------
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+
+            // gems reflect the probe; the probe's own faces see the static environment, so it never
+            // samples itself
+            unsigned int staticEnvironment = prefilter_enabled ? prefilteredTexture : cubemapTexture;
+            unsigned int staticLevels = prefilter_enabled ? prefilteredLevels : cubemapLevels;
+            if (probe_enabled && !trace_enabled) {
+                reflectionProbe.Update([&](const glm::mat4 &faceView, const glm::mat4 &faceProjection) {
+                    drawScene(faceView, faceProjection, Frustum::FromMatrix(faceProjection * faceView), reflectionProbe.Center,
+                              staticEnvironment, staticLevels, cubemapSize, 2.0f / (float)reflectionProbe.Size(), false);
+                }, nearPlane, farPlane);
             }
-            if (revolveMode >= 2) {
-                revolveOffset += deltaTime / revolveDivisor;
-
-                // Rotating first makes them all orbit around the origin
-                model = glm::rotate(model, revolveOffset, glm::vec3(0.0f, 1.0f, 0.0f));
-                
-                float gemTimeOffset = (PI * 2.0f * (float)(it->second.first)) / 7.0f;
-                //// Calculate new positions
-                //float newX = cos(revolveOffset + gemTimeOffset) * gemDist;
-                //gemLocs[it->second.first].x = newX;
-                //float newZ = sin(revolveOffset + gemTimeOffset) * gemDist;
-                //gemLocs[it->second.first].z = newZ;
-
-                // move gems up and down
-                if (revolveMode >= 3) {
-                    // Update height location of each gem
-                    float gemHeightOffset = revolveHeight * sin(PI * (revolveOffset * revolveHeightSpeedMult) + gemTimeOffset);
-                    it->second.second.y = gemHeightOffset;
-                    gemLocs[it->second.first].y = gemHeightOffset;
-                    //model = glm::translate(model, glm::vec3(0.0f, gemHeightOffset, 0.0f));
+
+            // the scene goes through the offscreen target for dynamic resolution and for the AA pass;
+            // the traced view has its own fixed downscale and no AA
+            bool offscreen = (dynres_enabled || aaPreset != AA_OFF) && !trace_enabled;
+            dynamicResolution.Adaptive = dynres_enabled;
+            if (offscreen)
+                dynamicResolution.Begin(fbWidth, fbHeight);
+            int renderWidth = offscreen ? dynamicResolution.Width() : fbWidth;
+            int renderHeight = offscreen ? dynamicResolution.Height() : fbHeight;
+            bool stereo = stereo_enabled && !trace_enabled;
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+            // low-latency mode reads the mouse and movement keys as late as possible, once
+            // everything that doesn't depend on the camera has been submitted
+            if (low_latency_enabled) {
+                inputRecorder.PollEvents();
+                processMovement(window);
+                latencyMeter.InputSampled();
+            }
+
+            // Camera: one snapshot for everything drawn this frame; the matrices and frustum are
+            // cached in the camera and only rebuilt when it has moved, turned or zoomed
+            CameraFrame cameraFrame = camera.GetFrame((float)fbWidth / (float)std::max(fbHeight, 1), nearPlane, farPlane);
+            const glm::mat4 &view = cameraFrame.View;
+            const glm::mat4 &projection = cameraFrame.Projection;
+            // the stereo programs take the eyes' matrices instead of view and projection
+            if (stereo)
+                stereoRenderer.Update(cameraFrame);
+
+            float pixelSpread = 2.0f * tan(cameraFrame.FovY * 0.5f) / (float)std::max(renderHeight, 1);
+
+            if (trace_enabled) {
+                int traceWidth = std::max(1, fbWidth / traceDownscale);
+                int traceHeight = std::max(1, fbHeight / traceDownscale);
+                if (traceSkybox.width[0] == 0)
+                    traceSkybox.Load(faces);
+
+                // keep refining the same image while nothing moves
+                if (revolveMode != 0 || view != lastTraceView)
+                    rayTracer.ResetAccumulation();
+                lastTraceView = view;
+                // every gem, not only those in view, since they show in each other's reflections
+                traceInstances.clear();
+                if (sceneStream.IsOpen()) {
+                    for (unordered_map<unsigned int, vector<unsigned int> >::iterator it = chunkGems.begin(); it != chunkGems.end(); ++it)
+                        for (unsigned int i = 0; i < it->second.size(); i++) {
+                            TraceInstance traceInstance;
+                            traceInstance.model = fieldGemModelMatrix(frameGems[it->second[i]], angle);
+                            traceInstance.color = frameGems[it->second[i]].color;
+                            traceInstances.push_back(traceInstance);
+                        }
                 }
-                model = glm::translate(model, it->second.second); // move to initial position
-                model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+                else {
+                    for (unsigned int gem = 0; gem < frameGems.size(); gem++) {
+                        TraceInstance traceInstance;
+                        traceInstance.model = frameGems[gem].model;
+                        traceInstance.color = frameGems[gem].color;
+                        traceInstances.push_back(traceInstance);
+                    }
+                }
+                rayTracer.SetInstances(traceInstances);
+                rayTracer.Render(traceWidth, traceHeight, view, projection, cameraFrame.Position, traceSkybox, tracePixels);
+
+                if (traceFBO == 0) {
+                    glGenTextures(1, &traceTexture);
+                    glGenFramebuffers(1, &traceFBO);
+                }
+                glBindTexture(GL_TEXTURE_2D, traceTexture);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, traceWidth, traceHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, &tracePixels[0]);
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, traceFBO);
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, traceTexture, 0);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+                glBlitFramebuffer(0, 0, traceWidth, traceHeight, 0, 0, fbWidth, fbHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
             }
             else {
-                // Rotating first makes them all orbit around the origin
-                model = glm::rotate(model, revolveOffset, glm::vec3(0.0f, 1.0f, 0.0f));
-                model = glm::translate(model, it->second.second); // move to initial position
-                model = glm::rotate(model, angle, glm::vec3(0.0f, 1.0f, 0.0f));
+                unsigned int environment = probe_enabled ? reflectionProbe.Cubemap() : staticEnvironment;
+                unsigned int environmentLevels = probe_enabled ? reflectionProbe.Levels() : staticLevels;
+                int environmentSize = probe_enabled ? reflectionProbe.Size() : cubemapSize;
+                if (stereo)
+                    stereoRenderer.Begin(renderWidth, renderHeight);
+                drawScene(view, projection, cameraFrame.ViewFrustum, cameraFrame.Position, environment, environmentLevels, environmentSize,
+                          pixelSpread, stereo);
+                if (stereo)
+                    stereoRenderer.End(renderWidth, renderHeight);
             }
-            //model = glm::translate(model, glm::vec3(it->second.second.x, it->second.second.y, it->second.second.z));
-
-            shader.setMat4("model", model);
-            shader.setMat4("view", view);
-            shader.setMat4("projection", projection);
-            shader.setVec3("cameraPos", camera.Position);
-            //shader.setVec3("objectColor", glm::vec3(1.0f, 1.8f, 1.0f));
-            shader.setVec3("objectColor", colors[it->second.first] * colorMult);
-            glBindVertexArray(gemVAO);
-            glActiveTexture(GL_TEXTURE0);
-            //glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-            //glDrawArrays(GL_TRIANGLES, 0, 36);
-            glDrawArrays(GL_TRIANGLES, 0, 84);
-            //glBindVertexArray(0);
-
-            // wireframe edges
-            if (wireframe_enabled) {
-                // Adjust line width based on distance
-                if (it->first > lineWidthMaxDistance)
-                    glLineWidth(1);
+
+            // anti-alias and/or upscale to the window, then pick next frame's scale
+            if (offscreen) {
+                dynamicResolution.End();
+                if (aaPreset != AA_OFF) {
+                    postAA.Apply(dynamicResolution.ColorTexture(), dynamicResolution.TargetWidth(), dynamicResolution.TargetHeight(),
+                                 dynamicResolution.Width(), dynamicResolution.Height(), aaPreset);
+                    dynamicResolution.Adjust();
+                }
                 else
-                    glLineWidth(lineWidth - (lineWidth * it->first) / lineWidthMaxDistance);
-
-                glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-                //shader.setVec3("objectColor", glm::vec3(0.0f, 0.0f, 0.0f));
-                wireShader.use();
-                wireShader.setMat4("model", model);
-                wireShader.setMat4("view", view);
-                wireShader.setMat4("projection", projection);
-                wireShader.setVec3("cameraPos", camera.Position);
-                //wireShader.setVec3("myColor", glm::vec3(0.0f, 0.0f, 0.0f));
-                //wireShader.setVec3("myColor", glm::vec3(0.23f, 0.48f, 0.28f));
-                wireShader.setVec3("myColor", (colors[it->second.first]-0.5f)*0.5f + 0.5f);
-                glBindVertexArray(edgeVAO);
-                glActiveTexture(GL_TEXTURE0);
-                //glDrawArrays(GL_TRIANGLES, 0, 84);
-                glDrawArrays(GL_LINES, 0, 48);
-                glBindVertexArray(0);
-                glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+                    dynamicResolution.Blit();
+            }
+
+            // per-pass GPU timings in the title bar, once a second
+            if (currentFrame - lastTitleUpdate >= 1.0f) {
+                lastTitleUpdate = currentFrame;
+                string title = windowTitle;
+                char part[128];
+                if (offscreen) {
+                    snprintf(part, sizeof(part), " | scene %.2f ms at %d%% | AA %s %.2f ms",
+                             dynamicResolution.LastGpuMs(), (int)(dynamicResolution.Scale() * 100.0f + 0.5f),
+                             AAPresetName(aaPreset), aaPreset != AA_OFF ? postAA.LastGpuMs() : 0.0f);
+                    title += part;
+                }
+                if (low_latency_enabled) {
+                    snprintf(part, sizeof(part), " | %s | input to present %.1f ms", SwapModeName(activeSwapMode), latencyMeter.AverageMs());
+                    title += part;
+                }
+                glfwSetWindowTitle(window, title.c_str());
+            }
+
+            // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+            // -------------------------------------------------------------------------------
+            glfwSwapBuffers(window);
+            if (low_latency_enabled) {
+                latencyMeter.Presented();
+                // keep the CPU from starting a frame before the GPU is done with this one, so
+                // nothing sits in a queue between reading input and presenting
+                glFinish();
             }
+            inputRecorder.PollEvents();
         }
 
-        // draw skybox as last
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        skyboxShader.use();
-        view = glm::mat4(glm::mat3(camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthFunc(GL_LESS); // set depth function back to default
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
-    }
+        if (!replayFrameMs.empty()) {
+            vector<float> sorted = replayFrameMs;
+            std::sort(sorted.begin(), sorted.end());
+            double total = 0.0;
+            for (unsigned int i = 0; i < sorted.size(); i++)
+                total += sorted[i];
+            std::cout << std::fixed << std::setprecision(3) << "replay: " << sorted.size() << " frames, mean "
+                      << total / sorted.size() << " ms, p50 " << sorted[sorted.size() / 2] << " ms, p95 "
+                      << sorted[sorted.size() * 95 / 100] << " ms, p99 " << sorted[sorted.size() * 99 / 100]
+                      << " ms, max " << sorted.back() << " ms" << std::endl;
+        }
 
-    // optional: de-allocate all resources once they've outlived their purpose:
-    // ------------------------------------------------------------------------
-    glDeleteVertexArrays(1, &gemVAO);
-    glDeleteVertexArrays(1, &skyboxVAO);
-    glDeleteBuffers(1, &gemVBO);
-    glDeleteBuffers(1, &skyboxVBO);
+        // optional: de-allocate all resources once they've outlived their purpose:
+        // ------------------------------------------------------------------------
+        glDeleteVertexArrays(1, &gemVAO);
+        glDeleteVertexArrays(1, &skyboxVAO);
+        glDeleteVertexArrays(1, &edgeVAO);
+        glDeleteBuffers(1, &gemVBO);
+        glDeleteBuffers(1, &skyboxVBO);
+        glDeleteBuffers(1, &edgeVBO);
+        // made on the first traced frame; deleting name 0 is ignored
+        glDeleteFramebuffers(1, &traceFBO);
+        glDeleteTextures(1, &traceTexture);
+        for (unsigned int i = 0; i < programKeys.size(); i++)
+            AssetRegistry::Get().ReleaseProgram(programKeys[i]);
+    }
 
     glfwTerminate();
     return 0;
@@ -875,43 +840,30 @@ int main()
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow* window)
 {
-    shiftDis = deltaTime / 1.0f;
-
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+    if (inputRecorder.GetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, shiftDis);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, shiftDis);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, shiftDis);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, shiftDis);
+    // the low-latency mode moves the camera later in the frame
+    if (!low_latency_enabled)
+        processMovement(window);
 
     // Rotate the gem
-    if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+    if (inputRecorder.GetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
         if (!rButtonLock)
             revolveMode++;
         rButtonLock = true;
         if (revolveMode > 3)
             revolveMode = 0;
     }
-    else if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS) {
+    else if (inputRecorder.GetKey(window, GLFW_KEY_P) == GLFW_PRESS) {
         revolveMode = 0;
     }
     else {
         rButtonLock = false;
     }
 
-    // Up/Down movement
-    if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS)
-        camera.ProcessKeyboard(UP, shiftDis);
-    if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
-        camera.ProcessKeyboard(DOWN, shiftDis);
-
     // Enable wireframe
-    if (glfwGetKey(window, GLFW_KEY_L) == GLFW_PRESS) {
+    if (inputRecorder.GetKey(window, GLFW_KEY_L) == GLFW_PRESS) {
         if (!lButtonLock) {
             if (wireframe_enabled)
                 wireframe_enabled = false;
@@ -922,6 +874,132 @@ void processInput(GLFWwindow* window)
     }
     else
         lButtonLock = false;
+
+    // Toggle the prefiltered gem environment
+    if (inputRecorder.GetKey(window, GLFW_KEY_G) == GLFW_PRESS) {
+        if (!gButtonLock) {
+            prefilter_enabled = !prefilter_enabled;
+            gButtonLock = true;
+        }
+    }
+    else
+        gButtonLock = false;
+
+    // Toggle dynamic resolution
+    if (inputRecorder.GetKey(window, GLFW_KEY_F) == GLFW_PRESS) {
+        if (!fButtonLock) {
+            dynres_enabled = !dynres_enabled;
+            fButtonLock = true;
+        }
+    }
+    else
+        fButtonLock = false;
+
+    // Toggle the gem shading tiers
+    if (inputRecorder.GetKey(window, GLFW_KEY_K) == GLFW_PRESS) {
+        if (!kButtonLock) {
+            shading_lod_enabled = !shading_lod_enabled;
+            kButtonLock = true;
+        }
+    }
+    else
+        kButtonLock = false;
+
+    // Cycle the anti-aliasing preset
+    if (inputRecorder.GetKey(window, GLFW_KEY_X) == GLFW_PRESS) {
+        if (!xButtonLock) {
+            aaPreset = (AA_Preset)((aaPreset + 1) % AA_PRESET_COUNT);
+            xButtonLock = true;
+        }
+    }
+    else
+        xButtonLock = false;
+
+    // Toggle side-by-side stereo
+    if (inputRecorder.GetKey(window, GLFW_KEY_V) == GLFW_PRESS) {
+        if (!vButtonLock) {
+            stereo_enabled = !stereo_enabled;
+            vButtonLock = true;
+        }
+    }
+    else
+        vButtonLock = false;
+
+    // Toggle the dynamic reflection probe
+    if (inputRecorder.GetKey(window, GLFW_KEY_B) == GLFW_PRESS) {
+        if (!bButtonLock) {
+            probe_enabled = !probe_enabled;
+            bButtonLock = true;
+        }
+    }
+    else
+        bButtonLock = false;
+
+    // Toggle the low-latency mode
+    if (inputRecorder.GetKey(window, GLFW_KEY_N) == GLFW_PRESS) {
+        if (!nButtonLock) {
+            low_latency_enabled = !low_latency_enabled;
+            // unaccelerated, unscaled mouse deltas where the platform has them
+            if (glfwRawMouseMotionSupported())
+                glfwSetInputMode(window, GLFW_RAW_MOUSE_MOTION, low_latency_enabled ? GLFW_TRUE : GLFW_FALSE);
+            nButtonLock = true;
+        }
+    }
+    else
+        nButtonLock = false;
+
+    // Cycle vsync, adaptive vsync and no vsync
+    if (inputRecorder.GetKey(window, GLFW_KEY_M) == GLFW_PRESS) {
+        if (!mButtonLock) {
+            swapMode = (Swap_Mode)((swapMode + 1) % SWAP_MODE_COUNT);
+            activeSwapMode = ApplySwapMode(swapMode);
+            mButtonLock = true;
+        }
+    }
+    else
+        mButtonLock = false;
+
+    // Toggle the idle mode
+    if (inputRecorder.GetKey(window, GLFW_KEY_I) == GLFW_PRESS) {
+        if (!iButtonLock) {
+            idle_enabled = !idle_enabled;
+            iButtonLock = true;
+        }
+    }
+    else
+        iButtonLock = false;
+
+    // Toggle the CPU ray traced view
+    if (inputRecorder.GetKey(window, GLFW_KEY_T) == GLFW_PRESS) {
+        if (!tButtonLock) {
+            trace_enabled = !trace_enabled;
+            tButtonLock = true;
+        }
+    }
+    else
+        tButtonLock = false;
+}
+
+// camera movement keys; separate from processInput so the low-latency mode can read them late
+// -----------------------------------------------------------------------------------------------
+void processMovement(GLFWwindow* window)
+{
+    shiftDis = deltaTime / 1.0f;
+
+    if (inputRecorder.GetKey(window, GLFW_KEY_W) == GLFW_PRESS)
+        camera.ProcessKeyboard(FORWARD, shiftDis);
+    if (inputRecorder.GetKey(window, GLFW_KEY_S) == GLFW_PRESS)
+        camera.ProcessKeyboard(BACKWARD, shiftDis);
+    if (inputRecorder.GetKey(window, GLFW_KEY_A) == GLFW_PRESS)
+        camera.ProcessKeyboard(LEFT, shiftDis);
+    if (inputRecorder.GetKey(window, GLFW_KEY_D) == GLFW_PRESS)
+        camera.ProcessKeyboard(RIGHT, shiftDis);
+
+    // Up/Down movement
+    if (inputRecorder.GetKey(window, GLFW_KEY_E) == GLFW_PRESS)
+        camera.ProcessKeyboard(UP, shiftDis);
+    if (inputRecorder.GetKey(window, GLFW_KEY_Q) == GLFW_PRESS)
+        camera.ProcessKeyboard(DOWN, shiftDis);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -931,12 +1009,25 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
     // make sure the viewport matches the new window dimensions; note that width and 
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    fbWidth = width;
+    fbHeight = height;
+    inputActivity = true;
+}
+
+// glfw: whenever the window needs redrawing (uncovered, restored), so an idle loop draws again
+// ---------------------------------------------------------------------------------------------
+void window_refresh_callback(GLFWwindow* window)
+{
+    inputActivity = true;
 }
 
 // glfw: whenever the mouse moves, this callback is called
 // -------------------------------------------------------
 void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 {
+    inputRecorder.Cursor(xposIn, yposIn);
+    inputActivity = true;
+
     float xpos = static_cast<float>(xposIn);
     float ypos = static_cast<float>(yposIn);
     if (firstMouse)
@@ -959,9 +1050,19 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
+    inputRecorder.Scroll(xoffset, yoffset);
+    inputActivity = true;
     camera.ProcessMouseScroll(static_cast<float>(yoffset));
 }
 
+// glfw: whenever a key is pressed, repeated or released; keys are read in processInput, this only
+// wakes the idle mode
+// ---------------------------------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    inputActivity = true;
+}
+
 // utility function for loading a 2D texture from file
 // ---------------------------------------------------
 unsigned int loadTexture(char const* path)
@@ -1016,22 +1117,42 @@ unsigned int loadCubemap(vector<std::string> faces)
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
-    int width, height, nrComponents;
-    for (unsigned int i = 0; i < faces.size(); i++)
+    // block compressed faces (and their mips) from the texture cache, if every face has one of
+    // the same format and size; a cube can't mix formats
+    CompressionSupport support = CompressionSupport::Query();
+    vector<CompressedTexture> compressed(faces.size());
+    bool useCompressed = faces.size() == 6;
+    for (unsigned int i = 0; i < faces.size() && useCompressed; i++)
+        useCompressed = LoadCompressedTexture(faces[i], support, compressed[i]) &&
+                        compressed[i].format == compressed[0].format &&
+                        compressed[i].width == compressed[0].width && compressed[i].height == compressed[0].height;
+    if (useCompressed)
     {
-        unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrComponents, 0);
-        if (data)
-        {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else
+        for (unsigned int i = 0; i < faces.size(); i++)
+            UploadCompressedTexture(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, compressed[i]);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, (GLint)compressed[0].levels.size() - 1);
+    }
+    else
+    {
+        int width, height, nrComponents;
+        for (unsigned int i = 0; i < faces.size(); i++)
         {
-            std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
-            stbi_image_free(data);
+            unsigned char* data = stbi_load(faces[i].c_str(), &width, &height, &nrComponents, 0);
+            if (data)
+            {
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+                stbi_image_free(data);
+            }
+            else
+            {
+                std::cout << "Cubemap texture failed to load at path: " << faces[i] << std::endl;
+                stbi_image_free(data);
+            }
         }
+        // full mip chain, so small or distant lookups read a matching level instead of level 0
+        glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
     }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
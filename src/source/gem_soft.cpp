@@ -0,0 +1,96 @@
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "camera.h"
+#include "gem_scene.h"
+#include "soft_raster.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// CPU-only renderer for the gem scene. Renders the same gems, skybox and animation as the
+// OpenGL build into an image, for render nodes without a GPU.
+//
+// usage: gem_soft [-w width] [-h height] [-n frames] [-r revolveMode] [-o out.ppm]
+
+// settings
+unsigned int imageWidth = 2048;
+unsigned int imageHeight = 1152;
+
+// same animation constants as gem.cpp
+const float rotateDivisor = 28.0f;
+const float revolveDivisor = 32.0f;
+const float revolveHeight = 0.4f;
+const float revolveHeightSpeedMult = 1.3f;
+
+int main(int argc, char** argv)
+{
+    int frames = 1;
+    int revolveMode = 0;
+    std::string output = "gem_soft.ppm";
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-w") == 0)
+            imageWidth = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-h") == 0)
+            imageHeight = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-n") == 0)
+            frames = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0)
+            revolveMode = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-o") == 0)
+            output = argv[i + 1];
+    }
+
+    SoftCubemap skybox;
+    skybox.Load(skyboxFaces());
+
+    Camera camera(glm::vec3(0.0f, 1.0f, 6.0f));
+    map<int, glm::vec3> gemLocs = makeGemLocations();
+    SoftRasterizer rasterizer(imageWidth, imageHeight);
+
+    // animate at a fixed 60 Hz step so every run renders the same frames
+    const float deltaTime = 1.0f / 60.0f;
+    float angle = 0.0f;
+    float revolveOffset = 0.0f;
+    double totalMs = 0.0;
+
+    for (int frame = 0; frame < frames; frame++)
+    {
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 projection = camera.GetProjectionMatrix((float)imageWidth / (float)imageHeight, 0.1f, 100.0f);
+
+        vector<SoftGem> gems;
+        for (std::map<int, glm::vec3>::iterator it = gemLocs.begin(); it != gemLocs.end(); ++it)
+        {
+            if (revolveMode >= 1)
+                angle += deltaTime / rotateDivisor;
+            if (revolveMode >= 2)
+            {
+                revolveOffset += deltaTime / revolveDivisor;
+                if (revolveMode >= 3)
+                {
+                    float gemTimeOffset = (PI * 2.0f * (float)it->first) / 7.0f;
+                    it->second.y = revolveHeight * sin(PI * (revolveOffset * revolveHeightSpeedMult) + gemTimeOffset);
+                }
+            }
+
+            SoftGem gem;
+            gem.model = gemModelMatrix(it->second, revolveOffset, angle);
+            gem.color = colors[it->first] * colorMult;
+            gem.distance = glm::length(camera.Position - it->second);
+            gems.push_back(gem);
+        }
+
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        rasterizer.Render(gems, view, projection, camera.Position, skybox);
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        totalMs += elapsed.count();
+    }
+
+    std::cout << frames << " frame(s) at " << imageWidth << "x" << imageHeight << ": "
+              << totalMs / frames << " ms/frame" << std::endl;
+    return rasterizer.WritePPM(output) ? 0 : 1;
+}
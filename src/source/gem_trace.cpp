@@ -0,0 +1,93 @@
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "camera.h"
+#include "gem_scene.h"
+#include "ray_tracer.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Offline CPU ray tracer for reference stills of the gem scene: multiple internal bounces with
+// Fresnel weighting instead of gem.frag's single refract/reflect lookup.
+//
+// usage: gem_trace [-w width] [-h height] [-s samples] [-b bounces] [-t seconds] [-r revolveMode] [-o out.ppm]
+
+// settings
+unsigned int imageWidth = 2048;
+unsigned int imageHeight = 1152;
+
+// same animation constants as gem.cpp
+const float rotateDivisor = 28.0f;
+const float revolveDivisor = 32.0f;
+const float revolveHeight = 0.4f;
+const float revolveHeightSpeedMult = 1.3f;
+
+int main(int argc, char** argv)
+{
+    int samples = 16;
+    int revolveMode = 0;
+    float seconds = 0.0f;
+    TraceSettings settings;
+    std::string output = "gem_trace.ppm";
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "-w") == 0)
+            imageWidth = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-h") == 0)
+            imageHeight = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-s") == 0)
+            samples = std::max(1, atoi(argv[i + 1]));
+        else if (strcmp(argv[i], "-b") == 0)
+            settings.maxBounces = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-t") == 0)
+            seconds = (float)atof(argv[i + 1]);
+        else if (strcmp(argv[i], "-r") == 0)
+            revolveMode = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-o") == 0)
+            output = argv[i + 1];
+    }
+
+    SoftCubemap skybox;
+    skybox.Load(skyboxFaces());
+
+    // pose the gems as they would be after the given number of seconds in the given mode.
+    // gem.cpp advances the spin once per gem per frame, hence the factor of 7.
+    float angle = revolveMode >= 1 ? 7.0f * seconds / rotateDivisor : 0.0f;
+    float revolveOffset = revolveMode >= 2 ? 7.0f * seconds / revolveDivisor : 0.0f;
+
+    vector<TraceInstance> instances;
+    map<int, glm::vec3> gemLocs = makeGemLocations();
+    for (std::map<int, glm::vec3>::iterator it = gemLocs.begin(); it != gemLocs.end(); ++it)
+    {
+        glm::vec3 gemPos = it->second;
+        if (revolveMode >= 3)
+        {
+            float gemTimeOffset = (PI * 2.0f * (float)it->first) / 7.0f;
+            gemPos.y = revolveHeight * sin(PI * (revolveOffset * revolveHeightSpeedMult) + gemTimeOffset);
+        }
+        TraceInstance instance;
+        instance.model = gemModelMatrix(gemPos, revolveOffset, angle);
+        instance.color = colors[it->first];
+        instances.push_back(instance);
+    }
+
+    Camera camera(glm::vec3(0.0f, 1.0f, 6.0f));
+    glm::mat4 view = camera.GetViewMatrix();
+    glm::mat4 projection = camera.GetProjectionMatrix((float)imageWidth / (float)imageHeight, 0.1f, 100.0f);
+
+    RayTracer tracer;
+    tracer.SetInstances(instances);
+    vector<unsigned char> pixels;
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int s = 0; s < samples; s++)
+        tracer.Render(imageWidth, imageHeight, view, projection, camera.Position, skybox, pixels, settings);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+    std::cout << samples << " sample(s) at " << imageWidth << "x" << imageHeight << ": "
+              << elapsed.count() << " ms (" << elapsed.count() / samples << " ms/sample)" << std::endl;
+    return tracer.WritePPM(output, imageWidth, imageHeight, pixels) ? 0 : 1;
+}